@@ -1,9 +1,22 @@
 // copied from Lambert, but ambient and only sun
 
-// passed these from C
-uniform sampler2D bmp_sprite, bmp_normal;
+// the view, the same for every programme, is one buffer if it can be
+#ifdef GL_ARB_uniform_buffer_object
+#extension GL_ARB_uniform_buffer_object : enable
+layout(std140) uniform View {
+	vec2 camera;
+	vec2 projection;
+	vec2 tile_scale;
+	vec2 screen_scale;
+	vec3 sun_direction;
+	vec3 sun_colour;
+};
+#else
 uniform vec3 sun_direction;
 uniform vec3 sun_colour;
+#endif
+// passed these from C
+uniform sampler2D bmp_sprite, bmp_normal;
 // passed these from vertex shader
 varying mat2 pass_rotation;
 varying vec2 pass_texture;
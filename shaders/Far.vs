@@ -1,12 +1,12 @@
 // copied from Lambert, but added forshortening
 
+#include "View.glsl"
 // these are from the vbo
 attribute vec2 attrib_vertex;
 attribute vec2 attrib_texture;
 // these are set in the programme
 uniform float size, angle, foreshortening;
-uniform vec2 object, camera;
-uniform vec2 projection;
+uniform vec2 object;
 // pass these to fragment shader
 varying mat2 pass_rotation; // needed for correct normals
 varying vec2 pass_texture;
@@ -1,38 +1,61 @@
-// must be the same as in Light.c
-#define MAX_LIGHTS 64
+// must be the same as in Draw.c
+#define MAX_LIGHTS 256
+#define LIGHT_TILES 16
+#define LIGHTS_PER_TILE 16
+// the most lights looked at in a tile; Draw.c compiles a programme for each
+// of a few of these and uses the smallest that fits this frame
+#ifndef LIGHTS
+#define LIGHTS LIGHTS_PER_TILE
+#endif
 
+#include "View.glsl"
 // passed these from C
 uniform sampler2D bmp_sprite, bmp_normal;
-uniform vec3 sun_direction;
-uniform vec3 sun_colour;
-uniform int  points;
-uniform vec2 point_position[MAX_LIGHTS];
-uniform vec3 point_colour[MAX_LIGHTS];
+// light_table is MAX_LIGHTS by position, colour; light_index is, for each of
+// LIGHT_TILES^2 screen tiles, LIGHTS_PER_TILE of one plus the index into
+// light_table, zero terminated
+uniform sampler2D light_table, light_index;
+// or, if deferred, the point lights have been added up in light_buffer
+uniform bool is_deferred;
+uniform sampler2D light_buffer;
 // passed these from vertex shader
 varying mat2 pass_rotation;
 varying vec2 pass_texture;
+varying vec2 pass_normal;
 varying vec2 pass_view;
 
 void main() {
 	// texture map
 	vec4 texel = texture2D(bmp_sprite, pass_texture);
 	// normal vectors are encoded as colours in excess-0.5, (viz. PNG -127, PNG does not use 255?)
-	vec3 normal = (texture2D(bmp_normal, pass_texture).rgb - 0.5) * 2.0;
+	vec3 normal = (texture2D(bmp_normal, pass_normal).rgb - 0.5) * 2.0;
 	// the texture is fixed, need to correct the inverse rotation by applying the opposite
 	normal.xy *= pass_rotation;
 
 	// \\cite{lambert1892photometrie} -- sun directional light is modulated by length
 	vec3 shade = sun_colour * max(0.0, dot(normal, sun_direction));
+	if(is_deferred) {
+		shade += texture2D(light_buffer,
+			gl_FragCoord.xy * tile_scale / float(LIGHT_TILES)).rgb;
+		gl_FragColor = vec4(shade * texel.xyz, texel.w);
+		return;
+	}
+#if LIGHTS > 0
+	// only the lights that reach this tile of the screen
+	vec2 tile = floor(gl_FragCoord.xy * tile_scale);
+	float column = (tile.y * float(LIGHT_TILES) + tile.x + 0.5)
+		/ float(LIGHT_TILES * LIGHT_TILES);
 	// point lights are modulated by inverse distance, and z is in null-space
-	for(int i = 0; i < MAX_LIGHTS; i++) {
-		if(i >= points) {
-			break;
-		} else {
-			vec3 colour = point_colour[i];
-			vec2 incoming = point_position[i] - pass_view;
-			shade += colour * max(0.0, dot(normal.xy, normalize(incoming))) / length(incoming);
-		}
+	for(int i = 0; i < LIGHTS; i++) {
+		float index = texture2D(light_index,
+			vec2(column, (float(i) + 0.5) / float(LIGHTS_PER_TILE))).r;
+		if(index < 0.5) break;
+		float u = (index - 0.5) / float(MAX_LIGHTS);
+		vec2 incoming = texture2D(light_table, vec2(u, 0.25)).xy - pass_view;
+		vec3 colour = texture2D(light_table, vec2(u, 0.75)).rgb;
+		shade += colour * max(0.0, dot(normal.xy, normalize(incoming))) / length(incoming);
 	}
+#endif
 	// with the lighting
 	gl_FragColor = vec4(shade * texel.xyz, texel.w);
 }
@@ -1,20 +1,26 @@
+#include "View.glsl"
 // these are from the vbo
 attribute vec2 attrib_vertex;
 attribute vec2 attrib_texture;
-// these are set in the programme
-uniform float size, angle;
-uniform vec2 object, camera;
-uniform vec2 projection;
+// these are per-sprite: x, y, angle, size; and s, t, width, height of the
+// sprite and it's normals in their textures
+attribute vec4 attrib_instance;
+attribute vec4 attrib_texture_rect;
+attribute vec4 attrib_normal_rect;
 // pass these to fragment shader
 varying mat2 pass_rotation; // needed for correct normals
 varying vec2 pass_texture;
+varying vec2 pass_normal;
 varying vec2 pass_view; // needed for point lights
 
 void main() {
-	float c = cos(angle), s = sin(angle);
+	float c = cos(attrib_instance.z), s = sin(attrib_instance.z);
 	mat2 inv_rotate = mat2(c, s, -s, c);
 	pass_rotation = mat2(c, -s, s, c);
-	pass_texture = attrib_texture;
-	pass_view = object + inv_rotate * attrib_vertex * size;
+	pass_texture = attrib_texture_rect.xy + attrib_texture
+		* attrib_texture_rect.zw;
+	pass_normal = attrib_normal_rect.xy + attrib_texture * attrib_normal_rect.zw;
+	pass_view = attrib_instance.xy + inv_rotate * attrib_vertex
+		* attrib_instance.w;
 	gl_Position = vec4(projection * (pass_view - camera), 0.0, 1.0);
 }
@@ -0,0 +1,21 @@
+#include "View.glsl"
+// passed these from C; normals is from the Normals pass, the size of the screen
+uniform sampler2D normals;
+// passed these from vertex shader
+varying vec2 pass_view;
+varying vec2 pass_light;
+varying float pass_radius;
+varying vec3 pass_colour;
+
+void main() {
+	vec4 encoded = texture2D(normals, gl_FragCoord.xy * screen_scale);
+	if(encoded.a < 0.5) discard;
+	vec2 normal = encoded.xy * 2.0 - 1.0;
+	vec2 incoming = pass_light - pass_view;
+	float d = length(incoming);
+	if(d >= pass_radius) discard;
+	// the same as Lambert, but faded out over the last of the radius so the
+	// edge of the square doesn't show
+	gl_FragColor = vec4(pass_colour * max(0.0, dot(normal, incoming / d)) / d
+		* (1.0 - smoothstep(0.75 * pass_radius, pass_radius, d)), 1.0);
+}
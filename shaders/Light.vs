@@ -0,0 +1,20 @@
+#include "View.glsl"
+// these are from the vbo
+attribute vec2 attrib_vertex;
+// these are per-light: x, y, radius; and colour
+attribute vec4 attrib_light;
+attribute vec4 attrib_colour;
+// pass these to fragment shader
+varying vec2 pass_view;
+varying vec2 pass_light;
+varying float pass_radius;
+varying vec3 pass_colour;
+
+void main() {
+	// a square that just covers the radius
+	pass_view = attrib_light.xy + attrib_vertex * 2.0 * attrib_light.z;
+	pass_light = attrib_light.xy;
+	pass_radius = attrib_light.z;
+	pass_colour = attrib_colour.rgb;
+	gl_Position = vec4(projection * (pass_view - camera), 0.0, 1.0);
+}
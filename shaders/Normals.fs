@@ -0,0 +1,15 @@
+// passed these from C
+uniform sampler2D bmp_sprite, bmp_normal;
+// passed these from vertex shader
+varying mat2 pass_rotation;
+varying vec2 pass_texture;
+varying vec2 pass_normal;
+
+void main() {
+	// only where the sprite is mostly opaque; what's under it is hidden
+	if(texture2D(bmp_sprite, pass_texture).a < 0.5) discard;
+	vec3 normal = (texture2D(bmp_normal, pass_normal).rgb - 0.5) * 2.0;
+	normal.xy *= pass_rotation;
+	// point lights only need the screen-plane part; alpha says there's a sprite
+	gl_FragColor = vec4(normal.xy * 0.5 + 0.5, 0.0, 1.0);
+}
@@ -0,0 +1,26 @@
+// copied from Lambert; the first pass of deferred lighting
+
+#include "View.glsl"
+// these are from the vbo
+attribute vec2 attrib_vertex;
+attribute vec2 attrib_texture;
+// these are per-sprite, the same as Lambert
+attribute vec4 attrib_instance;
+attribute vec4 attrib_texture_rect;
+attribute vec4 attrib_normal_rect;
+// pass these to fragment shader
+varying mat2 pass_rotation; // needed for correct normals
+varying vec2 pass_texture;
+varying vec2 pass_normal;
+
+void main() {
+	float c = cos(attrib_instance.z), s = sin(attrib_instance.z);
+	mat2 inv_rotate = mat2(c, s, -s, c);
+	pass_rotation = mat2(c, -s, s, c);
+	pass_texture = attrib_texture_rect.xy + attrib_texture
+		* attrib_texture_rect.zw;
+	pass_normal = attrib_normal_rect.xy + attrib_texture * attrib_normal_rect.zw;
+	vec2 view = attrib_instance.xy + inv_rotate * attrib_vertex
+		* attrib_instance.w;
+	gl_Position = vec4(projection * (view - camera), 0.0, 1.0);
+}
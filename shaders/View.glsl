@@ -0,0 +1,22 @@
+// The view, the same for every programme, is one buffer if it can be; Vsfs2h
+// puts this in every shader that includes it, so the layout is only here.
+// Without buffers, they are uniforms; the ones a programme doesn't use are
+// left out by the compiler.
+#ifdef GL_ARB_uniform_buffer_object
+#extension GL_ARB_uniform_buffer_object : enable
+layout(std140) uniform View {
+	vec2 camera;
+	vec2 projection;
+	vec2 tile_scale;
+	vec2 screen_scale;
+	vec3 sun_direction;
+	vec3 sun_colour;
+};
+#else
+uniform vec2 camera;
+uniform vec2 projection;
+uniform vec2 tile_scale;
+uniform vec2 screen_scale;
+uniform vec3 sun_direction;
+uniform vec3 sun_colour;
+#endif
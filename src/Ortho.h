@@ -10,7 +10,7 @@
 
 #include <assert.h>
 #include <math.h>	/* fmodf */
-#include <stdlib.h>	/* RAND_MAX */
+#include "general/Random.h" /* Random */
 
 /* M_PI is a widely accepted gnu standard, not C<=99 -- who knew? */
 #ifndef M_PI_F
@@ -52,9 +52,9 @@ static void deg_to_rad(float *const theta_ptr) {
 	branch_cut_pi_pi(theta_ptr);
 }
 
-/** Generic uniform {(+/-max)} with {rand}. */
-static float random_pm_max(const float max) {
-	return 2.0f * max * rand() / RAND_MAX - max; /* fixme: Pedantic! */
+/** Generic uniform {(+/-max)} from the stream {r}. */
+static float random_pm_max(struct Random *const r, const float max) {
+	return RandomUniformFloat(r, max);
 }
 /** Zeros {this}. */
 static void ortho3f_init(struct Ortho3f *const this) {
@@ -138,7 +138,7 @@ static void orthomath_unused_coda(void);
 static void orthomath_unused(void) {
 	branch_cut_pi_pi(0);
 	deg_to_rad(0);
-	random_pm_max(0);
+	random_pm_max(0, 0.0f);
 	ortho3f_init(0);
 	ortho3f_assign(0, 0);
 	ortho3f_sum(0, 0);
@@ -23,7 +23,7 @@
 
 #include <stdlib.h> /* EXIT_ */
 #include <stdio.h>  /* fprintf */
-#include <time.h>   /* srand clock */
+#include <time.h>   /* time */
 #include <string.h> /* strcmp */
 #include <assert.h>
 #include "Ortho.h" /* Vec2i */
@@ -32,7 +32,11 @@
 #include "system/Timer.h"
 #include "system/Key.h"
 #include "system/Glew.h"
+#include "system/Replay.h"
+#include "system/Metrics.h"
+#include "system/Programs.h"
 #include "general/Events.h"
+#include "general/Trace.h"
 #include "game/Sprites.h"
 #include "game/Fars.h"
 #include "game/Game.h"
@@ -57,16 +61,24 @@ static struct Window {
 
 /** Help screen. */
 static void usage(void) {
-	fprintf(stderr, "Usage: %s\n"
+	fprintf(stderr, "Usage: %s [-r <file> | -p <file> [-u]] [-t <file>] "
+		"[-m <file>] [-c <directory>]\n"
 		"To win, blow up everything that's not you.\n"
-		"Player one controls: left, right, up, down, space\n"
+		"Record the session to a file: -r <file>.\n"
+		"Play back a recorded session: -p <file>; unthrottled: -u.\n"
+		"Write a Chrome trace of the last frames on exit: -t <file>; 't' writes\n"
+		"it at any time.\n"
+		"Map live counters to a file for polling: -m <file>.\n"
+		"Keep compiled shaders in a directory: -c <directory>; the default is\n"
+		"cache.\n", programme);
+	fprintf(stderr, "Player one controls: left, right, up, down, space\n"
 		"Fullscreen: F1.\n"
 		"Exit: Escape.\n\n"
 		"%s Copyright %s Neil Edelman\n"
 		"This program comes with ABSOLUTELY NO WARRANTY.\n"
 		"This is free software, and you are welcome to redistribute it\n" 
 		"under certain conditions; see copying.txt.\n\n",
-		programme, programme, year);
+		programme, year);
 	fprintf(stderr, "Image credit: NASA; JPL; ESA; Caltech; UCLA; MPS; DLR;\n"
 		"IDA; Johns Hopkins University APL; Carnegie Institution of\n"
 		"Washington; DSS Consortium; SDSS.\n\n"
@@ -115,7 +127,8 @@ static int Window(const char *title, int argc, char **argv) {
 /** This is legacy code from 1998 when there was no way to get out of the main
  loop. */
 static void atexit_hack(void) {
-	TimerPause(), Game_(), Draw_(), Fars_(), Sprites_(), Events_();
+	TimerPause(), Game_(), Draw_(), Fars_(), Sprites_(), Events_(), Replay_(),
+		Trace_(), Metrics_(), Programs_();
 }
 
 /** Entry point.
@@ -123,9 +136,27 @@ static void atexit_hack(void) {
  @param argv the arguments
  @return     either EXIT_SUCCESS or EXIT_FAILURE */
 int main(int argc, char **argv) {
-	const char *e = 0;
+	const char *e = 0, *replay_fn = 0;
+	enum ReplayMode replay_mode = REPLAY_OFF;
+	int is_unthrottled = 0, i;
 	/* @fixme More options (ie, load game, etc.) */
-	if(argc > 1) return usage(), EXIT_SUCCESS;
+	for(i = 1; i < argc; i++) {
+		if(!strcmp(argv[i], "-r") && i + 1 < argc && !replay_mode) {
+			replay_mode = REPLAY_RECORD, replay_fn = argv[++i];
+		} else if(!strcmp(argv[i], "-p") && i + 1 < argc && !replay_mode) {
+			replay_mode = REPLAY_PLAY, replay_fn = argv[++i];
+		} else if(!strcmp(argv[i], "-u")) {
+			is_unthrottled = 1;
+		} else if(!strcmp(argv[i], "-t") && i + 1 < argc) {
+			Trace(argv[++i]);
+		} else if(!strcmp(argv[i], "-m") && i + 1 < argc) {
+			if(!Metrics(argv[++i])) return EXIT_FAILURE;
+		} else if(!strcmp(argv[i], "-c") && i + 1 < argc) {
+			if(!Programs(argv[++i])) return EXIT_FAILURE;
+		} else {
+			return usage(), EXIT_SUCCESS;
+		}
+	}
 	/* Direct sdtout, stderr, to log files instead of to a awkward separate
 	 terminal window. Nope. */
 	/*freopen("stdout.txt", "a+", stdout);
@@ -135,8 +166,8 @@ int main(int argc, char **argv) {
 #else /* free --><-- !free */
 	if(atexit(&atexit_hack)) perror("atexit");
 #endif /* !free --> */
-	/* Entropy increase. */
-	srand((unsigned)clock());
+	/* Seeds {Random}; first, so everything is reproducible. */
+	if(!Replay(replay_fn, replay_mode, is_unthrottled)) return EXIT_FAILURE;
 	do { /* try */
 		/* Window has to be first. */
 		if(!Window(programme, argc, argv)) { e = "window"; break; }
@@ -191,8 +191,8 @@ static void draw_bin(const unsigned idx) {
 	assert(fars && idx < LAYER_SIZE);
 	FarListForEach(fars->bins + idx, &draw_far);
 }
-/* Must call \see{SpriteUpdate} because it sets the camera. Use when Far GPU
- shader is loaded. */
+/* Must call \see{SpriteUpdate} because it sets the camera. Queues the far
+ objects on screen to be drawn with Far. */
 void FarsDraw(void) {
 	struct Rectangle4f rect;
 	if(!fars) return;
@@ -17,10 +17,12 @@
 #include "Sprites.h"
 #include "Zone.h"
 #include "../general/Events.h"
+#include "../general/Trace.h"
 #include "../system/Key.h"
 #include "../system/Poll.h"
 #include "../system/Draw.h"
 #include "../system/Timer.h"
+#include "../system/Metrics.h"
 #include "Game.h"
 
 /* from Auto */
@@ -47,16 +49,36 @@ static const float asteroid_max_speed = 0.03f;
 /*const float de_sitter = 8192.0f; !!! */
 
 
+/** Publishes the counters, if there's a \see{Metrics} file. */
+static void metrics(const int dt_ms) {
+	struct Metrics *m;
+	if(!(m = MetricsBegin())) return;
+	SpritesMetrics(m);
+	m->ms_game    = TimerGetGameTime();
+	m->events     = (unsigned)EventsGetSize();
+	m->draw_calls = DrawGetCalls();
+	MetricsEnd(dt_ms < 0 ? 0 : (unsigned)dt_ms);
+}
+
 /** Updates the gameplay.
  @implements WindowGlutFunction */
 static void update(const int dt_ms) {
 	if(!is_started) return;
+	TraceBegin("update");
 	/* Update keys. */
+	TraceBegin("PollUpdate");
 	PollUpdate();
+	TraceEnd();
 	/* Collision detect, move sprites, center on the player; a lot of work. */
+	TraceBegin("SpritesUpdate");
 	SpritesUpdate(dt_ms);
+	TraceEnd();
 	/* Dispatch events; after update so that immidiate can be immediate. */
+	TraceBegin("EventsUpdate");
 	EventsUpdate();
+	TraceEnd();
+	metrics(dt_ms);
+	TraceEnd();
 }
 
 static void quit(void) {
@@ -123,12 +145,17 @@ int Game(void) {
 	};
 
 	/* register gameplay keys -- motion keys are polled in {@see GameUpdate} */
-	KeyRegister(27,   &quit);
-	KeyRegister('p',  &pause);
-	KeyRegister(k_f1, &WindowToggleFullScreen);
-	KeyRegister('f',  &fps);
-	KeyRegister('x',  &position);
+	KeyRegisterLive(27,   &quit);
+	KeyRegisterLive('p',  &pause);
+	KeyRegisterLive(k_f1, &WindowToggleFullScreen);
+	KeyRegisterLive('f',  &fps);
+	KeyRegisterLive('x',  &position);
+	KeyRegisterLive('t',  &TraceDump);
+	/* These are recorded in a replay. */
 	KeyRegister('1',  &SpritesPlotSpace);
+	KeyRegister('g',  &DrawToggleDeferred);
+	KeyRegister(k_f5, &ZoneSave);
+	KeyRegister(k_f9, &ZoneLoad);
 	/*
 	KeyRegister('l',  &LightList);*/
 	/*KeyRegister('s',  &SpriteList);*/
@@ -14,14 +14,17 @@
 			2015-06 */
 
 #include <stdio.h> /* fprintf */
+#include <float.h> /* FLT_MAX */
 #include "../../build/Auto.h" /* for AutoImage, AutoShipClass, etc */
 #include "../Ortho.h" /* Vec2f, etc */
 #include "../general/Orcish.h" /* for human-readable ship names */
 #include "../general/Events.h" /* Event for delays */
 #include "../general/Layer.h" /* for descritising */
+#include "../general/Trace.h" /* for profiling */
 #include "../system/Poll.h" /* input */
 #include "../system/Draw.h" /* DrawSetCamera, DrawGetScreen */
 #include "../system/Timer.h" /* for expiring */
+#include "../system/Metrics.h" /* for soak tests */
 #include "Zone.h" /* ZoneChange */
 #include "Game.h" /* GameGetPlayer */
 /*#include "Light.h"*/ /* for glowing */
@@ -30,8 +33,10 @@
 #define LAYER_SIDE_SIZE (64)
 #define LAYER_SIZE (LAYER_SIDE_SIZE * LAYER_SIDE_SIZE)
 static const float layer_space = 256.0f;
-/* must be the same as in Lighting.fs */
-#define MAX_LIGHTS (64)
+/* must be the same as in Lambert.fs and Draw.c */
+#define MAX_LIGHTS (256)
+/* Lights that can exist at once; the best {MAX_LIGHTS} are drawn. */
+#define MAX_LOGICAL_LIGHTS (2048)
 
 /* This is used for small floating-point values. The value doesn't have any
  significance. */
@@ -51,6 +56,9 @@ static const float turn_damping_1st_order = 0.00442217f;
 static const float mass_damage = 5.0f;
 /* Max speed for a Debris. */
 static const float max_debris_speed2 = (0.2f)*(0.2f);
+/* How close to a {Gate} the player gets before the zone on the other side is
+ generated in the background. */
+static const float gate_staging_distance2 = (2048.0f)*(2048.0f);
 
 
 
@@ -88,13 +96,16 @@ struct ShipVt;
 struct Ship {
 	struct SpriteListNode sprite;
 	struct ShipVt *vt;
+	const struct AutoShipClass *class;
 	float mass; /* T */
-	struct Vec2f hit; /* F */
+	struct Vec2f hit; /* F; {hit.x} is as of {ms_hit}, \see{ship_settle} */
+	unsigned ms_hit; /* game time */
 	float recharge /* mS */, max_speed2 /* (m/ms)^2 */,
 		acceleration /* m/ms^2 */, turn /* radians/ms */;
 	char name[16];
 	const struct AutoWmdType *wmd;
 	unsigned ms_recharge_wmd;
+	struct { int turning, acceleration, shoot; } ai; /* last think */
 };
 #define POOL_NAME Ship
 #define POOL_TYPE struct Ship
@@ -104,6 +115,7 @@ struct Ship {
 /** Define {DebrisPool} and {DebrisPoolNode}, a subclass of {Sprite}. */
 struct Debris {
 	struct SpriteListNode sprite;
+	const struct AutoDebris *class;
 	float mass, energy;
 };
 #define POOL_NAME Debris
@@ -118,6 +130,7 @@ struct Wmd {
 	/*const struct Sprite *from;*/
 	float mass;
 	unsigned expires;
+	struct EventHandle expiry; /* \see{wmd_expire} */
 	unsigned light;
 };
 #define POOL_NAME Wmd
@@ -192,10 +205,53 @@ struct Collision {
 
 
 
+/** AI {Ship}s that are due to think this frame, packed so they can all be
+ done at once, \see{SpritesAi.h}. It uses the index because {Ship}s can move
+ in memory. Defines {ThinkStack}. */
+struct Think {
+	size_t ship;
+	struct Vec2f d;
+	float theta;
+};
+#define STACK_NAME Think
+#define STACK_TYPE struct Think
+#include "../templates/Stack.h"
+
+/* Each AI {Ship} is due to think once every so many frames. */
+#define AI_THINK_PERIOD (4)
+
+
+
+/** A {Ship} or {Debris} in compact form for the zone cache,
+ \see{SpritesCache.h}; it doesn't refer to anything in memory, so it can go
+ on disk. Defines {RecordStack}. */
+struct Record {
+	unsigned short class; /* index in {auto_ship_class} or {auto_debris} */
+	unsigned short type; /* {SpriteClass} */
+	float x, y, theta, vx, vy, omega;
+	float hit; /* {Ship.hit.x} or {Debris.energy} */
+};
+#define STACK_NAME Record
+#define STACK_TYPE struct Record
+#include "../templates/Stack.h"
+
+/* The flow field, \see{SpritesFlow.h}; enough buckets to cover the biggest
+ edge, and an entry for every time a bin can get closer. */
+#define FLOW_BUCKETS (32)
+#define FLOW_ENTRIES (LAYER_SIZE * 8 + 2)
+
+/* Zones in memory; older ones get spilled, \see{SpritesCache.h}. */
+#define ZONE_CACHE_SIZE (4)
+#define ZONE_SPILL_SIZE (32)
+
+
+
 /** Sprites all together. */
 static struct Sprites {
 	struct Bin {
 		struct SpriteList sprites;
+		/* Sprites of the next zone, not in space yet, \see{SpritesCache.h}. */
+		struct SpriteList staged;
 		struct CoverStack *covers;
 	} bins[LAYER_SIZE];
 	/* Backing for the {SpriteList} in the bins. */
@@ -211,23 +267,88 @@ static struct Sprites {
 	struct Layer *layer;
 	/* Constantly updating frame time. */
 	float dt_ms;
+	/* Frame count; AI thinks in round-robin buckets of frames. */
+	unsigned frame;
+	/* Where the thinking starts in each bucket, \see{SpritesAi.h}. */
+	size_t think_cursor[AI_THINK_PERIOD];
+	/* Counted every frame for \see{SpritesMetrics}. */
+	struct { unsigned covers, collisions; } count;
+	/* Backing for the AI that's thinking this frame. */
+	struct ThinkStack *thinks;
+	/* Shared direction towards the player for the AI. */
+	struct Flow {
+		int is_building, is_ready;
+		unsigned target, started, current;
+		size_t pending, entry_size;
+		unsigned dist[LAYER_SIZE];
+		unsigned char cost[LAYER_SIZE];
+		signed char build[LAYER_SIZE], dir[LAYER_SIZE];
+		unsigned short head[FLOW_BUCKETS];
+		struct FlowEntry { unsigned short bin, next; } entry[FLOW_ENTRIES];
+	} flow;
 	struct InfoStack *info; /* Debug. */
 	struct {
 		int is_ship;
 		size_t ship_index;
 	} player;
-	/* Lights are a static structure with a hard-limit defined by the shader. */
+	/* Lights are a static structure; there can be more lights than the
+	 hard-limit defined by the shader, so every frame the best are picked,
+	 \see{light_budget}, and only those are in the tables. */
 	struct Lights {
-		size_t size;
+		size_t size, budget_size;
 		struct Light {
 			struct Sprite *sprite;
-		} light_table[MAX_LIGHTS];
+			struct Colour3f colour;
+			unsigned expires; /* zero for never */
+			float score;
+		} light_table[MAX_LOGICAL_LIGHTS];
+		unsigned short budget[MAX_LOGICAL_LIGHTS];
 		struct Vec2f x_table[MAX_LIGHTS];
 		struct Colour3f colour_table[MAX_LIGHTS];
 	} lights;
-	enum Plots { PLOT_NOTHING, PLOT_SPACE = 1 } plots;
+	/* Debug; streaming the sprites, \see{SpritesPlot.h}. */
+	struct Telemetry {
+		FILE *fp;
+		struct TelemetryBuffer {
+			unsigned char *data;
+			size_t size, capacity;
+		} capture, flush;
+		size_t flushed;
+		unsigned frames, dropped;
+	} telemetry;
+	/* Recently visited zones, least-recently-used first out. */
+	struct ZoneCache {
+		unsigned time;
+		struct CachedZone {
+			const struct AutoSpaceZone *zone;
+			unsigned used;
+			struct RecordStack *records;
+		} zones[ZONE_CACHE_SIZE];
+		FILE *spill;
+		/* A {Spill} without a {zone} but with {capacity} is free space. */
+		struct Spill {
+			const struct AutoSpaceZone *zone;
+			long offset;
+			size_t size, capacity;
+		} spills[ZONE_SPILL_SIZE];
+		unsigned spill_next;
+		/* A zone that is being made a slice at a time, first as {Record}s,
+		 then as sprites in {Bin.staged}. */
+		struct Staging {
+			const struct AutoSpaceZone *zone;
+			const struct AutoShipClass *ship;
+			const struct AutoDebris *debris;
+			unsigned ships, debris_no; /* left to generate */
+			struct RecordStack *records;
+			size_t built; /* of {records} */
+		} staging;
+	} cache;
 } *sprites;
 
+/* Debug telemetry, \see{SpritesPlot.h}. */
+static void telemetry(struct Telemetry *const tel);
+static void telemetry_(void);
+
 
 
 /* Include Light functions. */
@@ -255,7 +376,7 @@ typedef float (*SpriteFloatAccessor)(const struct Sprite *const);
 typedef int (*SpriteFloatPredicate)(struct Sprite *const, const float);
 
 /** Sometimes, the sprite class is important; ie, {typeof(sprite)};
- eg collision resolution. */
+ eg collision resolution. {1 << SpriteClass} is {SpriteClassFlags}. */
 enum SpriteClass { SC_SHIP, SC_DEBRIS, SC_WMD, SC_GATE };
 
 /** Define {SpriteVt}. */
@@ -324,6 +445,7 @@ static void debris_delete(struct Debris *const this) {
 }
 /** @implements <Wmd>Action */
 static void wmd_delete(struct Wmd *const this) {
+	EventsCancel(&this->expiry);
 	WmdPoolRemove(sprites->wmds, this);
 }
 /** @implements <Gate>Action */
@@ -338,6 +460,8 @@ static int sprite_update(struct Sprite *const this) {
 	assert(this);
 	return this->vt->update(this);
 }
+/* Includes the flow field that the AI uses. */
+#include "SpritesFlow.h"
 /* Includes {ship_update*} Human/AI. */
 #include "SpritesAi.h"
 /** Does nothing; just debris.
@@ -346,16 +470,22 @@ static int debris_update(struct Debris *const this) {
 	UNUSED(this);
 	return 1;
 }
-/** @implements <Wmd>Predicate
- @fixme Replace delete with more dramatic death. */
+/** Does nothing; expiring is an event, \see{wmd_expire}.
+ @implements <Wmd>Predicate */
 static int wmd_update(struct Wmd *const this) {
-	if(TimerIsGameTime(this->expires))
-		return sprite_delete(&this->sprite.data), 0;
+	UNUSED(this);
 	return 1;
 }
-/** @implements <Gate>Predicate */
+/** If the player is near, starts getting the other side ready, so crossing
+ doesn't stall, \see{ZoneStage}.
+ @implements <Gate>Predicate */
 static int gate_update(struct Gate *const this) {
-	UNUSED(this);
+	const struct Ship *const player = get_player();
+	struct Vec2f d;
+	if(!player) return 1;
+	d.x = player->sprite.data.x.x - this->sprite.data.x.x;
+	d.y = player->sprite.data.x.y - this->sprite.data.x.y;
+	if(d.x * d.x + d.y * d.y < gate_staging_distance2) ZoneStage(this->to);
 	return 1;
 }
 
@@ -372,6 +502,7 @@ static void ship_on_collision(const struct Ship *const this) {
 /* @fixme This is not how explosions work. */
 static void debris_breakup(struct Debris *const this) {
 	const struct AutoDebris *small = AutoDebrisSearch("SmallAsteroid");
+	struct Random *const r = RandomStream(RANDOM_DEBRIS);
 	struct Debris *d;
 	struct Ortho3f v, perturb, error;
 	int no;
@@ -385,9 +516,9 @@ static void debris_breakup(struct Debris *const this) {
 		if(!--no) {
 			ortho3f_sub(&v, &v, &error);
 		} else {
-			perturb.x = random_pm_max(0.05f);
-			perturb.y = random_pm_max(0.05f);
-			perturb.theta = random_pm_max(0.002f);
+			perturb.x = random_pm_max(r, 0.05f);
+			perturb.y = random_pm_max(r, 0.05f);
+			perturb.theta = random_pm_max(r, 0.002f);
 			ortho3f_sum(&v, &perturb);
 			ortho3f_sum(&error, &perturb);
 		}
@@ -474,8 +605,25 @@ static void sprite_put_damage(struct Sprite *const this, const float damage) {
 	assert(this);
 	this->vt->put_damage(this, damage);
 }
+/** Shields recharge lazily from the time they were last set.
+ @return The shields of {this} at game time {now}. */
+static float ship_shield(const struct Ship *const this, const unsigned now) {
+	float shield = this->hit.x;
+	assert(this);
+	if(shield >= this->hit.y) return this->hit.y;
+	shield += this->recharge * (float)(now - this->ms_hit);
+	return shield > this->hit.y ? this->hit.y : shield;
+}
+/** Brings {hit.x} up to the current time. */
+static void ship_settle(struct Ship *const this) {
+	const unsigned now = TimerGetGameTime();
+	assert(this);
+	this->hit.x = ship_shield(this, now);
+	this->ms_hit = now;
+}
 /** @implements <Ship,Float>Predicate */
 static void ship_put_damage(struct Ship *const this, const float damage) {
+	ship_settle(this);
 	this->hit.x -= damage;
 	if(this->hit.x <= 0.0f) sprite_delete(&this->sprite.data);
 	if(this->hit.x > this->hit.y) this->hit.x = this->hit.y; /* Full. */
@@ -583,8 +731,10 @@ static void migrate_sprite(struct Sprites *const s,
 	assert(s && s == sprites && migrate);
 	printf("migrate_sprite\n");
 	/* {sub types}->{sprites}. */
-	for(i = 0; i < LAYER_SIZE; i++)
+	for(i = 0; i < LAYER_SIZE; i++) {
 		SpriteListMigrate(&s->bins[i].sprites, migrate);
+		SpriteListMigrate(&s->bins[i].staged, migrate);
+	}
 	/* {onscreens}->{sprites}. */
 	OnscreenStackMigrateEach(s->onscreens, &onscreen_migrate_sprite, migrate);
 	/* {lights}->{sprites}. */
@@ -617,17 +767,25 @@ static void migrate_onscreen(struct Sprites *const s,
 }
 
 
+/* Include the zone cache functions. */
+#include "SpritesCache.h"
+
+
 
 /** Destructor. */
 void Sprites_(void) {
 	unsigned i;
 	/* We don't have to do the lights; all static. */
 	if(!sprites) return;
+	telemetry_();
 	for(i = 0; i < LAYER_SIZE; i++) {
 		SpriteListClear(&sprites->bins[i].sprites);
+		SpriteListClear(&sprites->bins[i].staged);
 		CoverStack_(&sprites->bins[i].covers);
 	}
+	zone_cache_(&sprites->cache);
 	InfoStack_(&sprites->info);
+	ThinkStack_(&sprites->thinks);
 	Layer_(&sprites->layer);
 	CollisionStack_(&sprites->collisions);
 	OnscreenStack_(&sprites->onscreens);
@@ -641,8 +799,8 @@ void Sprites_(void) {
 /** @return True if the sprite buffers have been set up. */
 int Sprites(void) {
 	unsigned i;
-	enum { NO, BINS, SHIP, DEBRIS, WMD, GATE, REF, COLLISION, LAYER, INFO }
-		e = NO;
+	enum { NO, BINS, SHIP, DEBRIS, WMD, GATE, REF, COLLISION, LAYER, INFO,
+		THINK } e = NO;
 	const char *ea = 0, *eb = 0;
 	if(sprites) return 1;
 	/* Static, if it were possible. */
@@ -653,6 +811,7 @@ int Sprites(void) {
 		{ perror("Sprites"); Sprites_(); return 0; }
 	for(i = 0; i < LAYER_SIZE; i++) {
 		SpriteListClear(&sprites->bins[i].sprites);
+		SpriteListClear(&sprites->bins[i].staged);
 		sprites->bins[i].covers = 0;
 	}
 	sprites->ships = 0;
@@ -663,11 +822,17 @@ int Sprites(void) {
 	sprites->collisions = 0;
 	sprites->layer = 0;
 	sprites->dt_ms = 20;
+	sprites->frame = 0;
+	for(i = 0; i < AI_THINK_PERIOD; i++) sprites->think_cursor[i] = 0;
+	sprites->thinks = 0;
+	flow_init(&sprites->flow);
 	sprites->info = 0;
 	sprites->player.is_ship = 0;
 	sprites->player.ship_index = 0;
 	sprites->lights.size = 0;
-	sprites->plots = PLOT_NOTHING;
+	sprites->lights.budget_size = 0;
+	telemetry(&sprites->telemetry);
+	zone_cache(&sprites->cache);
 	do {
 		for(i = 0; i < LAYER_SIZE; i++) {
 			if(!(sprites->bins[i].covers = CoverStack())) { e = BINS; break; }
@@ -688,6 +853,8 @@ int Sprites(void) {
 			{ e = LAYER; break; }
 		if(!(sprites->info = InfoStack()))
 			{ e = INFO; break; }
+		if(!(sprites->thinks = ThinkStack()))
+			{ e = THINK; break; }
 	} while(0); switch(e) {
 		case NO: break;
 		case BINS: ea = "bins", eb = CoverStackGetError(0); break; /* hack */
@@ -701,6 +868,8 @@ int Sprites(void) {
 			eb = CollisionStackGetError(sprites->collisions); break;
 		case LAYER: ea = "layer", eb = "couldn't get layer"; break;
 		case INFO: ea = "info", eb = InfoStackGetError(sprites->info); break;
+		case THINK: ea = "think", eb = ThinkStackGetError(sprites->thinks);
+			break;
 	} if(e) {
 		fprintf(stderr, "Sprites %s buffer: %s.\n", ea, eb);
 		Sprites_();
@@ -771,8 +940,10 @@ struct Ship *SpritesShip(const struct AutoShipClass *const class,
 		{ fprintf(stderr, "SpritesShip: %s.\n",
 		ShipPoolGetError(sprites->ships)); return 0; }
 	sprite_filler(&this->sprite.data, vt, class->sprite, x);
+	this->class = class;
 	this->mass = class->mass;
 	this->hit.x = this->hit.y = class->shield; /* F */
+	this->ms_hit = TimerGetGameTime();
 	/* (1/1,000,000)F/ms = (1F/1000mF)(s/1000ms)mF/s = mS */
 	assert(class->recharge >= 0);
 	this->recharge = class->recharge * 0.000001f;
@@ -785,6 +956,7 @@ struct Ship *SpritesShip(const struct AutoShipClass *const class,
 	Orcish(this->name, sizeof this->name);
 	this->wmd = class->weapon;
 	this->ms_recharge_wmd = 0;
+	this->ai.turning = this->ai.acceleration = this->ai.shoot = 0;
 	if(ai == AI_HUMAN) {
 		if(sprites->player.is_ship)
 			fprintf(stderr, "SpritesShip: overriding previous player.\n");
@@ -804,11 +976,23 @@ struct Debris *SpritesDebris(const struct AutoDebris *const class,
 	if(!(this = DebrisPoolNew(sprites->debris))) { fprintf(stderr,
 		"SpriteDebris: %s.\n", DebrisPoolGetError(sprites->debris)); return 0; }
 	sprite_filler(&this->sprite.data, &debris_vt, class->sprite, x);
+	this->class = class;
 	this->mass = class->mass;
 	this->energy = 0.0f;
 	return this;
 }
 
+/** Called when the {Wmd} at {index} has gone it's range.
+ @implements IntConsumer
+ @fixme Replace delete with more dramatic death. */
+static void wmd_expire(const int index) {
+	struct Wmd *this;
+	if(!sprites || !(this = WmdPoolGetElement(sprites->wmds, (size_t)index)))
+		return;
+	this->expiry.serial = 0;
+	sprite_delete(&this->sprite.data);
+}
+
 /** Creates a new {Wmd}. */
 struct Wmd *SpritesWmd(const struct AutoWmdType *const class,
 	const struct Ship *const from) {
@@ -835,7 +1019,10 @@ struct Wmd *SpritesWmd(const struct AutoWmdType *const class,
 	/*this->from = &from->sprite.data;*/
 	this->mass = class->impact_mass;
 	this->expires = TimerGetGameTime() + class->ms_range;
-	Light(&this->sprite.data, class->r, class->g, class->b);
+	/* The index stays the same if the pool moves; it's cancelled on delete. */
+	this->expiry = EventsIntConsumer(class->ms_range, &wmd_expire,
+		(int)WmdPoolGetIndex(sprites->wmds, this));
+	Light(&this->sprite.data, class->r, class->g, class->b, this->expires);
 	return this;
 }
 
@@ -858,6 +1045,9 @@ struct Gate *SpritesGate(const struct AutoGate *const class) {
 	return this;
 }
 
+/* Include the snapshot functions; needs the constructors. */
+#include "SpritesSnapshot.h"
+
 
 
 
@@ -876,6 +1066,7 @@ static void put_cover(const unsigned bin, const unsigned no,
 		CoverStackGetError(sprites->bins[bin].covers)); return;}
 	cover->onscreen = on;
 	cover->is_corner = !no;
+	sprites->count.covers++;
 }
 /** Moves the sprite. Calculates temporary values, {dx}, and {box}; sticks it
  into the appropriate {covers}. Called in \see{extrapolate_bin}.
@@ -956,6 +1147,9 @@ static void timestep_bin(const unsigned idx) {
 /* This is where \see{collide_bin} is located, but lots of helper functions. */
 #include "SpritesCollide.h"
 
+/* Neighbour queries. */
+#include "SpritesQuery.h"
+
 /* This includes some debuging functions, namely, {SpritesPlot}. */
 #include "SpritesPlot.h"
 
@@ -965,6 +1159,8 @@ void SpritesUpdate(const int dt_ms) {
 	if(!sprites) return;
 	/* Update with the passed parameter. */
 	sprites->dt_ms = dt_ms;
+	sprites->frame++;
+	sprites->count.covers = 0;
 	/* Clear info on every frame. */
 	InfoStackClear(sprites->info);
 	/* Centre on the the player. */
@@ -980,21 +1176,32 @@ void SpritesUpdate(const int dt_ms) {
 		DrawGetScreen(&rect);
 		rectangle4f_expand(&rect, layer_space * 0.5f);
 		LayerSetScreenRectangle(sprites->layer, &rect); }
+	/* A slice of the AI's flow field. */
+	flow_update();
+	/* A slice of the zone behind a nearby gate; before anything iterates. */
+	staging_update();
 	/* Dynamics; puts temp values in {cover} for collisions. Don't delete a
 	 sprite until {onscreens} has been cleared. */
+	TraceBegin("extrapolate");
 	LayerForEachScreen(sprites->layer, &extrapolate_bin);
+	TraceEnd();
+	/* The AI that was due this frame decides what to do next frame. */
+	ai_think();
 	/* Debug. */
-	if(sprites->plots) {
-		if(sprites->plots & PLOT_SPACE) space_plot();
-		sprites->plots = PLOT_NOTHING;
-	}
+	if(sprites->telemetry.fp) telemetry_update();
 	/* Collision has to be called after {extrapolate}; it consumes {cover}.
 	 (fixme: really? 3 passes?) */
+	TraceBegin("collide");
 	LayerForEachScreen(sprites->layer, &collide_bin);
+	TraceEnd();
+	sprites->count.collisions
+		= (unsigned)CollisionStackGetSize(sprites->collisions);
 	/* Clear out the temporary {onscreens} now that cover is consumed. */
 	OnscreenStackClear(sprites->onscreens);
 	/* Time-step. */
+	TraceBegin("timestep");
 	LayerForEachScreen(sprites->layer, &timestep_bin);
+	TraceEnd();
 }
 
 /** Called from \see{draw_bin}.
@@ -1010,7 +1217,7 @@ static void draw_bin(const unsigned idx) {
 	SpriteListForEach(&sprites->bins[idx].sprites, &draw_sprite);
 }
 /** Must call \see{SpriteUpdate} before this, because it sets
- {sprites.layer}. Use when the Lambert GPU shader is loaded. */
+ {sprites.layer}. Queues the sprites on screen to be drawn with Lambert. */
 void SpritesDraw(void) {
 	if(!sprites) return;
 	LayerForEachScreen(sprites->layer, &draw_bin);
@@ -1033,12 +1240,30 @@ void Info(const struct Vec2f *const x, const struct AutoImage *const image) {
 static void draw_info(struct Info *const this) {
 	DrawDisplayInfo(&this->x, this->image);
 }
-/** Use when the Info GPU shader is loaded. */
+/** Queues the debug info to be drawn with Info. */
 void SpritesInfo(void) {
 	if(!sprites) return;
 	InfoStackForEach(sprites->info, &draw_info);
 }
 
+/** Fills in the sprite counters of {m} from the last \see{SpritesUpdate}. */
+void SpritesMetrics(struct Metrics *const m) {
+	if(!sprites || !m) return;
+	m->ships           = (unsigned)ShipPoolGetSize(sprites->ships);
+	m->ships_capacity  = (unsigned)ShipPoolGetCapacity(sprites->ships);
+	m->debris          = (unsigned)DebrisPoolGetSize(sprites->debris);
+	m->debris_capacity = (unsigned)DebrisPoolGetCapacity(sprites->debris);
+	m->wmds            = (unsigned)WmdPoolGetSize(sprites->wmds);
+	m->wmds_capacity   = (unsigned)WmdPoolGetCapacity(sprites->wmds);
+	m->gates           = (unsigned)GatePoolGetSize(sprites->gates);
+	m->gates_capacity  = (unsigned)GatePoolGetCapacity(sprites->gates);
+	m->bins            = (unsigned)LayerGetScreenSize(sprites->layer);
+	m->covers          = sprites->count.covers;
+	m->collisions      = sprites->count.collisions;
+	m->lights          = (unsigned)sprites->lights.budget_size;
+	m->logical_lights  = (unsigned)sprites->lights.size;
+}
+
 
 
 /** Specific sprites. */
@@ -1096,8 +1321,9 @@ struct Ship *SpritesGetPlayerShip(void) {
 }
 
 /** How much shields are left. */
-const struct Vec2f *ShipGetHit(const struct Ship *const this) {
+const struct Vec2f *ShipGetHit(struct Ship *const this) {
 	if(!this) return 0;
+	ship_settle(this);
 	return &this->hit;
 }
 
@@ -9,10 +9,16 @@ struct AutoDebris;
 struct AutoWmdType;
 struct AutoGate;
 struct AutoObjectInSpace;
+struct AutoSpaceZone;
+struct Metrics;
 typedef int (*SpritesPredicate)(const struct Sprite *const);
 
 enum AiType { AI_DUMB, AI_HUMAN };
 
+/** Filters for neighbour queries; {SpritesQuery.h}. */
+enum SpriteClassFlags { SCF_SHIP = 1, SCF_DEBRIS = 2, SCF_WMD = 4, SCF_GATE = 8,
+	SCF_ALL = 15 };
+
 typedef void (*InfoOutput)(const struct Vec2f *const x,
 	const struct AutoImage *const sprite);
 typedef void (*LambertOutput)(const struct Ortho3f *const x,
@@ -32,6 +38,7 @@ void SpritesUpdate(const int dt_ms);
 void SpritesDraw(void);
 void Info(const struct Vec2f *const x, const struct AutoImage *const image);
 void SpritesInfo(void);
+void SpritesMetrics(struct Metrics *const m);
 void SpritesRemoveIf(const SpritesPredicate predicate);
 const struct Ortho3f *SpriteGetPosition(const struct Sprite *const this);
 const struct Ortho3f *SpriteGetVelocity(const struct Sprite *const this);
@@ -40,7 +47,7 @@ void SpriteSetVelocity(struct Sprite *const this,const struct Ortho3f *const v);
 const struct AutoSpaceZone *GateGetTo(const struct Gate *const this);
 struct Gate *FindGate(const struct AutoSpaceZone *const to);
 struct Ship *SpritesGetPlayerShip(void);
-const struct Vec2f *ShipGetHit(const struct Ship *const this);
+const struct Vec2f *ShipGetHit(struct Ship *const this);
 char *SpritesToString(const struct Sprite *const this);
 unsigned SpriteGetBin(const struct Sprite *const this);
 
@@ -50,5 +57,30 @@ size_t SpritesLightGetSize(void);
 struct Vec2f *SpritesLightPositions(void);
 struct Colour3f *SpritesLightGetColours(void);
 
+/* In {SpritesCache.h}. */
+void SpritesCacheStore(const struct AutoSpaceZone *const zone);
+int SpritesCacheRestore(const struct AutoSpaceZone *const zone);
+int SpritesCacheStage(const struct AutoSpaceZone *const zone,
+	const struct AutoShipClass *const ship, const unsigned ships,
+	const struct AutoDebris *const debris, const unsigned debris_no);
+
+/* In {SpritesSnapshot.h}. */
+int SpritesSnapshotSave(const char *const fn,
+	const struct AutoSpaceZone *const zone);
+int SpritesSnapshotLoad(const char *const fn,
+	void (*const zone)(const struct AutoSpaceZone *const));
+
+/* In {SpritesQuery.h}. */
+size_t SpritesNearest(const struct Vec2f *const x, const float radius,
+	const unsigned classes, const struct Sprite *const except,
+	struct Sprite **const result, size_t k);
+size_t SpritesWithin(const struct Vec2f *const x, const float radius,
+	const unsigned classes, const struct Sprite *const except,
+	struct Sprite **const result, const size_t result_size);
+size_t SpritesCone(const struct Ortho3f *const x, const float radius,
+	const float half_angle, const unsigned classes,
+	const struct Sprite *const except, struct Sprite **const result,
+	const size_t result_size);
+
 /* In {SpritesPlot.h} */
 void SpritesPlotSpace(void);
@@ -7,7 +7,8 @@
  @title		SpritesAi
  @author	Neil
  @std		C89/90
- @version	2017-11 Broke off from Sprites. */
+ @version	2018-01 Think in round-robin buckets; steer every frame.
+ @since		2017-11 Broke off from Sprites. */
 
 static const float ai_too_close = 3200.0f; /* pixel^(1/2) */
 static const float ai_too_far = 32000.0f; /* pixel^(1/2) */
@@ -15,6 +16,34 @@ static const float ai_turn = 0.2f; /* rad/ms */
 static const float ai_turn_constant = 10.0f;
 static const float ai_turn_sloppy = 0.4f; /* rad */
 static const int ai_speed = 15; /* pixel^2 / ms */
+/* Each AI {Ship} is due once every {AI_THINK_PERIOD} frames, in buckets by
+ it's index; no more than {ai_think_max} think in a frame, no matter how many
+ are due. Where they start in the ones that are due moves along every time the
+ bucket comes up, \see{ai_think}, so none are left out for good. */
+static const size_t ai_think_max = 256;
+/* Closer than this, the AI goes straight at the player instead of following
+ the flow field, \see{SpritesFlow.h}. */
+static const float ai_flow_close = (512.0f)*(512.0f); /* pixel^2 */
+
+/** Approximates {atan2f} to within about {2e-6} radians with an odd
+ polynomial of degree eleven in the octant; the AI doesn't need more. */
+static float fast_atan2f(const float y, const float x) {
+	const float ax = fabsf(x), ay = fabsf(y);
+	float a, s, r;
+	if(ax <= ay) {
+		if(ay <= 0.0f) return 0.0f;
+		a = ax / ay;
+	} else {
+		a = ay / ax;
+	}
+	s = a * a;
+	r = a * (0.99997726f + s * (-0.33262347f + s * (0.19354346f
+		+ s * (-0.11643287f + s * (0.05265332f + s * -0.01172120f)))));
+	if(ay > ax) r = 0.5f * M_PI_F - r;
+	if(x < 0.0f) r = M_PI_F - r;
+	if(y < 0.0f) r = -r;
+	return r;
+}
 
 /** This is used by AI and humans.
  @fixme Simplistic, shoot on frame. */
@@ -52,50 +81,67 @@ static void ship_input(struct Ship *const this, const int ms_turning,
 		this->ms_recharge_wmd = TimerGetGameTime() + this->wmd->ms_recharge;
 	}
 }
-/** Recharge on frame. */
-static void ship_recharge(struct Ship *const this) {
-	assert(sprites && this);
-	if(this->hit.x >= this->hit.y) return;
-	this->hit.x += this->recharge * sprites->dt_ms;
-	if(this->hit.x > this->hit.y) this->hit.x = this->hit.y;
-}
 /** @implements <Ship>Predicate */
 static int ship_update_human(struct Ship *const this) {
 	ship_input(this, -PollGetRight(), PollGetUp(), PollGetShoot());
-	ship_recharge(this);
 	return 1;
 }
-/** @implements <Ship>Predicate */
+/** Steers on every frame with what it decided the last time it thought; if
+ it's it's turn in the round-robin, it's queued to think in \see{ai_think}.
+ @implements <Ship>Predicate */
 static int ship_update_ai(struct Ship *const this) {
 	const struct Ship *const p = get_player();
-	struct Vec2f d;
-	float d_2, theta, t;
-	int ms_turning = 0, ms_acceleration = 0, ms_shoot = 0;
+	size_t i;
+	ship_input(this, this->ai.turning, this->ai.acceleration, this->ai.shoot);
 	if(!p) return 1; /* @fixme The player is the only reason for being! */
-	d.x = p->sprite.data.x.x - this->sprite.data.x.x,
-	d.y = p->sprite.data.x.y - this->sprite.data.x.y;
-	d_2   = d.x * d.x + d.y * d.y;
-	theta = atan2f(d.y, d.x);
-	/* {t} is the error of where wants vs where it's at. */
-	t = theta - this->sprite.data.x.theta;
-	branch_cut_pi_pi(&t);
-	/* too close; ai only does one thing at once, or else it would be hard */
-	if(d_2 < ai_too_close) { if(t < 0) t += M_PI_F; else t -= M_PI_F; }
-	/* turn */
-	if(t < -ai_turn || t > ai_turn) {
-		ms_turning = (int)(t * ai_turn_constant);
-		/*if(turning * dt_s fixme */
-		/*if(t < 0) {
-		 t += (float)M_PI_F;
-		 } else {
-		 t -= (float)M_PI_F;
-		 }*/
-	} else if(d_2 > ai_too_close && d_2 < ai_too_far) {
-		ms_shoot = 10.0f;
-	} else if(t > -ai_turn_sloppy && t < ai_turn_sloppy) {
-		ms_acceleration = ai_speed;
+	i = ShipPoolGetIndex(sprites->ships, this);
+	if((i + sprites->frame) % AI_THINK_PERIOD == 0) {
+		struct Think *const think = ThinkStackNew(sprites->thinks);
+		if(!think) return 1;
+		think->ship = i;
+		think->d.x = p->sprite.data.x.x - this->sprite.data.x.x;
+		think->d.y = p->sprite.data.x.y - this->sprite.data.x.y;
+		think->theta = this->sprite.data.x.theta;
 	}
-	ship_input(this, ms_turning, ms_acceleration, ms_shoot);
-	ship_recharge(this);
 	return 1;
 }
+
+/** Up to {ai_think_max} of the queued AI thinks at once over the packed
+ {thinks}, starting at the cursor of the bucket, which then moves past them;
+ the decisions are used on the next frames. Called after
+ \see{extrapolate_bin}. */
+static void ai_think(void) {
+	struct Think *const thinks = ThinkStackGetElement(sprites->thinks, 0);
+	const size_t size = ThinkStackGetSize(sprites->thinks);
+	size_t *const cursor
+		= sprites->think_cursor + sprites->frame % AI_THINK_PERIOD;
+	struct Think *think;
+	struct Ship *ship;
+	float d_2, t;
+	size_t i;
+	if(*cursor >= size) *cursor = 0;
+	for(i = 0; i < size && i < ai_think_max; i++) {
+		think = thinks + (*cursor + i) % size;
+		if(!(ship = ShipPoolGetElement(sprites->ships, think->ship))) continue;
+		d_2 = think->d.x * think->d.x + think->d.y * think->d.y;
+		/* {t} is the error of where wants vs where it's at; far away, the flow
+		 field goes around {Debris}. */
+		if(d_2 < ai_flow_close || !flow_get(ship->sprite.data.bin, &t))
+			t = fast_atan2f(think->d.y, think->d.x);
+		t -= think->theta;
+		branch_cut_pi_pi(&t);
+		ship->ai.turning = ship->ai.acceleration = ship->ai.shoot = 0;
+		/* too close; ai only does one thing at once, or else it would be
+		 hard */
+		if(d_2 < ai_too_close) { if(t < 0) t += M_PI_F; else t -= M_PI_F; }
+		if(t < -ai_turn || t > ai_turn) {
+			ship->ai.turning = (int)(t * ai_turn_constant);
+		} else if(d_2 > ai_too_close && d_2 < ai_too_far) {
+			ship->ai.shoot = 10;
+		} else if(t > -ai_turn_sloppy && t < ai_turn_sloppy) {
+			ship->ai.acceleration = ai_speed;
+		}
+	}
+	*cursor = size > ai_think_max ? (*cursor + ai_think_max) % size : 0;
+	ThinkStackClear(sprites->thinks);
+}
@@ -0,0 +1,456 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ Zones that have been visited recently are stored as compact {Record}s in a
+ least-recently-used cache when they are left, so that going back through a
+ {Gate} restores them instead of generating them from scratch. When a zone
+ falls out of the cache, it's spilled to a temporary file, if one can be
+ opened; after that, it's forgotten. The zone behind a {Gate} that the player
+ is near is made ahead of time, a slice per frame, all the way to sprites
+ waiting in {Bin.staged}, so crossing just links them into space,
+ \see{SpritesCacheStage}.
+
+ @title		SpritesCache
+ @author	Neil
+ @std		C89/90
+ @version	2018-01 Zone states; staging. */
+
+/* from Lore */
+extern const struct AutoShipClass auto_ship_class[];
+extern const int max_auto_ship_class;
+extern const struct AutoDebris auto_debris[];
+extern const int max_auto_debris;
+
+/* Number of {Record}s generated, then sprites made, per frame of staging. */
+static const size_t staging_slice = 256;
+
+/** Initialises the empty {cache}. */
+static void zone_cache(struct ZoneCache *const cache) {
+	unsigned i;
+	assert(cache);
+	cache->time = 0;
+	for(i = 0; i < ZONE_CACHE_SIZE; i++) {
+		cache->zones[i].zone = 0;
+		cache->zones[i].used = 0;
+		cache->zones[i].records = 0;
+	}
+	cache->spill = 0;
+	for(i = 0; i < ZONE_SPILL_SIZE; i++) {
+		cache->spills[i].zone = 0;
+		cache->spills[i].offset = 0;
+		cache->spills[i].size = 0;
+		cache->spills[i].capacity = 0;
+	}
+	cache->spill_next = 0;
+	cache->staging.zone = 0;
+	cache->staging.ship = 0;
+	cache->staging.debris = 0;
+	cache->staging.ships = cache->staging.debris_no = 0;
+	cache->staging.records = 0;
+	cache->staging.built = 0;
+}
+/** Destructor for {cache}; {tmpfile} is deleted when it's closed. */
+static void zone_cache_(struct ZoneCache *const cache) {
+	unsigned i;
+	assert(cache);
+	for(i = 0; i < ZONE_CACHE_SIZE; i++) RecordStack_(&cache->zones[i].records);
+	RecordStack_(&cache->staging.records);
+	if(cache->spill && fclose(cache->spill) == EOF) perror("zone spill");
+	zone_cache(cache);
+}
+
+/** @implements <Sprite, RecordStack>DiAction */
+static void record_sprite(struct Sprite *const sprite, void *const void_rs) {
+	struct RecordStack *const records = void_rs;
+	struct Record *r;
+	unsigned short class, type = (unsigned short)sprite->vt->class;
+	switch(sprite->vt->class) {
+		case SC_SHIP:
+			if((struct Ship *)sprite == get_player()) return;
+			class = (unsigned short)(((struct Ship *)sprite)->class
+				- auto_ship_class);
+			break;
+		case SC_DEBRIS:
+			class = (unsigned short)(((struct Debris *)sprite)->class
+				- auto_debris);
+			break;
+		default: return; /* {Wmd} are transient and {Gate} come from Lore. */
+	}
+	if(!(r = RecordStackNew(records))) { fprintf(stderr, "record_sprite: %s.\n",
+		RecordStackGetError(records)); return; }
+	r->class = class, r->type = type;
+	r->x  = sprite->x.x, r->y  = sprite->x.y, r->theta = sprite->x.theta;
+	r->vx = sprite->v.x, r->vy = sprite->v.y, r->omega = sprite->v.theta;
+	r->hit = type == SC_SHIP
+		? ship_shield((struct Ship *)sprite, TimerGetGameTime())
+		: ((struct Debris *)sprite)->energy;
+}
+
+/** Creates the sprite in {r}; if it's a {Ship}, it has {ai}.
+ @return The sprite or null. */
+static struct Sprite *record_restore(const struct Record *const r,
+	const enum AiType ai) {
+	struct Sprite *sprite = 0;
+	struct Ortho3f x, v;
+	assert(r);
+	x.x = r->x, x.y = r->y, x.theta = r->theta;
+	v.x = r->vx, v.y = r->vy, v.theta = r->omega;
+	switch(r->type) {
+		case SC_SHIP: {
+			struct Ship *ship;
+			if(r->class >= max_auto_ship_class || !(ship
+				= SpritesShip(auto_ship_class + r->class, &x, ai))) break;
+			ship->hit.x = r->hit;
+			ship->ms_hit = TimerGetGameTime();
+			sprite = &ship->sprite.data;
+		} break;
+		case SC_DEBRIS: {
+			struct Debris *debris;
+			if(r->class >= max_auto_debris || !(debris
+				= SpritesDebris(auto_debris + r->class, &x))) break;
+			debris->energy = r->hit;
+			sprite = &debris->sprite.data;
+		} break;
+		default: break;
+	}
+	if(!sprite) { fprintf(stderr, "record_restore: type %u class %u not "
+		"restored.\n", r->type, r->class); return 0; }
+	ortho3f_assign(&sprite->v, &v);
+	return sprite;
+}
+
+/** Forgets any spill of {zone}, leaving free space; it's live. */
+static void zone_forget(struct ZoneCache *const cache,
+	const struct AutoSpaceZone *const zone) {
+	unsigned i;
+	assert(cache && zone);
+	for(i = 0; i < ZONE_SPILL_SIZE; i++)
+		if(cache->spills[i].zone == zone) cache->spills[i].zone = 0;
+}
+
+/** Copies the spills to a new spill file, leaving out the space that was
+ given up in \see{zone_spill}; free space is dropped.
+ @return Success; otherwise, nothing has changed. */
+static int spill_compact(struct ZoneCache *const cache) {
+	struct Record chunk[64];
+	struct Spill *spill;
+	long offset[ZONE_SPILL_SIZE], end = 0;
+	size_t left, n;
+	unsigned i;
+	FILE *fp;
+	assert(cache && cache->spill);
+	if(!(fp = tmpfile())) { perror("zone spill"); return 0; }
+	for(i = 0; i < ZONE_SPILL_SIZE; i++) {
+		spill = cache->spills + i;
+		if(!spill->zone) continue;
+		if(fseek(cache->spill, spill->offset, SEEK_SET)) break;
+		for(left = spill->size; left; left -= n) {
+			n = left < sizeof chunk / sizeof *chunk
+				? left : sizeof chunk / sizeof *chunk;
+			if(fread(chunk, sizeof *chunk, n, cache->spill) != n
+				|| fwrite(chunk, sizeof *chunk, n, fp) != n) break;
+		}
+		if(left) break;
+		offset[i] = end;
+		end += (long)(sizeof *chunk * spill->size);
+	}
+	if(i < ZONE_SPILL_SIZE) {
+		perror("zone spill");
+		if(fclose(fp) == EOF) perror("zone spill");
+		return 0;
+	}
+	if(fclose(cache->spill) == EOF) perror("zone spill");
+	cache->spill = fp;
+	for(i = 0; i < ZONE_SPILL_SIZE; i++) {
+		spill = cache->spills + i;
+		if(spill->zone) spill->offset = offset[i], spill->capacity = spill->size;
+		else spill->capacity = 0;
+	}
+	return 1;
+}
+
+/** Writes the {Record}s in {cz} to the spill file, in the smallest free space
+ that fits, otherwise at the end. If there are no entries left, the oldest
+ spill is overwritten. When more than half the file has been given up, it's
+ compacted first. */
+static void zone_spill(struct ZoneCache *const cache,
+	const struct CachedZone *const cz) {
+	struct Spill *spill = 0, *s;
+	size_t size, kept = 0;
+	long end;
+	unsigned i;
+	assert(cache && cz && cz->zone);
+	if(!(size = RecordStackGetSize(cz->records))) return;
+	if(!cache->spill && !(cache->spill = tmpfile()))
+		{ perror("zone spill"); return; }
+	/* One spill per zone; the old one is free space. */
+	zone_forget(cache, cz->zone);
+	for(i = 0; i < ZONE_SPILL_SIZE; i++) {
+		s = cache->spills + i;
+		if(s->zone || s->capacity < size
+			|| (spill && spill->capacity <= s->capacity)) continue;
+		spill = s;
+	}
+	if(!spill) {
+		/* An unused entry, or else free space that's too small, or else the
+		 oldest spill. */
+		for(i = 0; i < ZONE_SPILL_SIZE && cache->spills[i].capacity; i++);
+		if(i >= ZONE_SPILL_SIZE)
+			for(i = 0; i < ZONE_SPILL_SIZE && cache->spills[i].zone; i++);
+		if(i >= ZONE_SPILL_SIZE) i = cache->spill_next++ % ZONE_SPILL_SIZE;
+		spill = cache->spills + i;
+		spill->zone = 0;
+	}
+	if(spill->capacity < size) {
+		/* Its space is given up; it goes at the end. */
+		spill->capacity = 0;
+		for(i = 0; i < ZONE_SPILL_SIZE; i++) kept += cache->spills[i].capacity;
+		if(fseek(cache->spill, 0l, SEEK_END)
+			|| (end = ftell(cache->spill)) == -1l)
+			{ perror("zone spill"); return; }
+		if((size_t)end > 2 * kept * sizeof(struct Record)
+			&& spill_compact(cache) && (fseek(cache->spill, 0l, SEEK_END)
+			|| (end = ftell(cache->spill)) == -1l))
+			{ perror("zone spill"); return; }
+		spill->offset = end, spill->capacity = size;
+	}
+	if(fseek(cache->spill, spill->offset, SEEK_SET)
+		|| fwrite(RecordStackGetElement(cz->records, 0),
+		sizeof(struct Record), size, cache->spill) != size)
+		{ perror("zone spill"); return; }
+	spill->zone = cz->zone, spill->size = size;
+}
+
+/** @return The spill of {zone} in {cache} or null. */
+static struct Spill *zone_spilled(struct ZoneCache *const cache,
+	const struct AutoSpaceZone *const zone) {
+	unsigned i;
+	assert(cache && zone);
+	if(!cache->spill) return 0;
+	for(i = 0; i < ZONE_SPILL_SIZE; i++)
+		if(cache->spills[i].zone == zone) return cache->spills + i;
+	return 0;
+}
+
+/** Reads {spill} into {records}; the spill is still there until it's
+ overwritten or \see{zone_forget}.
+ @return Success. */
+static int zone_unspill(struct ZoneCache *const cache,
+	const struct Spill *const spill, struct RecordStack *const records) {
+	struct Record *r;
+	size_t i;
+	assert(cache && cache->spill && spill && records);
+	if(!RecordStackReserve(records, spill->size)) { fprintf(stderr,
+		"zone unspill: %s.\n", RecordStackGetError(records)); return 0; }
+	if(fseek(cache->spill, spill->offset, SEEK_SET))
+		{ perror("zone unspill"); return 0; }
+	for(i = 0; i < spill->size; i++) {
+		r = RecordStackNew(records), assert(r);
+		if(fread(r, sizeof *r, 1, cache->spill) != 1)
+			{ perror("zone unspill"); RecordStackClear(records); return 0; }
+	}
+	return 1;
+}
+
+/** @return The slot in {cache} with {zone} or null. */
+static struct CachedZone *zone_cached(struct ZoneCache *const cache,
+	const struct AutoSpaceZone *const zone) {
+	unsigned i;
+	assert(cache && zone);
+	for(i = 0; i < ZONE_CACHE_SIZE; i++)
+		if(cache->zones[i].zone == zone) return cache->zones + i;
+	return 0;
+}
+
+/** @return An empty slot in {cache}, or else the least-recently-used, which
+ is spilled and emptied. */
+static struct CachedZone *zone_slot(struct ZoneCache *const cache) {
+	struct CachedZone *cz, *lru = cache->zones;
+	unsigned i;
+	assert(cache);
+	for(i = 0; i < ZONE_CACHE_SIZE; i++) {
+		cz = cache->zones + i;
+		if(!cz->zone) return cz;
+		if(cz->used < lru->used) lru = cz;
+	}
+	zone_spill(cache, lru);
+	lru->zone = 0;
+	return lru;
+}
+
+/** Saves the state of all the {Ship}s, except the player, and {Debris} as the
+ state of {zone}. Call before the sprites are cleared. */
+void SpritesCacheStore(const struct AutoSpaceZone *const zone) {
+	struct ZoneCache *cache;
+	struct CachedZone *cz;
+	unsigned i;
+	if(!sprites || !zone) return;
+	cache = &sprites->cache;
+	if(!(cz = zone_cached(cache, zone))) cz = zone_slot(cache);
+	cz->zone = 0;
+	if(!cz->records && !(cz->records = RecordStack()))
+		{ fprintf(stderr, "SpritesCacheStore: %s.\n",
+		RecordStackGetError(0)); return; }
+	RecordStackClear(cz->records);
+	for(i = 0; i < LAYER_SIZE; i++)
+		SpriteListBiForEach(&sprites->bins[i].sprites, &record_sprite,
+		cz->records);
+	cz->zone = zone;
+	cz->used = ++cache->time;
+}
+
+/** Deletes the sprites that are staged and forgets the staging. */
+static void staging_cancel(struct Staging *const staging) {
+	struct SpriteList *staged;
+	struct Sprite *s;
+	unsigned i;
+	assert(sprites && staging);
+	if(!staging->zone) return;
+	for(i = 0; i < LAYER_SIZE; i++) {
+		staged = &sprites->bins[i].staged;
+		while((s = SpriteListGetFirst(staged)))
+			SpriteListRemove(staged, s), s->vt->delete(s);
+	}
+	staging->zone = 0;
+	staging->ships = staging->debris_no = 0;
+	RecordStackClear(staging->records);
+	staging->built = 0;
+}
+
+/** @return Whether the {staging} zone is all sprites. */
+static int staging_is_ready(const struct Staging *const staging) {
+	assert(staging);
+	return staging->zone && !staging->ships && !staging->debris_no
+		&& staging->built == RecordStackGetSize(staging->records);
+}
+
+/** Generates up to {limit} {Record}s of {staging}, if it's being generated,
+ then makes up to {limit} of them into sprites in {Bin.staged}. Sprites are
+ made, so it must not be called while iterating over them. */
+static void staging_step(struct Staging *const staging, const size_t limit) {
+	struct Record *r;
+	struct Sprite *s;
+	struct Ortho3f x;
+	size_t n;
+	assert(sprites && staging);
+	if(!staging->zone) return;
+	for(n = 0; n < limit && (staging->ships || staging->debris_no); n++) {
+		if(!(r = RecordStackNew(staging->records))) { fprintf(stderr,
+			"staging: %s.\n", RecordStackGetError(staging->records));
+			staging->ships = staging->debris_no = 0; break; }
+		LayerSetRandom(sprites->layer, &x);
+		r->x = x.x, r->y = x.y, r->theta = x.theta;
+		r->vx = r->vy = r->omega = 0.0f;
+		if(staging->debris_no) {
+			staging->debris_no--;
+			r->type = SC_DEBRIS;
+			r->class = (unsigned short)(staging->debris - auto_debris);
+			r->hit = 0.0f;
+		} else {
+			staging->ships--;
+			r->type = SC_SHIP;
+			r->class = (unsigned short)(staging->ship - auto_ship_class);
+			r->hit = (float)staging->ship->shield;
+		}
+	}
+	if(n) return;
+	/* All the records are there; make them into sprites. */
+	for(n = 0; n < limit
+		&& staging->built < RecordStackGetSize(staging->records); n++) {
+		if(!(s = record_restore(RecordStackGetElement(staging->records,
+			staging->built++), AI_DUMB))) continue;
+		SpriteListRemove(&sprites->bins[s->bin].sprites, s);
+		SpriteListPush(&sprites->bins[s->bin].staged, s);
+	}
+}
+
+/** Does a slice of staging; called every frame in \see{SpritesUpdate} before
+ the sprites are iterated. */
+static void staging_update(void) {
+	staging_step(&sprites->cache.staging, staging_slice);
+}
+
+/** Restores the state of {zone}; if it's staged, the sprites are already made
+ and are just linked into space, otherwise it's restored from memory or a
+ spill.
+ @return True if {zone} was restored, otherwise it must be generated. */
+int SpritesCacheRestore(const struct AutoSpaceZone *const zone) {
+	struct ZoneCache *cache;
+	struct Staging *staging;
+	struct CachedZone *cz;
+	struct Spill *spill;
+	size_t i, size;
+	if(!sprites || !zone) return 0;
+	cache = &sprites->cache;
+	staging = &cache->staging;
+	if(staging->zone == zone) {
+		/* Finish it if the player was too fast. */
+		while(!staging_is_ready(staging)) staging_step(staging, (size_t)-1);
+		for(i = 0; i < LAYER_SIZE; i++) SpriteListTake(&sprites->bins[i]
+			.sprites, &sprites->bins[i].staged);
+		staging->zone = 0;
+		RecordStackClear(staging->records);
+		staging->built = 0;
+		/* It's live; what was cached is out-of-date. */
+		if((cz = zone_cached(cache, zone))) cz->zone = 0;
+		zone_forget(cache, zone);
+		return 1;
+	}
+	staging_cancel(staging);
+	if(!(cz = zone_cached(cache, zone))) {
+		/* Only make room if there's something to put in it. */
+		if(!(spill = zone_spilled(cache, zone))) return 0;
+		cz = zone_slot(cache);
+		if(!cz->records && !(cz->records = RecordStack())) return 0;
+		RecordStackClear(cz->records);
+		if(!zone_unspill(cache, spill, cz->records)) return 0;
+		zone_forget(cache, zone);
+		cz->zone = zone;
+	}
+	cz->used = ++cache->time;
+	size = RecordStackGetSize(cz->records);
+	for(i = 0; i < size; i++)
+		record_restore(RecordStackGetElement(cz->records, i), AI_DUMB);
+	return 1;
+}
+
+/** Starts making {zone} ahead of time; a slice is done every frame in
+ \see{SpritesUpdate}. If it's in the cache or spilled, it's made from that;
+ otherwise it's generated with {ships} of {ship} and {debris_no} of {debris}
+ in random places. When \see{SpritesCacheRestore} is called with {zone}, the
+ sprites are already made. Anything else that was staged is deleted.
+ @return True if {zone} is ready. */
+int SpritesCacheStage(const struct AutoSpaceZone *const zone,
+	const struct AutoShipClass *const ship, const unsigned ships,
+	const struct AutoDebris *const debris, const unsigned debris_no) {
+	struct ZoneCache *cache;
+	struct Staging *staging;
+	struct CachedZone *cz;
+	struct Spill *spill;
+	size_t i, size;
+	if(!sprites || !zone || !ship || !debris) return 0;
+	cache = &sprites->cache;
+	staging = &cache->staging;
+	if(staging->zone == zone) return staging_is_ready(staging);
+	staging_cancel(staging);
+	if(!staging->records && !(staging->records = RecordStack()))
+		{ fprintf(stderr, "SpritesCacheStage: %s.\n",
+		RecordStackGetError(0)); return 0; }
+	staging->zone = zone;
+	staging->ship = ship, staging->debris = debris;
+	/* It's copied; the cache could change before it's done. */
+	if((cz = zone_cached(cache, zone))) {
+		size = RecordStackGetSize(cz->records);
+		if(!RecordStackReserve(staging->records, size)) { fprintf(stderr,
+			"SpritesCacheStage: %s.\n", RecordStackGetError(staging->records));
+			staging->zone = 0; return 0; }
+		for(i = 0; i < size; i++) *RecordStackNew(staging->records)
+			= *RecordStackGetElement(cz->records, i);
+	} else if(!(spill = zone_spilled(cache, zone))
+		|| !zone_unspill(cache, spill, staging->records)) {
+		RecordStackClear(staging->records);
+		staging->ships = ships, staging->debris_no = debris_no;
+	}
+	return 0;
+}
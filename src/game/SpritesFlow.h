@@ -0,0 +1,146 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ This is included in \see{Sprites.c}. A flow field over the bins that points
+ the way to the player. It's a shortest-path tree, (Dial's algorithm, since
+ costs are small integers,) from the player's bin over the eight-connected
+ bins, where a bin with {Debris} in it costs more to go through. It's built a
+ slice of bins at a time across frames and replaces the old field when it's
+ done, so the cost is {O(bins)} spread out, and AI {Ship}s just look up the
+ direction in their bin. It's not built on {Workers}: Dial's algorithm settles
+ bins in order, each from the ones before, and the {Debris} costs are read from
+ the live bins, which {SpritesUpdate} is moving.
+
+ @title		SpritesFlow
+ @author	Neil
+ @std		C89/90
+ @version	2018-01 Flow towards the player. */
+
+/* Bins settled per frame. */
+static const unsigned flow_slice = 1024;
+/* Rebuild at least this often, in frames, to pick up moving {Debris}. */
+static const unsigned flow_period = 25;
+/* Straight and diagonal steps, approximately {1 : \sqrt{2}}. */
+static const unsigned flow_straight = 2, flow_diagonal = 3;
+/* The maximum {Debris} that add cost. */
+static const unsigned flow_max_occupancy = 7;
+
+/* Eight directions; {k} is at {k \pi / 4}. */
+static const int flow_dx[] = { 1, 1, 0, -1, -1, -1,  0,  1 },
+	flow_dy[] = { 0, 1, 1,  1,  0, -1, -1, -1 };
+
+/** Starts building the field towards {target}. */
+static void flow_start(struct Flow *const flow, const unsigned target) {
+	unsigned i;
+	assert(flow && target < LAYER_SIZE);
+	for(i = 0; i < LAYER_SIZE; i++) {
+		flow->dist[i] = (unsigned)-1;
+		flow->cost[i] = 0;
+		flow->build[i] = -1;
+	}
+	for(i = 0; i < FLOW_BUCKETS; i++) flow->head[i] = 0;
+	flow->current = 0;
+	flow->target = target;
+	flow->started = sprites->frame;
+	flow->is_building = 1;
+	flow->dist[target] = 0;
+	/* Entry zero is null. */
+	flow->entry[1].bin = (unsigned short)target, flow->entry[1].next = 0;
+	flow->entry_size = 2, flow->head[0] = 1, flow->pending = 1;
+}
+
+/** @implements <Sprite, unsigned>DiAction */
+static void flow_count_debris(struct Sprite *const sprite, void *const void_n) {
+	unsigned *const n = void_n;
+	if(sprite->vt->class == SC_DEBRIS) (*n)++;
+}
+
+/** @return The cost of going through {bin}, {[1, flow_max_occupancy + 1]}. */
+static unsigned flow_cost(struct Flow *const flow, const unsigned bin) {
+	unsigned n = 0;
+	assert(flow && bin < LAYER_SIZE);
+	if(flow->cost[bin]) return flow->cost[bin];
+	SpriteListBiForEach(&sprites->bins[bin].sprites, &flow_count_debris, &n);
+	if(n > flow_max_occupancy) n = flow_max_occupancy;
+	return flow->cost[bin] = (unsigned char)(n + 1);
+}
+
+/** Settles at most {slice} bins; when it runs out, the field is done. */
+static void flow_step(struct Flow *const flow, unsigned slice) {
+	struct FlowEntry *e;
+	unsigned short *head;
+	unsigned bin, x, y, k, n, d;
+	int nx, ny;
+	assert(flow && flow->is_building);
+	while(slice && flow->pending) {
+		head = flow->head + flow->current % FLOW_BUCKETS;
+		if(!*head) { flow->current++; continue; }
+		e = flow->entry + *head;
+		*head = e->next, flow->pending--;
+		bin = e->bin;
+		/* Stale entry; it's already been settled closer. */
+		if(flow->dist[bin] != flow->current) continue;
+		slice--;
+		x = bin % LAYER_SIDE_SIZE, y = bin / LAYER_SIDE_SIZE;
+		for(k = 0; k < 8; k++) {
+			nx = (int)x + flow_dx[k], ny = (int)y + flow_dy[k];
+			if(nx < 0 || nx >= LAYER_SIDE_SIZE
+				|| ny < 0 || ny >= LAYER_SIDE_SIZE) continue;
+			n = (unsigned)ny * LAYER_SIDE_SIZE + (unsigned)nx;
+			d = flow->current + flow_cost(flow, n)
+				* (k & 1 ? flow_diagonal : flow_straight);
+			if(d >= flow->dist[n]) continue;
+			assert(flow->entry_size < FLOW_ENTRIES);
+			flow->dist[n] = d;
+			/* From {n}, the way is back the way we came. */
+			flow->build[n] = (signed char)((k + 4) & 7);
+			e = flow->entry + flow->entry_size;
+			e->bin = (unsigned short)n;
+			e->next = flow->head[d % FLOW_BUCKETS];
+			flow->head[d % FLOW_BUCKETS]
+				= (unsigned short)flow->entry_size++;
+			flow->pending++;
+		}
+	}
+	if(flow->pending) return;
+	/* Done; this is the new field. */
+	memcpy(flow->dir, flow->build, sizeof flow->dir);
+	flow->is_building = 0;
+	flow->is_ready = 1;
+}
+
+/** Initialises {flow} to empty. */
+static void flow_init(struct Flow *const flow) {
+	unsigned i;
+	assert(flow);
+	flow->is_building = flow->is_ready = 0;
+	flow->target = 0;
+	flow->started = 0;
+	for(i = 0; i < LAYER_SIZE; i++) flow->dir[i] = -1;
+}
+
+/** Called every frame from \see{SpritesUpdate}; rebuilds a slice of the field
+ towards the player, restarting when they change bins or it's old. */
+static void flow_update(void) {
+	struct Flow *const flow = &sprites->flow;
+	const struct Ship *const player = get_player();
+	if(!player) return;
+	if(!flow->is_building && (!flow->is_ready
+		|| flow->target != player->sprite.data.bin
+		|| sprites->frame - flow->started >= flow_period))
+		flow_start(flow, player->sprite.data.bin);
+	if(flow->is_building) flow_step(flow, flow_slice);
+}
+
+/** Puts the direction from {bin} towards the player along the field in
+ {theta}.
+ @return True if there is a direction. */
+static int flow_get(const unsigned bin, float *const theta) {
+	const struct Flow *const flow = &sprites->flow;
+	int k;
+	assert(bin < LAYER_SIZE && theta);
+	if(!flow->is_ready || (k = flow->dir[bin]) < 0) return 0;
+	*theta = (float)k * 0.25f * M_PI_F;
+	return 1;
+}
@@ -4,14 +4,24 @@
 
  Lights are sent to the GPU for drawing. More accurately, lights are uploaded
  to the GPU every frame and every {Sprite} is affected by them in the shader.
+ There can be more lights than the shader has room for; every frame, they are
+ scored on how bright they are, how close to the screen, and how long they
+ have left, and only the best {MAX_LIGHTS} are uploaded.
 
  @title		SpritesLight
  @author	Neil
  @std		C89/90
- @version	2017-12 Joined from {Light.c}; sprites associated with lights.
+ @version	2018-02 Budget.
+ 			2017-12 Joined from {Light.c}; sprites associated with lights.
  			2016-01 Lights are [awkward] objects.
  @since		2000 Brute force. */
 
+/* A light reaches as far as it's brightest channel times this; must match
+ the threshold in \see{Draw.c}. */
+static const float light_reach = 10.0f;
+/* Lights that expire fade out of the budget over the last this many ms. */
+static const float light_fade_ms = 250.0f;
+
 /** Deletes the light. */
 static void Light_(struct Light *const light) {
 	struct Lights *const lights = &sprites->lights;
@@ -24,35 +34,47 @@ static void Light_(struct Light *const light) {
 	/* Take the last light and replace this one. */
 	if(no < (r = lights->size - 1)) {
 		memcpy(light, lights->light_table + r, sizeof *light);
-		memcpy(lights->x_table + no, lights->x_table + r,
-			sizeof *lights->x_table);
-		memcpy(lights->colour_table + no, lights->colour_table + r,
-			sizeof *lights->colour_table);
 		assert(light->sprite && light->sprite->light == lights->light_table +r);
 		light->sprite->light = lights->light_table + no;
 	}
+	lights->light_table[r].sprite = 0;
 	sprites->lights.size--;
 }
-/** @return True if the light was created.
- @fixme Have some random picks to replace if the capacity is full. */
+/** @return The light that has the lowest score on the last budget. */
+static struct Light *light_weakest(void) {
+	struct Lights *const lights = &sprites->lights;
+	struct Light *light, *weakest = 0;
+	size_t i;
+	for(i = 0; i < lights->size; i++) {
+		light = lights->light_table + i;
+		if(!weakest || light->score < weakest->score) weakest = light;
+	}
+	return weakest;
+}
+/** Associates a light with {sprite}. If there are already
+ {MAX_LOGICAL_LIGHTS}, the weakest light gets replaced.
+ @param expires: The game time that the light's sprite expires, or zero for
+ never; a light that's about to expire is worth less.
+ @return True if the light was created. */
 static int Light(struct Sprite *const sprite,
-	const float r, const float g, const float b) {
+	const float r, const float g, const float b, const unsigned expires) {
 	struct Lights *const lights = &sprites->lights;
 	struct Light *this;
-	struct Vec2f *x;
-	struct Colour3f *colour;
-	size_t l;
 	assert(sprites && sprite && r >= 0.0f && g >= 0.0f && b >= 0.0f);
 	if(sprite->light) return 0; /* Already associated with a light. */
-	if(lights->size >= MAX_LIGHTS)
-		return fprintf(stderr, "light: capacity.\n"), 0;
-	l = lights->size++;
-	this = lights->light_table + l;
+	if(lights->size >= MAX_LOGICAL_LIGHTS) {
+		struct Light *const weakest = light_weakest();
+		assert(weakest && weakest->sprite);
+		weakest->sprite->light = 0;
+		Light_(weakest);
+	}
+	this = lights->light_table + lights->size++;
 	this->sprite = sprite, sprite->light = this;
-	x = lights->x_table + l;
-	colour = lights->colour_table + l;
-	x->x = 0.0f, x->y = 0.0f;
-	colour->r = r, colour->g = g, colour->b = b;
+	this->colour.r = r, this->colour.g = g, this->colour.b = b;
+	this->expires = expires;
+	/* Until the next budget, it's as good as it can be, so it's not the next
+	 one to be replaced. */
+	this->score = FLT_MAX;
 	return 1;
 }
 /** Delete all lights. */
@@ -66,29 +88,105 @@ void SpritesLightClear(void) {
 	for(i = 0; i < *psize; i++) {
 		assert(light[i].sprite);
 		light[i].sprite->light = 0;
+		light[i].sprite = 0;
 	}
 	*psize = 0;
+	sprites->lights.budget_size = 0;
+}
+
+/** Scores {light} for how much it would add to the screen {rect}.
+ @return Zero if it can't be seen. */
+static float light_score(const struct Light *const light,
+	const struct Rectangle4f *const rect, const unsigned now) {
+	const struct Colour3f *const c = &light->colour;
+	const struct Vec2f *const x = (struct Vec2f *)&light->sprite->x;
+	float bright, reach, dx, dy, d, score;
+	bright = c->r > c->g ? c->r : c->g;
+	if(c->b > bright) bright = c->b;
+	if((reach = bright * light_reach) <= 0.0f) return 0.0f;
+	/* Distance from the screen; zero if it's on the screen. */
+	dx = x->x < rect->x_min ? rect->x_min - x->x
+		: x->x > rect->x_max ? x->x - rect->x_max : 0.0f;
+	dy = x->y < rect->y_min ? rect->y_min - x->y
+		: x->y > rect->y_max ? x->y - rect->y_max : 0.0f;
+	if(dx >= reach || dy >= reach) return 0.0f;
+	if((d = sqrtf(dx * dx + dy * dy)) >= reach) return 0.0f;
+	score = bright * (1.0f - d / reach);
+	/* Expiring; compare modulo time. */
+	if(light->expires) {
+		const int left = (int)(light->expires - now);
+		if(left <= 0) return 0.0f;
+		if((float)left < light_fade_ms) score *= (float)left / light_fade_ms;
+	}
+	return score;
 }
+/** Partially sorts {budget} between {lo} and {hi} so that the highest
+ {MAX_LIGHTS} lights, by score, are first; quick-select with Hoare's
+ partition. The pivot is never the last, so {j} is always in {[lo, hi - 1)}
+ and the range always gets smaller. */
+static void light_select(unsigned short *const budget, size_t lo, size_t hi) {
+	const struct Light *const table = sprites->lights.light_table;
+	const size_t k = MAX_LIGHTS;
+	size_t i, j;
+	unsigned short temp;
+	float pivot;
+	while(lo + 1 < hi) {
+		pivot = table[budget[lo + (hi - lo - 1) / 2]].score;
+		i = lo, j = hi - 1;
+		for( ; ; ) {
+			while(table[budget[i]].score > pivot) i++;
+			while(table[budget[j]].score < pivot) j--;
+			if(i >= j) break;
+			temp = budget[i], budget[i] = budget[j], budget[j] = temp;
+			i++, j--;
+		}
+		/* [lo, j] >= pivot >= [j + 1, hi). */
+		if(k <= j) hi = j + 1; else if(k > j + 1) lo = j + 1; else break;
+	}
+}
+/** Scores all the lights and picks the ones that are going to be uploaded to
+ the GPU. */
+static void light_budget(void) {
+	struct Lights *const lights = &sprites->lights;
+	struct Rectangle4f rect;
+	const unsigned now = TimerGetGameTime();
+	struct Light *light;
+	size_t i, candidates = 0;
+	DrawGetScreen(&rect);
+	for(i = 0; i < lights->size; i++) {
+		light = lights->light_table + i;
+		assert(light->sprite);
+		if((light->score = light_score(light, &rect, now)) <= 0.0f) continue;
+		lights->budget[candidates++] = (unsigned short)i;
+	}
+	if(candidates > MAX_LIGHTS)
+		light_select(lights->budget, 0, candidates), candidates = MAX_LIGHTS;
+	lights->budget_size = candidates;
+}
+/** @return The number of lights that are in the tables that are uploaded,
+ set by \see{SpritesLightPositions}. */
 size_t SpritesLightGetSize(void) {
 	if(!sprites) return 0;
-	return sprites->lights.size;
+	return sprites->lights.budget_size;
 }
+/** Picks the best lights for this frame and fills the tables; call this first.
+ @return The positions of the lights picked. */
 struct Vec2f *SpritesLightPositions(void) {
-	struct Light *lights, *light;
-	struct Vec2f *xs, *x;
-	size_t i, size;
+	struct Lights *lights;
+	struct Light *light;
+	size_t i;
 	if(!sprites) return 0;
-	size = sprites->lights.size;
-	lights = sprites->lights.light_table;
-	xs = sprites->lights.x_table;
-	for(i = 0; i < size; i++) {
-		x = xs + i;
-		light = lights + i;
-		x->x = light->sprite->x.x;
-		x->y = light->sprite->x.y;
+	lights = &sprites->lights;
+	light_budget();
+	for(i = 0; i < lights->budget_size; i++) {
+		light = lights->light_table + lights->budget[i];
+		lights->x_table[i].x = light->sprite->x.x;
+		lights->x_table[i].y = light->sprite->x.y;
+		lights->colour_table[i] = light->colour;
 	}
-	return xs;
+	return lights->x_table;
 }
+/** @return The colours of the lights picked by \see{SpritesLightPositions}. */
 struct Colour3f *SpritesLightGetColours(void) {
 	if(!sprites) return 0;
 	return sprites->lights.colour_table;
@@ -1,134 +1,216 @@
-/* This is a debug thing; outputs data in Gnuplot form. */
+/* This is a debug thing; streams the sprites to a file in binary, frame by
+ frame, without stalling. A frame is copied into memory on the frame it
+ happens, and the file is written a slice per frame; if the writing falls
+ behind, frames are dropped. {tools/Telemetry2gnu} turns the file into
+ Gnuplot. */
 
-/* This is for communication with {sprite_data}, {sprite_arrow},
- {sprite_velocity}, and {gnu_draw_bins} for outputting a gnu plot. */
-struct PlotData {
-	FILE *fp;
-	unsigned i, n, object, bin;
-	const char *colour;
+/* Must be the same as in {Telemetry2gnu}. */
+static const char telemetry_magic[8]
+	= { 'V', 'o', 'i', 'd', 'T', 'e', 'l', 'e' };
+static const unsigned telemetry_version = 1;
+static const char *const telemetry_fn = "Space.telemetry";
+/* Bytes written per frame. */
+static const size_t telemetry_slice = 0x40000;
+/* Frames are dropped if there's more than this waiting. */
+static const size_t telemetry_max = 0x4000000;
+
+/** Starts the file. */
+struct TelemetryHeader {
+	char magic[8];
+	unsigned version, frame_size, sprite_size, cover_size;
+};
+/** Starts each frame; followed by {sprites} {TelemetrySprite}, {covers}
+ {TelemetryCover}, and {bins} {unsigned}, the bins that are on screen. */
+struct TelemetryFrame {
+	unsigned frame, ms, dropped, sprites, covers, bins;
+	float dt_ms;
 };
-/** @implements <Sprite, OutputData>DiAction */
-static void sprite_count(struct Sprite *sprite, void *const void_out) {
-	struct PlotData *const out = void_out;
-	UNUSED(sprite);
-	out->n++;
+struct TelemetrySprite {
+	float x, y, bounding, vx, vy;
+	unsigned short class; /* {SpriteClass} */
+	unsigned short bin;
+};
+/** A sprite that is in a bin other than it's own, (overlapping.) */
+struct TelemetryCover {
+	float x, y;
+	unsigned short bin, is_corner;
+};
+
+/** Adds {size} uninitialised bytes to {b}.
+ @return The bytes or null if there was an error. */
+static void *telemetry_buffer_new(struct TelemetryBuffer *const b,
+	const size_t size) {
+	void *data;
+	assert(b);
+	if(b->size + size > b->capacity) {
+		size_t c = b->capacity ? b->capacity : 0x10000;
+		unsigned char *d;
+		while(c < b->size + size) c <<= 1;
+		if(!(d = realloc(b->data, c))) return perror("telemetry"), (void *)0;
+		b->data = d, b->capacity = c;
+	}
+	data = b->data + b->size;
+	b->size += size;
+	return data;
 }
-/** @implements <Sprite, OutputData>DiAction */
-static void print_sprite_data(struct Sprite *sprite, void *const void_out) {
-	struct PlotData *const out = void_out;
-	char a[12];
-	sprite_to_string(sprite, &a);
-	fprintf(out->fp, "%f\t%f\t%f\t%f\t%f\t%f\t%f\t\"%s\"\n",
-		sprite->x.x, sprite->x.y,
-		sprite->bounding, (double)out->i++ / out->n, sprite->x.x, sprite->x.y,
-		sprite->bounding, a);
+
+/* This is for communication with {telemetry_sprite}, {telemetry_cover}, and
+ {telemetry_bin}. */
+struct PlotData {
+	struct TelemetryBuffer *buffer;
+	struct TelemetryFrame *frame;
+	size_t frame_offset;
+	unsigned bin;
+	int is_error;
+};
+/** @return The frame; it may move when the buffer grows. */
+static struct TelemetryFrame *plot_frame(struct PlotData *const plot) {
+	return (struct TelemetryFrame *)(void *)(plot->buffer->data
+		+ plot->frame_offset);
 }
-/** @implements <Sprite, OutputData>DiAction */
-static void print_sprite_velocity(struct Sprite *sprite, void *const void_out) {
-	struct PlotData *const out = void_out;
-	fprintf(out->fp, "set arrow from %f,%f to %f,%f lw 1 lc rgb \"blue\" "
-		"front;\n", sprite->x.x, sprite->x.y,
-		sprite->x.x + sprite->v.x * sprites->dt_ms * 256.0f,
-		sprite->x.y + sprite->v.y * sprites->dt_ms * 256.0f);
+/** @implements <Sprite, PlotData>DiAction */
+static void telemetry_sprite(struct Sprite *sprite, void *const void_plot) {
+	struct PlotData *const plot = void_plot;
+	struct TelemetrySprite *t;
+	if(plot->is_error) return;
+	if(!(t = telemetry_buffer_new(plot->buffer, sizeof *t)))
+		{ plot->is_error = 1; return; }
+	t->x = sprite->x.x, t->y = sprite->x.y, t->bounding = sprite->bounding;
+	t->vx = sprite->v.x, t->vy = sprite->v.y;
+	t->class = (unsigned short)sprite->vt->class;
+	t->bin = (unsigned short)sprite->bin;
+	plot_frame(plot)->sprites++;
 }
 /* @implements <Cover>BiAction */
-static void sprite_to_bin(struct Cover *const this, void *const plot_void) {
-	struct PlotData *const plot = plot_void;
+static void telemetry_cover(struct Cover *const this, void *const void_plot) {
+	struct PlotData *const plot = void_plot;
+	struct TelemetryCover *t;
 	struct Sprite *s;
-	struct Vec2f to = { 0.0f, 0.0f };
-	assert(this && this->onscreen && plot_void);
-	if(!(s = this->onscreen->sprite)) return;
-	LayerGetBinMarker(sprites->layer, plot->bin, &to);
-	to.x += 50.0f, to.y += 50.0f;
-	fprintf(plot->fp, "set arrow from %f,%f to %f,%f lw 1 lc rgb \"%s\" "
-		"front;\n", s->x.x, s->x.y, to.x, to.y,
-		this->is_corner ? "red" : "pink");
+	assert(this && this->onscreen && plot);
+	if(plot->is_error || !(s = this->onscreen->sprite)) return;
+	if(!(t = telemetry_buffer_new(plot->buffer, sizeof *t)))
+		{ plot->is_error = 1; return; }
+	t->x = s->x.x, t->y = s->x.y;
+	t->bin = (unsigned short)plot->bin;
+	t->is_corner = (unsigned short)!!this->is_corner;
+	plot_frame(plot)->covers++;
 }
 /* @implements LayerAcceptPlot */
-static void sprite_to_bin_bin(const unsigned idx, struct PlotData *const plot) {
+static void telemetry_bin_covers(const unsigned idx,
+	struct PlotData *const plot) {
 	assert(sprites && plot);
 	plot->bin = idx;
-	CoverStackBiForEach(sprites->bins[idx].covers, &sprite_to_bin, plot);
+	CoverStackBiForEach(sprites->bins[idx].covers, &telemetry_cover, plot);
+}
+/* @implements LayerAcceptPlot */
+static void telemetry_bin(const unsigned idx, struct PlotData *const plot) {
+	unsigned *t;
+	assert(sprites && plot);
+	if(plot->is_error) return;
+	if(!(t = telemetry_buffer_new(plot->buffer, sizeof *t)))
+		{ plot->is_error = 1; return; }
+	*t = idx;
+	plot_frame(plot)->bins++;
 }
-/** Draws squares for highlighting bins. Called in \see{space_plot}.
- @implements LayerAcceptPlot */
-static void gnu_shade_bins(const unsigned bin, struct PlotData *const plot) {
-	struct Vec2f marker = { 0.0f, 0.0f };
-	assert(plot && sprites && bin < LAYER_SIZE);
-	LayerGetBinMarker(sprites->layer, bin, &marker);
-	fprintf(plot->fp, "# bin %u -> %.1f,%.1f\n", bin, marker.x, marker.y);
-	fprintf(plot->fp, "set object %u rect from %f,%f to %f,%f fc rgb \"%s\" "
-		"fs transparent pattern 4 noborder;\n", plot->object++,
-		marker.x, marker.y, marker.x + 256.0f, marker.y + 256.0f, plot->colour);
+
+/** Copies the current frame into memory. */
+static void telemetry_capture(void) {
+	struct Telemetry *const tel = &sprites->telemetry;
+	struct PlotData plot;
+	struct TelemetryFrame *frame;
+	unsigned i;
+	assert(tel->fp);
+	if(tel->capture.size + tel->flush.size - tel->flushed > telemetry_max)
+		{ tel->dropped++; return; }
+	plot.buffer = &tel->capture;
+	plot.frame_offset = tel->capture.size;
+	plot.is_error = 0;
+	if(!(frame = telemetry_buffer_new(&tel->capture, sizeof *frame))) return;
+	frame->frame = sprites->frame;
+	frame->ms = TimerGetGameTime();
+	frame->dropped = tel->dropped;
+	frame->sprites = frame->covers = frame->bins = 0;
+	frame->dt_ms = sprites->dt_ms;
+	for(i = 0; i < LAYER_SIZE; i++) SpriteListBiForEach(&sprites->bins[i]
+		.sprites, &telemetry_sprite, &plot);
+	LayerForEachScreenPlot(sprites->layer, &telemetry_bin_covers, &plot);
+	LayerForEachScreenPlot(sprites->layer, &telemetry_bin, &plot);
+	/* Leave out the partial frame. */
+	if(plot.is_error) { tel->capture.size = plot.frame_offset; return; }
+	tel->frames++;
 }
 
-/** Debugging plot.
- @implements Action */
-static void space_plot(void) {
-	FILE *data = 0, *gnu = 0;
-	const char *data_fn = "Space.data", *gnu_fn = "Space.gnu",
-		*eps_fn = "Space.eps";
-	enum { E_NO, E_DATA, E_GNU } e = E_NO;
-	assert(sprites);
-	fprintf(stderr, "Will output %s at the current time, and a gnuplot script, "
-		"%s of the current sprites.\n", data_fn, gnu_fn);
+/** Writes a slice of what's been captured. If {is_all}, writes everything. */
+static void telemetry_flush(const int is_all) {
+	struct Telemetry *const tel = &sprites->telemetry;
+	size_t size;
+	assert(tel->fp);
 	do {
-		struct PlotData plot;
-		unsigned i;
-		if(!(data = fopen(data_fn, "w"))) { e = E_DATA; break; }
-		if(!(gnu = fopen(gnu_fn, "w")))   { e = E_GNU;  break; }
-		plot.fp = data, plot.i = 0; plot.n = 0;
-		for(i = 0; i < LAYER_SIZE; i++)
-			SpriteListBiForEach(&sprites->bins[i].sprites, &sprite_count,&plot);
-		for(i = 0; i < LAYER_SIZE; i++)
-			SpriteListBiForEach(&sprites->bins[i].sprites, &print_sprite_data,
-			&plot);
-		fprintf(gnu, "set term postscript eps enhanced size 256cm, 256cm\n"
-			"set output \"%s\"\n"
-			"set size square;\n"
-			"set palette defined (1 \"#0000FF\", 2 \"#00FF00\", 3 \"#FF0000\");"
-			"\n"
-			"set xtics 256 rotate; set ytics 256;\n"
-			"set grid;\n"
-			"set xrange [-8192:8192];#[-2048:2048];\n"
-			"set yrange [-8192:8192];#[-2048:2048];\n"
-			"set cbrange [0.0:1.0];\n", eps_fn);
-		/* draw bins as squares behind */
-		fprintf(gnu, "set style fill transparent solid 0.3 noborder;\n");
-		plot.fp = gnu, plot.colour = "#ADD8E6", plot.object = 1;
-		LayerForEachScreenPlot(sprites->layer, &gnu_shade_bins, &plot);
-		/*col.fp = gnu, col.colour = "#D3D3D3";
-		BinPoolBiForEach(update_bins, &gnu_shade_bins, &col);*/
-		/* draw arrows from each of the sprites to their bins */
-		plot.fp = gnu, plot.i = 0;
-		for(i = 0; i < LAYER_SIZE; i++)
-			SpriteListBiForEach(&sprites->bins[i].sprites,
-			&print_sprite_velocity, &plot);
-		LayerForEachScreenPlot(sprites->layer, &sprite_to_bin_bin, &plot);
-		/* draw the sprites */
-		fprintf(gnu, "plot \"%s\" using 5:6:7 with circles \\\n"
-			"linecolor rgb(\"#00FF00\") fillstyle transparent "
-			"solid 1.0 noborder title \"Velocity\", \\\n"
-			"\"%s\" using 1:2:3:4 with circles \\\n"
-			"linecolor palette fillstyle transparent solid 0.3 noborder \\\n"
-			"title \"Sprites\", \\\n"
-			"\"%s\" using 1:2:8 with labels notitle;\n",
-			data_fn, data_fn, data_fn);
-	} while(0); switch(e) {
-		case E_NO: break;
-		case E_DATA: perror(data_fn); break;
-		case E_GNU:  perror(gnu_fn);  break;
-	} {
-		if(fclose(data) == EOF) perror(data_fn);
-		if(fclose(gnu)  == EOF) perror(gnu_fn);
+		/* Done writing; write what's been captured since. */
+		if(tel->flushed >= tel->flush.size) {
+			struct TelemetryBuffer swap = tel->flush;
+			tel->flush = tel->capture, tel->capture = swap;
+			tel->capture.size = 0, tel->flushed = 0;
+			if(!tel->flush.size) return;
+		}
+		size = tel->flush.size - tel->flushed;
+		if(!is_all && size > telemetry_slice) size = telemetry_slice;
+		if(fwrite(tel->flush.data + tel->flushed, 1, size, tel->fp) != size)
+			{ perror(telemetry_fn); tel->flushed = tel->flush.size; return; }
+		tel->flushed += size;
+	} while(is_all);
+}
+
+/** Called every frame while recording, after the covers are set. */
+static void telemetry_update(void) {
+	telemetry_capture();
+	telemetry_flush(0);
+}
+
+/** Initialises the telemetry to not recording. */
+static void telemetry(struct Telemetry *const tel) {
+	assert(tel);
+	tel->fp = 0;
+	tel->capture.data = 0, tel->capture.size = tel->capture.capacity = 0;
+	tel->flush.data = 0, tel->flush.size = tel->flush.capacity = 0;
+	tel->flushed = 0;
+	tel->frames = tel->dropped = 0;
+}
+
+/** Stops recording, writing everything that's waiting. */
+static void telemetry_(void) {
+	struct Telemetry *const tel = &sprites->telemetry;
+	if(tel->fp) {
+		telemetry_flush(1);
+		if(fclose(tel->fp) == EOF) perror(telemetry_fn);
+		fprintf(stderr, "Telemetry: %s closed, %u frames, %u dropped.\n",
+			telemetry_fn, tel->frames, tel->dropped);
 	}
+	free(tel->capture.data);
+	free(tel->flush.data);
+	telemetry(tel);
 }
 
-/** Sets a flag that indicates the space should be plotted on the next frame. */
+/** Starts or stops streaming the sprites to a file every frame. */
 void SpritesPlotSpace(void) {
+	struct TelemetryHeader header;
+	struct Telemetry *tel;
 	if(!sprites) return;
-	sprites->plots |= PLOT_SPACE;
-	EventsRunnable(0, &TimerPause); /* Delay this until it has time to plot. */
+	tel = &sprites->telemetry;
+	if(tel->fp) { telemetry_(); return; }
+	memcpy(header.magic, telemetry_magic, sizeof header.magic);
+	header.version = telemetry_version;
+	header.frame_size = sizeof(struct TelemetryFrame);
+	header.sprite_size = sizeof(struct TelemetrySprite);
+	header.cover_size = sizeof(struct TelemetryCover);
+	if(!(tel->fp = fopen(telemetry_fn, "wb"))
+		|| fwrite(&header, sizeof header, 1, tel->fp) != 1) {
+		perror(telemetry_fn);
+		if(tel->fp) fclose(tel->fp), tel->fp = 0;
+		return;
+	}
+	fprintf(stderr, "Telemetry: streaming to %s; again to stop.\n",
+		telemetry_fn);
 }
 
 /* THIS IS OLD CODE */
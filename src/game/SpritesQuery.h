@@ -0,0 +1,154 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ This is included in \see{Sprites.c}. Neighbour queries; what is near a point
+ filtered by {SpriteClass}. They look directly in the {bins}, so they don't
+ need the {covers} and work off-screen; the cost is proportional to the bins
+ that are touched.
+
+ @title		SpritesQuery
+ @author	Neil
+ @std		C89/90
+ @version	2018-01 Nearest, within, and cone. */
+
+/* Maximum {k} for \see{SpritesNearest}. */
+#define QUERY_MAX (64)
+
+/** This is for communication with {query_sprite} from the {Layer}. */
+struct Query {
+	struct Vec2f x, dir;
+	float r2, cos, cos2;
+	int is_cone, is_sorted;
+	unsigned classes;
+	const struct Sprite *except;
+	struct Sprite **result;
+	float d2[QUERY_MAX]; /* if {is_sorted} */
+	size_t size, capacity;
+};
+
+/** Puts {sprite} in the {query} if it matches.
+ @implements <Sprite, Query>DiAction */
+static void query_sprite(struct Sprite *const sprite, void *const void_query) {
+	struct Query *const q = void_query;
+	struct Vec2f d;
+	float d2, dot;
+	size_t i;
+	assert(sprite && q);
+	if(sprite == q->except || !(q->classes & (1u << sprite->vt->class)))
+		return;
+	d.x = sprite->x.x - q->x.x, d.y = sprite->x.y - q->x.y;
+	if((d2 = d.x * d.x + d.y * d.y) > q->r2) return;
+	if(q->is_cone) {
+		/* {dot >= cos |d|} without the square root. */
+		dot = d.x * q->dir.x + d.y * q->dir.y;
+		if(q->cos >= 0.0f ? dot < 0.0f || dot * dot < d2 * q->cos2
+			: dot < 0.0f && dot * dot > d2 * q->cos2) return;
+	}
+	if(!q->is_sorted) {
+		if(q->size < q->capacity) q->result[q->size++] = sprite;
+		return;
+	}
+	/* Insertion into the sorted {k}; {k} is small. */
+	if(q->size >= q->capacity) {
+		if(d2 >= q->d2[q->capacity - 1]) return;
+		i = q->capacity - 1;
+	} else {
+		i = q->size++;
+	}
+	for( ; i && q->d2[i - 1] > d2; i--)
+		q->result[i] = q->result[i - 1], q->d2[i] = q->d2[i - 1];
+	q->result[i] = sprite, q->d2[i] = d2;
+}
+/** @implements LayerAcceptQuery */
+static void query_bin(const unsigned bin, struct Query *const query) {
+	assert(sprites && bin < LAYER_SIZE && query);
+	SpriteListBiForEach(&sprites->bins[bin].sprites, &query_sprite, query);
+}
+
+/** Initialises {q} for a query. */
+static void query(struct Query *const q, const float x, const float y,
+	const float radius, const unsigned classes,
+	const struct Sprite *const except, struct Sprite **const result,
+	const size_t result_size) {
+	assert(q);
+	q->x.x = x, q->x.y = y;
+	q->dir.x = 1.0f, q->dir.y = 0.0f;
+	q->r2 = radius * radius;
+	q->cos = q->cos2 = 0.0f;
+	q->is_cone = q->is_sorted = 0;
+	q->classes = classes;
+	q->except = except;
+	q->result = result;
+	q->size = 0;
+	q->capacity = result_size;
+}
+/** Bounding rectangle of the query. */
+static void query_rectangle(const struct Query *const q, const float radius,
+	struct Rectangle4f *const rect) {
+	assert(q && rect);
+	rect->x_min = q->x.x - radius, rect->x_max = q->x.x + radius;
+	rect->y_min = q->x.y - radius, rect->y_max = q->x.y + radius;
+}
+
+/** Up to {k} of the nearest sprites to {x} in the {classes}, which are
+ {SpriteClassFlags}, except {except}, (which can be null,) within {radius}.
+ Searches rings of bins outwards until no closer sprite is possible.
+ @param result: An array of at least {k}; sorted nearest first.
+ @return The number found, {[0, k]}. */
+size_t SpritesNearest(const struct Vec2f *const x, const float radius,
+	const unsigned classes, const struct Sprite *const except,
+	struct Sprite **const result, size_t k) {
+	struct Query q;
+	float reach;
+	unsigned ring;
+	if(!sprites || !x || !result || !k) return 0;
+	if(k > QUERY_MAX) k = QUERY_MAX;
+	query(&q, x->x, x->y, radius, classes, except, result, k);
+	q.is_sorted = 1;
+	for(ring = 0; LayerForEachRingQuery(sprites->layer, x, ring, &query_bin,
+		&q); ring++) {
+		/* Everything in the next ring is at least this far. */
+		reach = ring * layer_space, reach *= reach;
+		if(reach > q.r2 || (q.size >= k && q.d2[k - 1] <= reach)) break;
+	}
+	return q.size;
+}
+
+/** Sprites within {radius} of {x}. The order is by bin, not distance.
+ @param result: An array of at least {result_size}.
+ @return The number found, {[0, result_size]}; more are ignored. */
+size_t SpritesWithin(const struct Vec2f *const x, const float radius,
+	const unsigned classes, const struct Sprite *const except,
+	struct Sprite **const result, const size_t result_size) {
+	struct Query q;
+	struct Rectangle4f rect;
+	if(!sprites || !x || !result) return 0;
+	query(&q, x->x, x->y, radius, classes, except, result, result_size);
+	query_rectangle(&q, radius, &rect);
+	LayerForEachRectangleQuery(sprites->layer, &rect, &query_bin, &q);
+	return q.size;
+}
+
+/** Sprites within {radius} of {x} and within {half_angle} of {x.theta}; eg,
+ what's in front of a {Ship}. A {half_angle} of {\pi} or more is the whole
+ circle.
+ @param result: An array of at least {result_size}.
+ @return The number found, {[0, result_size]}; more are ignored. */
+size_t SpritesCone(const struct Ortho3f *const x, const float radius,
+	const float half_angle, const unsigned classes,
+	const struct Sprite *const except, struct Sprite **const result,
+	const size_t result_size) {
+	struct Query q;
+	struct Rectangle4f rect;
+	if(!sprites || !x || !result || half_angle < 0.0f) return 0;
+	query(&q, x->x, x->y, radius, classes, except, result, result_size);
+	if(half_angle < M_PI_F) {
+		q.is_cone = 1;
+		q.dir.x = cosf(x->theta), q.dir.y = sinf(x->theta);
+		q.cos = cosf(half_angle), q.cos2 = q.cos * q.cos;
+	}
+	query_rectangle(&q, radius, &rect);
+	LayerForEachRectangleQuery(sprites->layer, &rect, &query_bin, &q);
+	return q.size;
+}
@@ -0,0 +1,387 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ A snapshot is the state of the world in one binary file. It is a
+ {SnapshotHeader}, a table of where each bin starts in the {Record}s, the
+ {Record}s of every {Ship} and {Debris} in bin order, a {SnapshotShip} for
+ every {Ship} {Record}, in the same order, then the {SnapshotWmd}s.
+ Nothing in it refers to memory; everything is fixed-size, so it can be mapped
+ and used in-place once the header has been checked against this build and
+ the checksum matches. {Gate}s and the other furniture come from the zone,
+ lights come from the {Wmd}s, and the only events that are kept are {Wmd}s
+ expiring; others are function pointers, and are lost. The format is native;
+ it's meant for the same build on the same machine.
+
+ @title		SpritesSnapshot
+ @author	Neil
+ @std		C89/90
+ @version	2018-02 */
+
+/* It's much faster if the file can be mapped. */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)) /* <-- mmap */
+#define SNAPSHOT_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* mmap --> */
+
+/* from Lore */
+extern const struct AutoWmdType auto_wmd_type[];
+extern const int max_auto_wmd_type;
+extern const struct AutoSpaceZone auto_space_zone[];
+extern const int max_auto_space_zone;
+
+/* Increment when anything that is written changes. */
+static const unsigned snapshot_version = 2;
+static const char snapshot_magic[8] = { 'V', 'o', 'i', 'd', 'S', 'n', 'a', 'p' };
+/* Written as a number; if it's read differently, it's a different machine. */
+static const unsigned snapshot_endian = 0x01020304;
+
+/** What a {Record} doesn't have about a {Ship}. */
+struct SnapshotShip {
+	char name[16]; /* {Ship.name} */
+	unsigned short ai; /* {AiType} */
+	unsigned short unused;
+};
+
+/** The start of the file. */
+struct SnapshotHeader {
+	char magic[8];
+	unsigned version, endian;
+	unsigned header_size, record_size, ship_size, wmd_size, bins;
+	unsigned zone; /* index in {auto_space_zone} */
+	unsigned is_player, records, ships, wmds;
+	unsigned checksum; /* of everything after the header */
+	struct Record player;
+	struct SnapshotShip player_ship;
+	struct Random random[RANDOM_STREAMS];
+};
+
+/** A {Wmd} in a snapshot. */
+struct SnapshotWmd {
+	unsigned short class; /* index in {auto_wmd_type} */
+	unsigned short unused;
+	float x, y, theta, vx, vy, omega;
+	float mass;
+	unsigned ms_left; /* until it expires */
+};
+
+/** While writing a snapshot. */
+struct SnapshotWriter {
+	FILE *fp;
+	unsigned checksum, ships, wmds;
+	int is_error;
+};
+
+/** FNV-1a on {size} bytes of {data}, continuing from {hash}. */
+static unsigned snapshot_hash(unsigned hash, const void *const data,
+	const size_t size) {
+	const unsigned char *a = data, *const end = a + size;
+	while(a < end) hash = ((hash ^ *a++) * 16777619u) & 0xffffffffu;
+	return hash;
+}
+static const unsigned snapshot_hash_start = 2166136261u;
+
+/** Writes {size} bytes of {data} to {w} and adds them to the checksum. */
+static void snapshot_write(struct SnapshotWriter *const w,
+	const void *const data, const size_t size) {
+	assert(w && w->fp);
+	if(w->is_error || !size) return;
+	w->checksum = snapshot_hash(w->checksum, data, size);
+	if(fwrite(data, size, 1, w->fp) != 1) w->is_error = 1;
+}
+
+/** Fills {ss} with {ship}. */
+static void snapshot_fill_ship(struct SnapshotShip *const ss,
+	const struct Ship *const ship) {
+	assert(ss && ship);
+	memset(ss, 0, sizeof *ss);
+	memcpy(ss->name, ship->name, sizeof ss->name);
+	ss->name[sizeof ss->name - 1] = '\0';
+	ss->ai = (unsigned short)(ship->sprite.data.vt == &ship_human_vt
+		? AI_HUMAN : AI_DUMB);
+}
+
+/** Writes the ships that {record_sprite} does.
+ @implements <Sprite, SnapshotWriter>DiAction */
+static void snapshot_ship(struct Sprite *const sprite, void *const void_w) {
+	struct SnapshotWriter *const w = void_w;
+	struct SnapshotShip ss;
+	if(sprite->vt->class != SC_SHIP
+		|| (struct Ship *)sprite == get_player()) return;
+	snapshot_fill_ship(&ss, (struct Ship *)sprite);
+	snapshot_write(w, &ss, sizeof ss);
+	w->ships++;
+}
+
+/** @implements <Sprite, SnapshotWriter>DiAction */
+static void snapshot_wmd(struct Sprite *const sprite, void *const void_w) {
+	struct SnapshotWriter *const w = void_w;
+	const struct Wmd *wmd;
+	struct SnapshotWmd sw;
+	int left;
+	if(sprite->vt->class != SC_WMD) return;
+	wmd = (const struct Wmd *)sprite;
+	sw.class = (unsigned short)(wmd->class - auto_wmd_type);
+	sw.unused = 0;
+	sw.x  = sprite->x.x, sw.y  = sprite->x.y, sw.theta = sprite->x.theta;
+	sw.vx = sprite->v.x, sw.vy = sprite->v.y, sw.omega = sprite->v.theta;
+	sw.mass = wmd->mass;
+	left = (int)(wmd->expires - TimerGetGameTime());
+	sw.ms_left = left > 0 ? (unsigned)left : 0;
+	snapshot_write(w, &sw, sizeof sw);
+	w->wmds++;
+}
+
+/** Writes the world to {fn}; {zone} is the current zone.
+ @return Success. */
+int SpritesSnapshotSave(const char *const fn,
+	const struct AutoSpaceZone *const zone) {
+	struct SnapshotHeader header;
+	struct SnapshotWriter w;
+	struct RecordStack *records = 0;
+	struct Ship *const player = get_player();
+	unsigned bin[LAYER_SIZE + 1], i;
+	size_t size;
+	enum { E_NO, E_STACK, E_FILE, E_ZONE } e = E_NO;
+	if(!sprites || !fn) return 0;
+	memset(&header, 0, sizeof header);
+	w.fp = 0, w.checksum = snapshot_hash_start, w.ships = w.wmds = 0;
+	w.is_error = 0;
+	do {
+		if(!zone) { e = E_ZONE; break; }
+		/* Everything but the player, in bin order. */
+		if(!(records = RecordStack())) { e = E_STACK; break; }
+		for(i = 0; i < LAYER_SIZE; i++) {
+			bin[i] = (unsigned)RecordStackGetSize(records);
+			SpriteListBiForEach(&sprites->bins[i].sprites, &record_sprite,
+				records);
+		}
+		bin[LAYER_SIZE] = (unsigned)RecordStackGetSize(records);
+		memcpy(header.magic, snapshot_magic, sizeof header.magic);
+		header.version = snapshot_version;
+		header.endian = snapshot_endian;
+		header.header_size = sizeof header;
+		header.record_size = sizeof(struct Record);
+		header.ship_size = sizeof(struct SnapshotShip);
+		header.wmd_size = sizeof(struct SnapshotWmd);
+		header.bins = LAYER_SIZE;
+		header.zone = (unsigned)(zone - auto_space_zone);
+		header.records = bin[LAYER_SIZE];
+		for(i = 0; i < header.records; i++)
+			if(RecordStackGetElement(records, i)->type == SC_SHIP)
+				header.ships++;
+		if(player) {
+			const struct Sprite *const s = &player->sprite.data;
+			struct Record *const r = &header.player;
+			header.is_player = 1;
+			r->type = SC_SHIP;
+			r->class = (unsigned short)(player->class - auto_ship_class);
+			r->x  = s->x.x, r->y  = s->x.y, r->theta = s->x.theta;
+			r->vx = s->v.x, r->vy = s->v.y, r->omega = s->v.theta;
+			r->hit = ship_shield(player, TimerGetGameTime());
+			snapshot_fill_ship(&header.player_ship, player);
+		}
+		for(i = 0; i < RANDOM_STREAMS; i++)
+			header.random[i] = *RandomStream((enum RandomStream)i);
+		if(!(w.fp = fopen(fn, "wb"))) { e = E_FILE; break; }
+		/* The header is written twice; the second time with the checksum. */
+		if(fwrite(&header, sizeof header, 1, w.fp) != 1) { e = E_FILE; break; }
+		snapshot_write(&w, bin, sizeof bin);
+		if((size = RecordStackGetSize(records))) snapshot_write(&w,
+			RecordStackGetElement(records, 0), sizeof(struct Record) * size);
+		for(i = 0; i < LAYER_SIZE; i++)
+			SpriteListBiForEach(&sprites->bins[i].sprites, &snapshot_ship, &w);
+		for(i = 0; i < LAYER_SIZE; i++)
+			SpriteListBiForEach(&sprites->bins[i].sprites, &snapshot_wmd, &w);
+		if(w.is_error) { e = E_FILE; break; }
+		/* A {Record} that couldn't be made would put them out of step. */
+		if(w.ships != header.ships) { e = E_STACK; break; }
+		header.wmds = w.wmds;
+		header.checksum = w.checksum;
+		if(fseek(w.fp, 0l, SEEK_SET)
+			|| fwrite(&header, sizeof header, 1, w.fp) != 1)
+			{ e = E_FILE; break; }
+	} while(0); switch(e) {
+		case E_NO: break;
+		case E_STACK: fprintf(stderr, "SpritesSnapshotSave: %s.\n",
+			RecordStackGetError(records)); break;
+		case E_FILE: perror(fn); break;
+		case E_ZONE: fprintf(stderr, "SpritesSnapshotSave: no zone.\n"); break;
+	} {
+		if(w.fp && fclose(w.fp) == EOF && !e) perror(fn), e = E_FILE;
+		RecordStack_(&records);
+	}
+	if(e) return 0;
+	fprintf(stderr, "SpritesSnapshotSave: %s, %s, %u sprites, %u wmds.\n", fn,
+		zone->name, header.records + header.is_player, header.wmds);
+	return 1;
+}
+
+/** @return Whether {size} bytes at {data} are a valid snapshot. */
+static int snapshot_valid(const void *const data, const size_t size) {
+	const struct SnapshotHeader *const h = data;
+	const unsigned *bin;
+	const struct Record *r;
+	const struct SnapshotShip *ss;
+	const struct SnapshotWmd *sw;
+	size_t expect, ships = 0, i;
+	if(size < sizeof *h || memcmp(h->magic, snapshot_magic, sizeof h->magic))
+		return fprintf(stderr, "Snapshot: not a snapshot.\n"), 0;
+	if(h->version != snapshot_version || h->endian != snapshot_endian
+		|| h->header_size != sizeof *h || h->record_size != sizeof *r
+		|| h->ship_size != sizeof *ss || h->wmd_size != sizeof *sw
+		|| h->bins != LAYER_SIZE)
+		return fprintf(stderr, "Snapshot: version %u, not from this build.\n",
+		h->version), 0;
+	expect = sizeof *h + sizeof *bin * (LAYER_SIZE + 1)
+		+ sizeof *r * h->records + sizeof *ss * h->ships
+		+ sizeof *sw * h->wmds;
+	if(size != expect || h->zone >= (unsigned)max_auto_space_zone)
+		return fprintf(stderr, "Snapshot: wrong size.\n"), 0;
+	if(snapshot_hash(snapshot_hash_start, h + 1, size - sizeof *h)
+		!= h->checksum) return fprintf(stderr, "Snapshot: corrupt.\n"), 0;
+	/* Everything that's going to be used as an index. */
+	bin = (const unsigned *)(h + 1);
+	for(i = 0; i < LAYER_SIZE; i++) if(bin[i] > bin[i + 1])
+		return fprintf(stderr, "Snapshot: bins out of order.\n"), 0;
+	if(bin[0] || bin[LAYER_SIZE] != h->records)
+		return fprintf(stderr, "Snapshot: bins don't match.\n"), 0;
+	r = (const struct Record *)(bin + LAYER_SIZE + 1);
+	for(i = 0; i < h->records; i++) if(r[i].type == SC_SHIP) ships++;
+	if(ships != h->ships)
+		return fprintf(stderr, "Snapshot: ships don't match.\n"), 0;
+	ss = (const struct SnapshotShip *)(r + h->records);
+	for(i = 0; i < h->ships; i++) if(ss[i].ai > AI_HUMAN)
+		return fprintf(stderr, "Snapshot: ship ai.\n"), 0;
+	sw = (const struct SnapshotWmd *)(ss + h->ships);
+	for(i = 0; i < h->wmds; i++) if(sw[i].class >= max_auto_wmd_type)
+		return fprintf(stderr, "Snapshot: wmd class.\n"), 0;
+	if(h->is_player && (h->player.class >= max_auto_ship_class
+		|| h->player_ship.ai > AI_HUMAN))
+		return fprintf(stderr, "Snapshot: player.\n"), 0;
+	return 1;
+}
+
+/** Creates the {Wmd} in {sw}. */
+static void snapshot_restore_wmd(const struct SnapshotWmd *const sw) {
+	const struct AutoWmdType *const class = auto_wmd_type + sw->class;
+	struct Wmd *this;
+	struct Ortho3f x;
+	assert(sw && sw->class < max_auto_wmd_type);
+	x.x = sw->x, x.y = sw->y, x.theta = sw->theta;
+	if(!(this = WmdPoolNew(sprites->wmds)))
+		{ fprintf(stderr, "Snapshot: %s.\n",
+		WmdPoolGetError(sprites->wmds)); return; }
+	sprite_filler(&this->sprite.data, &wmd_vt, class->sprite, &x);
+	this->class = class;
+	this->sprite.data.v.x = sw->vx, this->sprite.data.v.y = sw->vy;
+	this->sprite.data.v.theta = sw->omega;
+	this->mass = sw->mass;
+	this->expires = TimerGetGameTime() + sw->ms_left;
+	this->expiry = EventsIntConsumer(sw->ms_left, &wmd_expire,
+		(int)WmdPoolGetIndex(sprites->wmds, this));
+	Light(&this->sprite.data, class->r, class->g, class->b, this->expires);
+}
+
+/** Replaces the world with the snapshot in {fn}.
+ @param zone: Called with the snapshot's zone after all the sprites have been
+ deleted and before the snapshot's are created; sets up everything else.
+ @return Success; if it fails, the world is untouched. */
+int SpritesSnapshotLoad(const char *const fn,
+	void (*const zone)(const struct AutoSpaceZone *const)) {
+	const struct SnapshotHeader *h;
+	const unsigned *bin;
+	const struct Record *r;
+	const struct SnapshotShip *ss;
+	const struct SnapshotWmd *sw;
+	struct Sprite *s;
+	void *data = 0;
+	size_t size = 0, i;
+#ifdef SNAPSHOT_MMAP /* <-- mmap */
+	struct stat st;
+	int fd;
+#else /* mmap --><-- !mmap */
+	FILE *fp;
+	long end;
+#endif /* !mmap --> */
+	if(!sprites || !fn || !zone) return 0;
+	/* Get the whole file in memory. */
+#ifdef SNAPSHOT_MMAP /* <-- mmap */
+	if((fd = open(fn, O_RDONLY)) == -1) return perror(fn), 0;
+	if(fstat(fd, &st) == -1) { perror(fn); close(fd); return 0; }
+	size = (size_t)st.st_size;
+	if(size && (data = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0))
+		== MAP_FAILED) data = 0, perror(fn);
+	close(fd);
+	if(!data) return 0;
+#else /* mmap --><-- !mmap */
+	if(!(fp = fopen(fn, "rb"))) return perror(fn), 0;
+	if(fseek(fp, 0l, SEEK_END) || (end = ftell(fp)) == -1l
+		|| fseek(fp, 0l, SEEK_SET) || !(size = (size_t)end)
+		|| !(data = malloc(size)) || fread(data, size, 1, fp) != 1)
+		{ perror(fn); free(data); fclose(fp); return 0; }
+	fclose(fp);
+#endif /* !mmap --> */
+	if(snapshot_valid(data, size)) {
+		h = data;
+		bin = (const unsigned *)(h + 1);
+		r = (const struct Record *)(bin + LAYER_SIZE + 1);
+		ss = (const struct SnapshotShip *)(r + h->records);
+		sw = (const struct SnapshotWmd *)(ss + h->ships);
+		/* Delete everything, including the player, properly. */
+		staging_cancel(&sprites->cache.staging);
+		for(i = 0; i < LAYER_SIZE; i++)
+			while((s = SpriteListGetFirst(&sprites->bins[i].sprites)))
+				sprite_delete(s);
+		zone(auto_space_zone + h->zone);
+		/* The pools grow once, instead of moving everything as they fill. */
+		if(!ShipPoolReserve(sprites->ships, ShipPoolGetSize(sprites->ships)
+			+ h->ships + h->is_player)) fprintf(stderr,
+			"SpritesSnapshotLoad: %s.\n", ShipPoolGetError(sprites->ships));
+		if(!DebrisPoolReserve(sprites->debris, DebrisPoolGetSize(sprites
+			->debris) + h->records - h->ships)) fprintf(stderr,
+			"SpritesSnapshotLoad: %s.\n", DebrisPoolGetError(sprites->debris));
+		for(i = 0; i < h->records; i++) {
+			if(r[i].type != SC_SHIP) { record_restore(r + i, AI_DUMB); continue; }
+			if((s = record_restore(r + i, (enum AiType)ss->ai)))
+				memcpy(((struct Ship *)s)->name, ss->name, sizeof ss->name);
+			ss++;
+		}
+		/* After the others; a {Ship} that was {AI_HUMAN} but not the player
+		 would take over. */
+		if(h->is_player) {
+			struct Ortho3f x;
+			struct Ship *player;
+			x.x = h->player.x, x.y = h->player.y, x.theta = h->player.theta;
+			if((player = SpritesShip(auto_ship_class + h->player.class, &x,
+				AI_HUMAN))) {
+				player->sprite.data.v.x = h->player.vx;
+				player->sprite.data.v.y = h->player.vy;
+				player->sprite.data.v.theta = h->player.omega;
+				player->hit.x = h->player.hit;
+				memcpy(player->name, h->player_ship.name,
+					sizeof h->player_ship.name);
+			}
+		}
+		for(i = 0; i < h->wmds; i++) snapshot_restore_wmd(sw + i);
+		/* Last; making the sprites draws from them for {Orcish} names. */
+		for(i = 0; i < RANDOM_STREAMS; i++)
+			*RandomStream((enum RandomStream)i) = h->random[i];
+		fprintf(stderr, "SpritesSnapshotLoad: %s, %s, %u sprites, %u wmds.\n",
+			fn, auto_space_zone[h->zone].name, h->records + h->is_player,
+			h->wmds);
+	} else {
+		fprintf(stderr, "SpritesSnapshotLoad: %s not loaded.\n", fn);
+		h = 0;
+	}
+#ifdef SNAPSHOT_MMAP /* <-- mmap */
+	munmap(data, size);
+#else /* mmap --><-- !mmap */
+	free(data);
+#endif /* !mmap --> */
+	return h != 0;
+}
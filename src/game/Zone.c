@@ -9,6 +9,7 @@
 #include "../../build/Auto.h"
 #include "../Ortho.h"
 #include "../general/Events.h"
+#include "../general/Trace.h"
 #include "../system/Draw.h"
 #include "Sprites.h"
 #include "Fars.h"
@@ -25,6 +26,11 @@ extern const float de_sitter;
 
 const struct AutoSpaceZone *current_zone;
 
+/* What's in a zone. */
+static const unsigned zone_debris = 6400, zone_ships = 1000;
+/* \see{ZoneSave}. */
+static const char *const zone_snapshot = "Void.snapshot";
+
 /** @implements <Sprite>Predicate */
 static int all_except_player(const struct Sprite *const this) {
 	return this != (struct Sprite *)SpritesGetPlayerShip();
@@ -36,18 +42,12 @@ static int all_except_player(const struct Sprite *const this) {
 	UNUSED(this);
 	return 1;
 } <- We need to have more in {Events.c}, perhaps? */
-/** Clears, then sets up a new zone. */
-void Zone(const struct AutoSpaceZone *const sz) {
-	const struct AutoShipClass *blob_class = AutoShipClassSearch("Blob");
-	const struct AutoDebris *asteroid = AutoDebrisSearch("Asteroid");
-	unsigned i;
-
+/** Clears everything but the sprites and sets up the furniture of {sz}.
+ @implements <AutoSpaceZone>Action */
+static void zone_furnish(const struct AutoSpaceZone *const sz) {
 	fprintf(stderr, "Zone: SpaceZone %s is controlled by %s, contains gate %s "
 		"and fars %s, %s.\n", sz->name, sz->government->name, sz->gate1->name,
 		sz->ois1->name, sz->ois2->name);
-
-	/* clear all objects */
-	SpritesRemoveIf(&all_except_player);
 	/* @fixme LightsClear();*/
 	EventsClear();
 	FarsClear();
@@ -65,13 +65,51 @@ void Zone(const struct AutoSpaceZone *const sz) {
 
 	/* update the current zone */
 	current_zone = sz;
+}
+
+/** Clears, then sets up a new zone. */
+void Zone(const struct AutoSpaceZone *const sz) {
+	const struct AutoShipClass *blob_class = AutoShipClassSearch("Blob");
+	const struct AutoDebris *asteroid = AutoDebrisSearch("Asteroid");
+	unsigned i;
+
+	/* save the zone we're leaving before clearing all objects */
+	if(current_zone) SpritesCacheStore(current_zone);
+	SpritesRemoveIf(&all_except_player);
+
+	zone_furnish(sz);
+
+	/* if we've been here recently, it's just like we left it */
+	if(SpritesCacheRestore(sz)) return;
 
 	/* some asteroids */
-	for(i = 0; i < 6400; i++) SpritesDebris(asteroid, 0);
+	for(i = 0; i < zone_debris; i++) SpritesDebris(asteroid, 0);
 
 	/* sprinkle some ships */
-	for(i = 0; i < 1000; i++) SpritesShip(blob_class, 0, AI_DUMB);
+	for(i = 0; i < zone_ships; i++) SpritesShip(blob_class, 0, AI_DUMB);
+
+}
+
+/** Makes {sz} a slice at a time in the background when one is near a gate to
+ it, so that \see{ZoneChange} only has to link it in. Call every frame. */
+void ZoneStage(const struct AutoSpaceZone *const sz) {
+	if(!sz || sz == current_zone) return;
+	SpritesCacheStage(sz, AutoShipClassSearch("Blob"), zone_ships,
+		AutoDebrisSearch("Asteroid"), zone_debris);
+}
+
+/** Saves the world to a snapshot. */
+void ZoneSave(void) {
+	SpritesSnapshotSave(zone_snapshot, current_zone);
+}
 
+/** Replaces the world with the snapshot from \see{ZoneSave}. */
+void ZoneLoad(void) {
+	/* The zone we're leaving is still cached. */
+	if(current_zone) SpritesCacheStore(current_zone);
+	TraceBegin("ZoneLoad");
+	SpritesSnapshotLoad(zone_snapshot, &zone_furnish);
+	TraceEnd();
 }
 
 /** Zone change with the {gate}.
@@ -93,7 +131,9 @@ void ZoneChange(struct Gate *const gate) {
 	/* New zone. */
 	if(!new_zone) { fprintf(stderr,
 		"ZoneChange: does not have information about zone.\n"); return; }
+	TraceBegin("Zone");
 	Zone(new_zone);
+	TraceEnd();
 	/* Get new gate parametres; after the Zone changes. */
 	if(!(new_gate = FindGate(old_zone)))
 		{ fprintf(stderr, "ZoneChange: missing gate back.\n"); return; }
@@ -5,3 +5,6 @@ struct Gate;
 
 void Zone(const struct AutoSpaceZone *const sz);
 void ZoneChange(struct Gate *const gate);
+void ZoneStage(const struct AutoSpaceZone *const sz);
+void ZoneSave(void);
+void ZoneLoad(void);
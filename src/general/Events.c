@@ -2,12 +2,18 @@
  Public License 3, see copying.txt, or
  \url{ https://opensource.org/licenses/GPL-3.0 }.
 
- Use when you want to call a function, but not right away.
+ Use when you want to call a function, but not right away. Events are kept
+ in a hierarchical timing wheel with a resolution of one millisecond: four
+ levels of {EVENTS_SLOTS} slots, each level {EVENTS_SLOTS} times as coarse as
+ the last. An event goes in the finest level that can hold it and is
+ cascaded down a level as time catches up, so scheduling and cancelling are
+ both {O(1)}, and nothing is scanned that is not due.
 
  @title		Event
  @author	Neil
  @std		C89/90
- @version	2017-10 Broke off from Sprites.
+ @version	2018-02 Timing wheel; cancel.
+ 			2017-10 Broke off from Sprites.
 			2016-01
 			2015-11 */
 
@@ -20,12 +26,24 @@
 
 /*************** Declare types. ****************/
 
+/* Slots in a level of the wheel; must be a power of two. */
+#define EVENTS_BITS (8)
+#define EVENTS_SLOTS (1 << EVENTS_BITS)
+#define EVENTS_LEVELS (4)
+static const unsigned events_mask = EVENTS_SLOTS - 1;
+
 /** This is one polymorphic {Event}. */
 struct Event;
 struct EventVt;
 struct Events;
 
-struct Event { const struct EventVt *vt; };
+struct EventList;
+struct Event {
+	const struct EventVt *vt;
+	struct EventList *list; /* the slot it's in, or null when running */
+	unsigned when; /* game time in ms */
+	unsigned serial; /* matches the handle */
+};
 #define LIST_NAME Event
 #define LIST_TYPE struct Event
 #include "../templates/List.h"
@@ -62,60 +80,113 @@ struct SpriteConsumer {
 #define POOL_MIGRATE struct Events
 #include "../templates/Pool.h"
 
-/** Events are fit to various bins depending on the length of the delay. Longer
- delays will be more granular and less-resolution. */
+/** Events are fit to the wheel depending on the length of the delay; level
+ {l} slot {s} has the events that are due when bits {[8l, 8l + 8)} of the
+ time are {s}, and the bits above are within one turn of {update}. */
 static struct Events {
-	unsigned update; /* time */
-	struct EventList immediate;
-	struct EventList approx1s[8];
-	struct EventList approx8s[8];
-	struct EventList approx64s[8];
+	unsigned update; /* the next ms that has not been run */
+	unsigned serial; /* for handles */
+	size_t size; /* pending */
+	struct EventList wheel[EVENTS_LEVELS][EVENTS_SLOTS];
+	/* The slot that is running, \see{events_run}. */
+	struct EventList running;
 	struct RunnablePool *runnables;
 	struct IntConsumerPool *int_consumers;
 	struct SpriteConsumerPool *sprite_consumers;
 } *events;
 
-static const size_t approx1s_size = sizeof((struct Events *)0)->approx1s
-	/ sizeof *((struct Events *)0)->approx1s;
-static const size_t approx8s_size = sizeof((struct Events *)0)->approx8s
-	/ sizeof *((struct Events *)0)->approx8s;
-static const size_t approx64s_size = sizeof((struct Events *)0)->approx64s
-	/ sizeof *((struct Events *)0)->approx64s;
 
 
 /******************* Define virtual functions. ********************/
 
 typedef void (*EventsAction)(struct Event *const);
+typedef struct Event *(*EventsElement)(const size_t);
+typedef size_t (*EventsIndex)(const struct Event *const);
 
-struct EventVt { EventsAction call; };
+struct EventVt {
+	EventsAction call, remove;
+	EventsElement element;
+	EventsIndex index;
+};
 
-/** This is only called from {run_event_list} as the event list must be purged
- because the backing in the {Pool}s has been removed; important!
+/** This is only called from {events_run} as the event has been taken out of
+ the list and it's backing in the {Pool}s will be removed; important!
  @implements <Event>Action */
 static void event_call(struct Event *const this) {
 	assert(events && this);
 	this->vt->call(this);
 }
+/* These remove themselves before calling; the call could create events that
+ move the pool. */
 /** @implements <Runnable>Action */
 static void runnable_call(struct Runnable *const this) {
-	this->run();
+	const Runnable run = this->run;
 	RunnablePoolRemove(events->runnables, this);
+	run();
 }
 /** @implements <IntConsumer>Action */
 static void int_consumer_call(struct IntConsumer *const this) {
-	this->accept(this->param);
+	const IntConsumer accept = this->accept;
+	const int param = this->param;
 	IntConsumerPoolRemove(events->int_consumers, this);
+	accept(param);
 }
 /** @implements <SpriteConsumer>Action */
 static void sprite_consumer_call(struct SpriteConsumer *const this) {
-	this->accept(this->param);
+	const SpriteConsumer accept = this->accept;
+	struct Sprite *const param = this->param;
+	SpriteConsumerPoolRemove(events->sprite_consumers, this);
+	accept(param);
+}
+/** @implements <Runnable>Action */
+static void runnable_remove(struct Runnable *const this) {
+	RunnablePoolRemove(events->runnables, this);
+}
+/** @implements <IntConsumer>Action */
+static void int_consumer_remove(struct IntConsumer *const this) {
+	IntConsumerPoolRemove(events->int_consumers, this);
+}
+/** @implements <SpriteConsumer>Action */
+static void sprite_consumer_remove(struct SpriteConsumer *const this) {
 	SpriteConsumerPoolRemove(events->sprite_consumers, this);
 }
+/** @implements <Runnable>Element */
+static struct Runnable *runnable_element(const size_t index) {
+	return RunnablePoolGetElement(events->runnables, index);
+}
+/** @implements <IntConsumer>Element */
+static struct IntConsumer *int_consumer_element(const size_t index) {
+	return IntConsumerPoolGetElement(events->int_consumers, index);
+}
+/** @implements <SpriteConsumer>Element */
+static struct SpriteConsumer *sprite_consumer_element(const size_t index) {
+	return SpriteConsumerPoolGetElement(events->sprite_consumers, index);
+}
+/** @implements <Runnable>Index */
+static size_t runnable_index(const struct Runnable *const this) {
+	return RunnablePoolGetIndex(events->runnables, this);
+}
+/** @implements <IntConsumer>Index */
+static size_t int_consumer_index(const struct IntConsumer *const this) {
+	return IntConsumerPoolGetIndex(events->int_consumers, this);
+}
+/** @implements <SpriteConsumer>Index */
+static size_t sprite_consumer_index(const struct SpriteConsumer *const this) {
+	return SpriteConsumerPoolGetIndex(events->sprite_consumers, this);
+}
 
 static const struct EventVt
-	runnable_vt        = { (EventsAction)&runnable_call },
-	int_consumer_vt    = { (EventsAction)&int_consumer_call },
-	sprite_consumer_vt = { (EventsAction)&sprite_consumer_call };
+	runnable_vt = { (EventsAction)&runnable_call,
+		(EventsAction)&runnable_remove, (EventsElement)&runnable_element,
+		(EventsIndex)&runnable_index },
+	int_consumer_vt = { (EventsAction)&int_consumer_call,
+		(EventsAction)&int_consumer_remove,
+		(EventsElement)&int_consumer_element,
+		(EventsIndex)&int_consumer_index },
+	sprite_consumer_vt = { (EventsAction)&sprite_consumer_call,
+		(EventsAction)&sprite_consumer_remove,
+		(EventsElement)&sprite_consumer_element,
+		(EventsIndex)&sprite_consumer_index };
 
 
 
@@ -123,41 +194,23 @@ static const struct EventVt
 
 /** Used in {Events_}, {Events}, and {EventsClear}. */
 static void clear_event_lists(void) {
-	unsigned i;
+	unsigned l, s;
 	assert(events);
-	EventListClear(&events->immediate);
-	for(i = 0; i < approx1s_size; i++)
-		EventListClear(events->approx1s + i);
-	for(i = 0; i < approx8s_size; i++)
-		EventListClear(events->approx8s + i);
-	for(i = 0; i < approx64s_size; i++)
-		EventListClear(events->approx64s + i);
+	for(l = 0; l < EVENTS_LEVELS; l++)
+		for(s = 0; s < EVENTS_SLOTS; s++)
+			EventListClear(&events->wheel[l][s]);
+	EventListClear(&events->running);
+	events->size = 0;
 }
 
-/** Used in {EventsRemoveIf}. */
-/*static void clear_event_lists_predicate(const EventsPredicate predicate) {
-	unsigned i;
-	assert(events);
-	EventListTakeIf(0, &events->immediate, predicate);
-	for(i = 0; i < sizeof events->approx1s / sizeof *events->approx1s; i++)
-		EventListTakeIf(0, events->approx1s + i, predicate);
-	for(i = 0; i < sizeof events->approx8s / sizeof *events->approx8s; i++)
-		EventListTakeIf(0, events->approx8s + i, predicate);
-	for(i = 0; i < sizeof events->approx64s / sizeof *events->approx64s; i++)
-		EventListTakeIf(0, events->approx64s + i, predicate);
-} <- fixme: leaves Pool!! */
-
 /** @implements <Events>Migrate */
 static void events_migrate(struct Events *const e, const struct Migrate *const migrate) {
-	unsigned i;
+	unsigned l, s;
 	assert(e && e == events && migrate);
-	EventListMigrate(&e->immediate, migrate);
-	for(i = 0; i < approx1s_size; i++)
-		EventListMigrate(e->approx1s + i, migrate);
-	for(i = 0; i < approx8s_size; i++)
-		EventListMigrate(e->approx8s + i, migrate);
-	for(i = 0; i < approx64s_size; i++)
-		EventListMigrate(e->approx64s + i, migrate);
+	for(l = 0; l < EVENTS_LEVELS; l++)
+		for(s = 0; s < EVENTS_SLOTS; s++)
+			EventListMigrate(&e->wheel[l][s], migrate);
+	EventListMigrate(&e->running, migrate);
 }
 
 /** Destructor. */
@@ -177,6 +230,7 @@ int Events(void) {
 	if(!(events = malloc(sizeof *events)))
 		{ perror("Events"); Events_(); return 0; }
 	events->update = TimerGetGameTime();
+	events->serial = 0;
 	clear_event_lists();
 	events->runnables = 0;
 	events->int_consumers = 0;
@@ -199,63 +253,92 @@ int Events(void) {
 
 /*************** Sub-type constructors. ******************/
 
-/** Fits into a bin. */
-static struct EventList *fit_future(struct Events *const this,
-	const unsigned ms_future) {
-	const unsigned ms_now = TimerGetGameTime(), ms = ms_now + ms_future;
-	unsigned select;
-	struct EventList *list;
-	assert(this);
-	if(ms_future < 0x200) {
-		list = &this->immediate;
-		select = 0;
-	} else if(ms_future < 0x2200) {
-		list = this->approx1s;
-		select = ((ms >> 10) & 7) + ((ms & (0x400 - 1)) > 0x200) ? 1 : 0;
-	} else if(ms_future < 0x11000) {
-		list = this->approx8s;
-		select = ((ms >> 13) & 7) + ((ms & (0x2000 - 1)) > 0x1000) ? 1 : 0;
-	} else if(ms_future < 0x88000) {
-		list = this->approx64s;
-		select = ((ms >> 16) & 7) + ((ms & (0x10000 - 1)) > 0x8000) ? 1 : 0;
-	} else { /* Maximum delay is, \${1.024s * 64 * 8 * (min/60s) <= 8.74min} */
-		list = this->approx64s;
-		select = ((ms_now >> 16) + 7) & 7;
+/* The most that any event can be delayed so it doesn't come around the top
+ level again, about 48 days. */
+static const unsigned events_max_future = 0xff000000;
+
+/** Puts {this} in the wheel based on {this.when} relative to
+ {events.update}; anything that is due, or over-due, goes in the next slot to
+ run. Also used for cascading. */
+static void events_insert(struct Event *const this) {
+	const unsigned delta = this->when - events->update;
+	unsigned level, slot;
+	assert(events && this);
+	if(delta > events_max_future) { /* In the past. */
+		level = 0, slot = events->update & events_mask;
+	} else {
+		for(level = 0; level < EVENTS_LEVELS - 1
+			&& delta >> (EVENTS_BITS * (level + 1)); level++);
+		slot = (this->when >> (EVENTS_BITS * level)) & events_mask;
 	}
-	assert(select < 8);
-	return list + select;
+	this->list = &events->wheel[level][slot];
+	EventListPush(this->list, this);
 }
 
-/** Abstract {Event} constructor. */
+/** Abstract {Event} constructor.
+ @param handle: If non-null, gets a handle to \see{EventsCancel}. */
 static void event_filler(struct Event *const this,
-	const unsigned ms_future, const struct EventVt *const vt) {
+	const unsigned ms_future, const struct EventVt *const vt,
+	struct EventHandle *const handle) {
 	assert(events && this && vt);
 	this->vt = vt;
-	EventListPush(fit_future(events, ms_future), this);
+	this->when = TimerGetGameTime()
+		+ (ms_future > events_max_future ? events_max_future : ms_future);
+	if(!++events->serial) events->serial++;
+	this->serial = events->serial;
+	events_insert(this);
+	events->size++;
+	if(!handle) return;
+	handle->vt = vt;
+	handle->index = vt->index(this);
+	handle->serial = this->serial;
 }
-/** Creates a new {Runnable}. */
-int EventsRunnable(const unsigned ms_future, const Runnable run) {
+/** Creates a new {Runnable}.
+ @return A handle to \see{EventsCancel} the event; if {handle.serial} is zero,
+ it failed. */
+struct EventHandle EventsRunnable(const unsigned ms_future,
+	const Runnable run) {
+	struct EventHandle handle = { 0, 0, 0 };
 	struct Runnable *this;
-	if(!events || !run) return 0;
+	if(!events || !run) return handle;
 	if(!(this = RunnablePoolNew(events->runnables)))
 		{ fprintf(stderr, "EventsRunnable: %s.\n",
-		RunnablePoolGetError(events->runnables)); return 0; }
+		RunnablePoolGetError(events->runnables)); return handle; }
 	this->run = run;
-	event_filler(&this->event.data, ms_future, &runnable_vt);
-	return 1;
+	event_filler(&this->event.data, ms_future, &runnable_vt, &handle);
+	return handle;
+}
+/** Creates a new {IntConsumer}.
+ @return A handle to \see{EventsCancel} the event; if {handle.serial} is zero,
+ it failed. */
+struct EventHandle EventsIntConsumer(const unsigned ms_future,
+	const IntConsumer accept, const int param) {
+	struct EventHandle handle = { 0, 0, 0 };
+	struct IntConsumer *this;
+	if(!events || !accept) return handle;
+	if(!(this = IntConsumerPoolNew(events->int_consumers)))
+		{ fprintf(stderr, "EventsIntConsumer: %s.\n",
+		IntConsumerPoolGetError(events->int_consumers)); return handle; }
+	this->accept = accept;
+	this->param  = param;
+	event_filler(&this->event.data, ms_future, &int_consumer_vt, &handle);
+	return handle;
 }
-/** Creates a new {SpriteConsumer}. */
-int EventsSpriteConsumer(const unsigned ms_future,
+/** Creates a new {SpriteConsumer}.
+ @return A handle to \see{EventsCancel} the event; if {handle.serial} is zero,
+ it failed. */
+struct EventHandle EventsSpriteConsumer(const unsigned ms_future,
 	const SpriteConsumer accept, struct Sprite *const param) {
+	struct EventHandle handle = { 0, 0, 0 };
 	struct SpriteConsumer *this;
-	if(!events || !accept) return 0;
+	if(!events || !accept) return handle;
 	if(!(this = SpriteConsumerPoolNew(events->sprite_consumers)))
 		{ fprintf(stderr, "EventsSpriteConsumer: %s.\n",
-		SpriteConsumerPoolGetError(events->sprite_consumers)); return 0; }
+		SpriteConsumerPoolGetError(events->sprite_consumers)); return handle; }
 	this->accept = accept;
 	this->param  = param;
-	event_filler(&this->event.data, ms_future, &sprite_consumer_vt);
-	return 1;
+	event_filler(&this->event.data, ms_future, &sprite_consumer_vt, &handle);
+	return handle;
 }
 
 
@@ -269,56 +352,79 @@ void EventsClear(void) {
 	SpriteConsumerPoolClear(events->sprite_consumers);
 }
 
-/*void EventsRemoveIf(const EventsPredicate predicate) {
-	if(!events) return;
-	clear_event_lists_predicate(predicate);
-}*/
-
-static void run_event_list(struct EventList *const list) {
-	assert(events && list);
-	EventListForEach(list, &event_call);
-	/* {event_call} strips away their backing, so this call is important! */
-	EventListClear(list);
+/** Cancels the event referred to by {handle} if it has not happened yet, and
+ zeros it.
+ @return True if an event was cancelled.
+ @order \Theta(1) */
+int EventsCancel(struct EventHandle *const handle) {
+	struct Event *this;
+	unsigned serial;
+	if(!events || !handle || !(serial = handle->serial) || !handle->vt)
+		return 0;
+	handle->serial = 0;
+	this = handle->vt->element(handle->index);
+	/* It has happened, and maybe the space has been re-used. */
+	if(!this || !this->list || this->serial != serial) return 0;
+	EventListRemove(this->list, this);
+	this->list = 0;
+	events->size--;
+	this->vt->remove(this);
+	return 1;
 }
 
-/** Fire off {Events} that have happened. */
+/** @return The number of events that are waiting. */
+size_t EventsGetSize(void) {
+	if(!events) return 0;
+	return events->size;
+}
+
+/** Moves the events from level {level} that are due in the next turn of the
+ level below into the lower levels.
+ @return The slot that was cascaded; zero means the next level is due. */
+static unsigned events_cascade(const unsigned level) {
+	const unsigned slot
+		= (events->update >> (EVENTS_BITS * level)) & events_mask;
+	struct EventList *const list = &events->wheel[level][slot];
+	struct Event *e;
+	assert(events && level && level < EVENTS_LEVELS);
+	while((e = EventListGetFirst(list)))
+		EventListRemove(list, e), events_insert(e);
+	return slot;
+}
+
+/** Runs the events in the slot of {events.update} and advances it. */
+static void events_run(void) {
+	struct EventList *const slot
+		= &events->wheel[0][events->update & events_mask],
+		*const list = &events->running;
+	struct Event *e;
+	unsigned level;
+	assert(events);
+	/* At the start of a turn, bring down the next turn from above. */
+	for(level = 1; level < EVENTS_LEVELS && !((events->update
+		>> (EVENTS_BITS * (level - 1))) & events_mask)
+		&& !events_cascade(level); level++);
+	/* The slot is emptied first; events created while running go after,
+	 even if they end up in this slot on the next turn. */
+	events->update++;
+	while((e = EventListGetFirst(slot)))
+		EventListRemove(slot, e), EventListPush(list, e), e->list = list;
+	while((e = EventListGetFirst(list))) {
+		EventListRemove(list, e);
+		e->list = 0;
+		events->size--;
+		event_call(e);
+	}
+}
+
+/** Fire off {Events} that have happened, one ms at a time. */
 void EventsUpdate(void) {
-	struct EventList *chosen;
-	struct { unsigned cur, end; int done; } t1s, t8s, t64s;
 	const unsigned now = TimerGetGameTime();
-	enum { T64S, T8S, T1S } granularity = T64S;
 	if(!events) return;
-	/* Always run events that are immediate asap. */
-	run_event_list(&events->immediate);
-	/* Applies the timer with a granularity of whatever; all are [0, 7].
-	 fixme: Meh, could be better. */
-	t64s.cur = (events->update >> 16) & 7;
-	t64s.end = (now >> 16) & 7;
-	t8s.cur  = (events->update >> 13) & 7;
-	t8s.end  = (now >> 13) & 7;
-	t1s.cur  = (events->update >> 10) & 7;
-	t1s.end  = (now >> 10) & 7;
-	do {
-		switch(granularity) {
-			case T64S: t64s.done = (t64s.cur == t64s.end);
-			case T8S:  t8s.done  = t64s.done && (t8s.cur == t8s.end);
-			case T1S:  t1s.done  = t8s.done && (t1s.cur == t1s.end);
-		}
-		if(t1s.cur < 8) {
-			chosen = events->approx1s + t1s.cur++;
-			granularity = T1S;
-		} else {
-			t1s.cur = 0;
-			if(t8s.cur != 8) {
-				chosen = events->approx8s + t8s.cur++;
-				granularity = T8S;
-			} else {
-				t8s.cur = 0;
-				chosen = events->approx64s + t64s.cur++;
-				t64s.cur &= 7;
-				granularity = T64S;
-			}
-		}
-		run_event_list(chosen);
-	} while(!t1s.done);
+	/* Compare modulo time. */
+	while((int)(now - events->update) >= 0) {
+		/* Nothing to wait for. */
+		if(!events->size) { events->update = now + 1; break; }
+		events_run();
+	}
 }
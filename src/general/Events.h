@@ -4,13 +4,25 @@ struct Sprite;
 typedef void (*SpriteConsumer)(struct Sprite *const);
 struct Events;
 struct Event;
+struct EventVt;
 typedef int (*EventsPredicate)(const struct Event *const);
+/** Returned from the constructors to \see{EventsCancel} the event later. */
+struct EventHandle {
+	const struct EventVt *vt;
+	size_t index;
+	unsigned serial;
+};
 
 void Events_(void);
 int Events(void);
 void EventsClear(void);
 void EventsRemoveIf(const EventsPredicate predicate);
 void EventsUpdate(void);
-int EventsRunnable(const unsigned ms_future, const Runnable run);
-int EventsSpriteConsumer(const unsigned ms_future,
+int EventsCancel(struct EventHandle *const handle);
+size_t EventsGetSize(void);
+struct EventHandle EventsRunnable(const unsigned ms_future,
+	const Runnable run);
+struct EventHandle EventsIntConsumer(const unsigned ms_future,
+	const IntConsumer accept, const int param);
+struct EventHandle EventsSpriteConsumer(const unsigned ms_future,
 	const SpriteConsumer accept, struct Sprite *const param);
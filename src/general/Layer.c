@@ -156,10 +156,11 @@ int LayerSetSpriteRectangle(struct Layer *const this,
 
 /** Set random. */
 void LayerSetRandom(struct Layer *const this, struct Ortho3f *const o) {
+	struct Random *const r = RandomStream(RANDOM_LAYER);
 	if(!this || !o) return;
-	o->x = random_pm_max(this->half_space);
-	o->y = random_pm_max(this->half_space);
-	o->theta = random_pm_max(M_PI_F);
+	o->x = random_pm_max(r, this->half_space);
+	o->y = random_pm_max(r, this->half_space);
+	o->theta = random_pm_max(r, M_PI_F);
 }
 
 /** For each bin on screen; used for drawing. */
@@ -172,6 +173,12 @@ void LayerForEachScreen(struct Layer *const this, const LayerAction action) {
 	for(i = 0; i < size; i++) action(*IntStackGetElement(step, i));
 }
 
+/** @return How many bins are on screen. */
+size_t LayerGetScreenSize(const struct Layer *const this) {
+	if(!this) return 0;
+	return IntStackGetSize(this->step[LAYER_SCREEN]);
+}
+
 /** For each bin on screen; used for plotting. */
 void LayerForEachScreenPlot(struct Layer *const this,
 	const LayerAcceptPlot accept, struct PlotData *const plot) {
@@ -194,3 +201,64 @@ void LayerSpriteForEachSprite(struct Layer *const this,
 	for(i = 0; i < size; i++)
 		action(*IntStackGetElement(step, i), i, onscreen);
 }
+
+/** For each bin at a Chebyshev distance of {ring} bins from the bin that
+ contains {x}; {ring} zero is just that bin. Unlike the screen and sprite
+ rectangles, this is not clipped to the screen and doesn't change the
+ {Layer}; used for neighbour queries.
+ @return False if the {ring} is entirely outside of the {Layer}. */
+int LayerForEachRingQuery(const struct Layer *const this,
+	const struct Vec2f *const x, const unsigned ring,
+	const LayerAcceptQuery accept, struct Query *const query) {
+	struct Vec2i c;
+	struct Rectangle4i r;
+	int i, is_any = 0;
+	const int n = (int)ring;
+	if(!this || !x || !accept || ring > (unsigned)this->side_size) return 0;
+	c.x = (x->x + this->half_space) * this->one_each_bin;
+	if(c.x < 0) c.x = 0;
+	else if(c.x >= this->side_size) c.x = this->side_size - 1;
+	c.y = (x->y + this->half_space) * this->one_each_bin;
+	if(c.y < 0) c.y = 0;
+	else if(c.y >= this->side_size) c.y = this->side_size - 1;
+	if(!n) return accept(c.y * this->side_size + c.x, query), 1;
+	r.x_min = c.x - n, r.x_max = c.x + n, r.y_min = c.y - n, r.y_max = c.y + n;
+	/* Top and bottom rows. */
+	for(i = r.x_min; i <= r.x_max; i++) {
+		if(i < 0 || i >= this->side_size) continue;
+		if(r.y_min >= 0)
+			accept(r.y_min * this->side_size + i, query), is_any = 1;
+		if(r.y_max < this->side_size)
+			accept(r.y_max * this->side_size + i, query), is_any = 1;
+	}
+	/* Left and right columns, not including the corners. */
+	for(i = r.y_min + 1; i < r.y_max; i++) {
+		if(i < 0 || i >= this->side_size) continue;
+		if(r.x_min >= 0)
+			accept(i * this->side_size + r.x_min, query), is_any = 1;
+		if(r.x_max < this->side_size)
+			accept(i * this->side_size + r.x_max, query), is_any = 1;
+	}
+	return is_any;
+}
+
+/** For each bin that overlaps {rect}, clipped to the {Layer}, but not to the
+ screen, and doesn't change the {Layer}; used for neighbour queries. */
+void LayerForEachRectangleQuery(const struct Layer *const this,
+	const struct Rectangle4f *const rect, const LayerAcceptQuery accept,
+	struct Query *const query) {
+	struct Rectangle4i bin4;
+	struct Vec2i bin2i;
+	if(!this || !rect || !accept) return;
+	bin4.x_min = (rect->x_min + this->half_space) * this->one_each_bin;
+	bin4.x_max = (rect->x_max + this->half_space) * this->one_each_bin;
+	bin4.y_min = (rect->y_min + this->half_space) * this->one_each_bin;
+	bin4.y_max = (rect->y_max + this->half_space) * this->one_each_bin;
+	if(bin4.x_min < 0) bin4.x_min = 0;
+	if(bin4.x_max >= this->side_size) bin4.x_max = this->side_size - 1;
+	if(bin4.y_min < 0) bin4.y_min = 0;
+	if(bin4.y_max >= this->side_size) bin4.y_max = this->side_size - 1;
+	for(bin2i.y = bin4.y_min; bin2i.y <= bin4.y_max; bin2i.y++)
+		for(bin2i.x = bin4.x_min; bin2i.x <= bin4.x_max; bin2i.x++)
+			accept(bin2i.y * this->side_size + bin2i.x, query);
+}
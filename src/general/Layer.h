@@ -4,8 +4,10 @@ struct Rectangle4f;
 struct Layer;
 struct Onscreen;
 struct PlotData;
+struct Query;
 typedef void (*LayerAction)(const unsigned);
 typedef void (*LayerAcceptPlot)(const unsigned, struct PlotData *const);
+typedef void (*LayerAcceptQuery)(const unsigned, struct Query *const);
 typedef void (*LayerNoOnscreenAction)(const unsigned, const unsigned,
 	struct Onscreen *const);
 
@@ -20,7 +22,14 @@ int LayerSetSpriteRectangle(struct Layer *const this,
 	struct Rectangle4f *const rect);
 void LayerSetRandom(struct Layer *const this, struct Ortho3f *const o);
 void LayerForEachScreen(struct Layer *const this, const LayerAction action);
+size_t LayerGetScreenSize(const struct Layer *const this);
 void LayerForEachScreenPlot(struct Layer *const this,
 	const LayerAcceptPlot accept, struct PlotData *const plot);
+int LayerForEachRingQuery(const struct Layer *const this,
+	const struct Vec2f *const x, const unsigned ring,
+	const LayerAcceptQuery accept, struct Query *const query);
+void LayerForEachRectangleQuery(const struct Layer *const this,
+	const struct Rectangle4f *const rect, const LayerAcceptQuery accept,
+	struct Query *const query);
 void LayerSpriteForEachSprite(struct Layer *const this,
 	struct Onscreen *const onscreen, const LayerNoOnscreenAction action);
@@ -0,0 +1,146 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ The LZ4 block format, without the frame around it. The Loader compresses
+ the decoded images with \see{Lz4Compress} at build time, and Void expands
+ them with \see{Lz4Decompress} right before they're uploaded; decompressing
+ is mostly {memcpy}, so it's much faster than decoding the {png} or {jpeg}.
+ The compressor is greedy with one candidate per hash; it's simple, and the
+ images are compressed only once.
+
+ @title		Lz4
+ @author	Neil
+ @std		C89/90
+ @version	2018-02 */
+
+#include <string.h> /* memcpy memset */
+#include "Lz4.h"
+
+/* The format. A match is at least {LZ4_MIN_MATCH}; the last
+ {LZ4_LAST_LITERALS} are always literals, and the last match starts at least
+ {LZ4_MF_LIMIT} before the end. */
+#define LZ4_MIN_MATCH (4)
+#define LZ4_LAST_LITERALS (5)
+#define LZ4_MF_LIMIT (12)
+#define LZ4_MAX_OFFSET (65535)
+/* The compressor's table. */
+#define LZ4_HASH_BITS (12)
+
+/** @return Four bytes at {p}, little-endian. */
+static unsigned long read32(const unsigned char *const p) {
+	return (unsigned long)p[0] | (unsigned long)p[1] << 8
+		| (unsigned long)p[2] << 16 | (unsigned long)p[3] << 24;
+}
+
+/** @return The table entry of the four bytes {v}. */
+static unsigned hash(const unsigned long v) {
+	return (unsigned)(((v * 2654435761ul) & 0xfffffffful)
+		>> (32 - LZ4_HASH_BITS));
+}
+
+/** Writes the rest of a length that didn't fit in the token.
+ @return After it. */
+static unsigned char *put_length(unsigned char *d, size_t length) {
+	for( ; length >= 255; length -= 255) *d++ = 255;
+	*d++ = (unsigned char)length;
+	return d;
+}
+
+/** Writes a sequence of {literals_size} {literals} followed by a match of
+ {match} at {offset} back; a {match} of zero is the last sequence.
+ @return After it. */
+static unsigned char *sequence(unsigned char *d,
+	const unsigned char *const literals, const size_t literals_size,
+	const size_t offset, size_t match) {
+	unsigned char *const token = d++;
+	*token = (unsigned char)((literals_size < 15 ? literals_size : 15) << 4);
+	if(literals_size >= 15) d = put_length(d, literals_size - 15);
+	memcpy(d, literals, literals_size), d += literals_size;
+	if(!match) return d;
+	*d++ = (unsigned char)(offset & 0xff), *d++ = (unsigned char)(offset >> 8);
+	match -= LZ4_MIN_MATCH;
+	*token |= (unsigned char)(match < 15 ? match : 15);
+	if(match >= 15) d = put_length(d, match - 15);
+	return d;
+}
+
+/** @return The most that \see{Lz4Compress} of {size} bytes can take. */
+size_t Lz4Bound(const size_t size) { return size + size / 255 + 16; }
+
+/** Compresses {src_size} bytes of {src} into {dst}.
+ @param dst_capacity: At least \see{Lz4Bound} of {src_size}.
+ @return The size in {dst} or zero if {dst_capacity} is too small. */
+size_t Lz4Compress(const unsigned char *const src, const size_t src_size,
+	unsigned char *const dst, const size_t dst_capacity) {
+	/* One more than the position; zero is nothing. */
+	size_t table[1 << LZ4_HASH_BITS], candidate, match;
+	const unsigned char *s = src, *anchor = src, *m, *match_end;
+	const unsigned char *const end = src + src_size;
+	unsigned char *d = dst;
+	unsigned long four;
+	unsigned h;
+	if(dst_capacity < Lz4Bound(src_size)) return 0;
+	memset(table, 0, sizeof table);
+	if(src_size > LZ4_MF_LIMIT) for(match_end = end - LZ4_LAST_LITERALS;
+		s < end - LZ4_MF_LIMIT; ) {
+		four = read32(s), h = hash(four);
+		candidate = table[h], table[h] = (size_t)(s - src) + 1;
+		if(!candidate || (size_t)(s - src) + 1 - candidate > LZ4_MAX_OFFSET
+			|| read32(m = src + candidate - 1) != four) { s++; continue; }
+		for(match = LZ4_MIN_MATCH; s + match < match_end
+			&& s[match] == m[match]; match++);
+		d = sequence(d, anchor, (size_t)(s - anchor), (size_t)(s - m), match);
+		s += match, anchor = s;
+	}
+	d = sequence(d, anchor, (size_t)(end - anchor), 0, 0);
+	return (size_t)(d - dst);
+}
+
+/** Reads the rest of a length that didn't fit in the token into {length}.
+ @return Success. */
+static int get_length(const unsigned char **const s,
+	const unsigned char *const end, size_t *const length) {
+	unsigned b;
+	do {
+		if(*s >= end) return 0;
+		b = *(*s)++, *length += b;
+	} while(b == 255);
+	return 1;
+}
+
+/** Decompresses {src_size} bytes of {src} into exactly {dst_size} bytes of
+ {dst}. It never reads or writes outside of them, even if {src} is corrupt.
+ @return Success. */
+int Lz4Decompress(const unsigned char *const src, const size_t src_size,
+	unsigned char *const dst, const size_t dst_size) {
+	const unsigned char *s = src, *m;
+	const unsigned char *const s_end = src + src_size;
+	unsigned char *d = dst;
+	unsigned char *const d_end = dst + dst_size;
+	size_t length, offset;
+	unsigned token;
+	for( ; ; ) {
+		if(s >= s_end) return 0;
+		token = *s++;
+		if((length = token >> 4) == 15 && !get_length(&s, s_end, &length))
+			return 0;
+		if((size_t)(s_end - s) < length || (size_t)(d_end - d) < length)
+			return 0;
+		memcpy(d, s, length), d += length, s += length;
+		/* The last sequence is only literals. */
+		if(s == s_end) break;
+		if(s_end - s < 2) return 0;
+		offset = (size_t)s[0] | (size_t)s[1] << 8, s += 2;
+		if(!offset || offset > (size_t)(d - dst)) return 0;
+		if((length = token & 15) == 15 && !get_length(&s, s_end, &length))
+			return 0;
+		length += LZ4_MIN_MATCH;
+		if((size_t)(d_end - d) < length) return 0;
+		m = d - offset;
+		/* It may overlap what it's writing; that's how runs are made. */
+		if(offset >= length) memcpy(d, m, length), d += length;
+		else while(length--) *d++ = *m++;
+	}
+	return d == d_end;
+}
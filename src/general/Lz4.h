@@ -0,0 +1,7 @@
+#include <stddef.h> /* size_t */
+
+size_t Lz4Bound(const size_t size);
+size_t Lz4Compress(const unsigned char *const src, const size_t src_size,
+	unsigned char *const dst, const size_t dst_capacity);
+int Lz4Decompress(const unsigned char *const src, const size_t src_size,
+	unsigned char *const dst, const size_t dst_size);
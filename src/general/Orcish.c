@@ -13,10 +13,10 @@
  @version	1.2, 2016-09
  @since		2014 */
 
-#include <stdlib.h> /* rand */
 #include <stdio.h>	/* snprintf strlen */
 #include <ctype.h>	/* toupper */
 #include <string.h>	/* strcat, strncat */
+#include "Random.h"
 #include "Orcish.h"
 
 static const char *syllables[] = {
@@ -57,12 +57,13 @@ static const unsigned suffixes_max_length = 7;
 static const unsigned max_name_size = 256;
 
 /** Takes {name}, a string, and replaces it, to a maximum of {name_size}
- characters, with a {rand} Orcish name. You must have space for (at least)
+ characters, with a random Orcish name from the {RANDOM_ORCISH} stream. You must have space for (at least)
  {name_size} (byte) characters.
  @param name: Filled with a random word in psudo-Orcish.
  @param name_size: sizeof(name); suggest 16, which would be enough for
  2 syllables and a suffix. */
 void Orcish(char *const name, const size_t name_size) {
+	struct Random *const r = RandomStream(RANDOM_ORCISH);
 	char *str;
 	int a;
 	const unsigned name_chars = (name_size > (unsigned)max_name_size) ?
@@ -75,12 +76,12 @@ void Orcish(char *const name, const size_t name_size) {
 	if(name_size == 1) {
 		return;
 	} else if(name_size < syllables_max_length + 1) {
-		a = (int)(rand() / (RAND_MAX + 1.0) * syllables_size);
+		a = RandomUniformInt(r, (int)syllables_size);
 		strncat(name, syllables[a], name_size - 1);
 	} else if(name_size < syllables_max_length + suffixes_max_length + 1) {
-		a = (int)(rand() / (RAND_MAX + 1.0) * syllables_size);
+		a = RandomUniformInt(r, (int)syllables_size);
 		str = strcat(name, syllables[a]);
-		a = (int)(rand() / (RAND_MAX + 1.0) * syllables_size);
+		a = RandomUniformInt(r, (int)syllables_size);
 		strncat(str, syllables[a], name_size - strlen(name) - 1);
 	} else {
 		unsigned i, no_syllables;
@@ -89,10 +90,10 @@ void Orcish(char *const name, const size_t name_size) {
 		str = name;
 		name[0] = '\0';
 		for(i = 0; i < no_syllables; i++) {
-			a = (int)(rand() / (RAND_MAX + 1.0) * syllables_size);
+			a = RandomUniformInt(r, (int)syllables_size);
 			str = strcat(str, syllables[a]);
 		}
-		a = (int)(rand() / (RAND_MAX + 1.0) * suffixes_size);
+		a = RandomUniformInt(r, (int)suffixes_size);
 		strcat(str, suffixes[a]);
 	}
 
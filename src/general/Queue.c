@@ -0,0 +1,162 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ A queue of draw commands, so that what is drawn is not tied to the order
+ it's found in the bins. The draw code pushes a small command for each thing
+ with a key made of the pass, the shader, the texture, and the normal
+ texture that goes with it; \see{QueueSubmit} radix-sorts them on the key and
+ hands them back in runs that share all of it, so the state only changes as often as the
+ passes need. It knows nothing about OpenGL; without callbacks, it only
+ counts, and that's how it's tested.
+
+ @title		Queue
+ @author	Neil
+ @std		C89/90
+ @version	2018-02 */
+
+#include <stdlib.h> /* realloc free */
+#include <stdio.h>  /* perror fprintf */
+#include <string.h> /* memset */
+#include "Queue.h"
+
+#define QUEUE_NORMAL_SHIFT  (0)
+#define QUEUE_TEXTURE_SHIFT (QUEUE_NORMAL_SHIFT + QUEUE_NORMAL_BITS)
+#define QUEUE_SHADER_SHIFT  (QUEUE_TEXTURE_SHIFT + QUEUE_TEXTURE_BITS)
+#define QUEUE_PASS_SHIFT    (QUEUE_SHADER_SHIFT + QUEUE_SHADER_BITS)
+#define QUEUE_KEY_BITS      (QUEUE_PASS_SHIFT + QUEUE_PASS_BITS)
+/* Sorted one byte at a time. */
+#define QUEUE_RADIX (256)
+
+static struct {
+	/* {scratch} is the other half of the sort; they swap. */
+	struct QueueCommand *commands, *scratch;
+	size_t size, capacity;
+} queue;
+
+/** Frees the commands. */
+void Queue_(void) {
+	free(queue.commands), queue.commands = 0;
+	free(queue.scratch), queue.scratch = 0;
+	queue.size = queue.capacity = 0;
+}
+
+/** Makes sure there's room for {min} commands.
+ @return Success. */
+static int reserve(const size_t min) {
+	struct QueueCommand *commands;
+	size_t c = queue.capacity ? queue.capacity : 256;
+	while(c < min) c <<= 1;
+	if(c <= queue.capacity) return 1;
+	if(!(commands = realloc(queue.commands, c * sizeof *commands)))
+		return perror("Queue"), 0;
+	queue.commands = commands;
+	if(!(commands = realloc(queue.scratch, c * sizeof *commands)))
+		return perror("Queue"), 0;
+	queue.scratch  = commands;
+	queue.capacity = c;
+	return 1;
+}
+
+/** Adds a command to be drawn on \see{QueueSubmit}.
+ @param pass, shader, texture, normal: The key, in order of precedence;
+ each must fit in it's bits in {Queue.h}. Without a normal, push the same one,
+ say zero, every time. Commands with the same key are drawn in the
+ order they are pushed.
+ @param data: Passed back in the command.
+ @return Success. */
+int QueuePush(const unsigned pass, const unsigned shader,
+	const unsigned texture, const unsigned normal, const unsigned data) {
+	struct QueueCommand *c;
+	if(pass >= 1u << QUEUE_PASS_BITS || shader >= 1u << QUEUE_SHADER_BITS
+		|| texture >= 1u << QUEUE_TEXTURE_BITS
+		|| normal >= 1u << QUEUE_NORMAL_BITS) {
+		fprintf(stderr, "Queue: command %u, %u, %u, %u out of range.\n",
+			pass, shader, texture, normal);
+		return 0;
+	}
+	if(queue.size >= queue.capacity && !reserve(queue.size + 1)) return 0;
+	c = queue.commands + queue.size++;
+	c->key = (unsigned long)pass << QUEUE_PASS_SHIFT
+		| (unsigned long)shader << QUEUE_SHADER_SHIFT
+		| (unsigned long)texture << QUEUE_TEXTURE_SHIFT
+		| (unsigned long)normal << QUEUE_NORMAL_SHIFT;
+	c->data = data;
+	return 1;
+}
+
+/** @return The number of commands waiting. */
+size_t QueueGetSize(void) { return queue.size; }
+
+/** @return The shader that {command} was pushed with. */
+unsigned QueueGetShader(const struct QueueCommand *const command) {
+	return (unsigned)(command->key >> QUEUE_SHADER_SHIFT)
+		& ((1u << QUEUE_SHADER_BITS) - 1);
+}
+
+/** @return The texture that {command} was pushed with. */
+unsigned QueueGetTexture(const struct QueueCommand *const command) {
+	return (unsigned)(command->key >> QUEUE_TEXTURE_SHIFT)
+		& ((1u << QUEUE_TEXTURE_BITS) - 1);
+}
+
+/** @return The normal that {command} was pushed with. */
+unsigned QueueGetNormal(const struct QueueCommand *const command) {
+	return (unsigned)(command->key >> QUEUE_NORMAL_SHIFT)
+		& ((1u << QUEUE_NORMAL_BITS) - 1);
+}
+
+/** Least-significant-digit radix sort on the key; it's stable, so commands
+ with the same key stay in the order they were pushed. A byte that is the
+ same in every key is skipped, which is most of them most of the time. */
+static void sort(void) {
+	size_t count[QUEUE_RADIX], i, sum, c;
+	const size_t n = queue.size;
+	unsigned shift;
+	struct QueueCommand *from = queue.commands, *to = queue.scratch, *temp;
+	for(shift = 0; shift < QUEUE_KEY_BITS; shift += 8) {
+		memset(count, 0, sizeof count);
+		for(i = 0; i < n; i++) count[(from[i].key >> shift) & 0xff]++;
+		if(count[(from[0].key >> shift) & 0xff] == n) continue;
+		for(sum = 0, i = 0; i < QUEUE_RADIX; i++)
+			c = count[i], count[i] = sum, sum += c;
+		for(i = 0; i < n; i++) to[count[(from[i].key >> shift) & 0xff]++]
+			= from[i];
+		temp = from, from = to, to = temp;
+	}
+	queue.commands = from, queue.scratch = to;
+}
+
+/** Sorts the commands, and calls {shader} on every change of shader and
+ {batch} on every run of the same key. A change of texture or of normal
+ counts as one change of textures. Empties the queue.
+ @param shader, batch: If null, nothing is called; it's headless.
+ @param stats: If non-null, filled with the counts. */
+void QueueSubmit(const QueueShader shader, const QueueBatch batch,
+	struct QueueStats *const stats) {
+	struct QueueStats s = { 0, 0, 0, 0 };
+	const struct QueueCommand *c;
+	unsigned last_shader = 0, last_texture = 0;
+	size_t i, j;
+	if(queue.size > 1) sort();
+	for(i = 0; i < queue.size; i = j) {
+		const unsigned long state = queue.commands[i].key;
+		unsigned sdr, tex;
+		c = queue.commands + i;
+		for(j = i + 1; j < queue.size && queue.commands[j].key == state; j++);
+		sdr = QueueGetShader(c);
+		tex = QueueGetTexture(c) << QUEUE_NORMAL_BITS | QueueGetNormal(c);
+		if(!s.batches || sdr != last_shader) {
+			s.shaders++, last_shader = sdr;
+			if(shader) shader(sdr);
+			s.textures++, last_texture = tex;
+		} else if(tex != last_texture) {
+			s.textures++, last_texture = tex;
+		}
+		s.batches++;
+		if(batch) batch(c, j - i);
+	}
+	s.commands = (unsigned)queue.size;
+	if(stats) *stats = s;
+	queue.size = 0;
+}
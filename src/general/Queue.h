@@ -0,0 +1,41 @@
+#ifndef QUEUE_H /* <-- idempotent */
+#define QUEUE_H
+
+#include <stddef.h> /* size_t */
+
+/* The key of a command is these, from most significant; they must add up to
+ no more than 32. */
+#define QUEUE_PASS_BITS    (4)
+#define QUEUE_SHADER_BITS  (4)
+#define QUEUE_TEXTURE_BITS (8)
+#define QUEUE_NORMAL_BITS  (8)
+
+/** A command; {data} is whatever the pusher needs to find what it's drawing. */
+struct QueueCommand {
+	unsigned long key;
+	unsigned data;
+};
+
+/** What \see{QueueSubmit} did, or would have done. */
+struct QueueStats {
+	unsigned commands, shaders, textures, batches;
+};
+
+/** Called when the shader changes. */
+typedef void (*QueueShader)(const unsigned shader);
+/** Called with a run of commands that have the same pass, shader, texture,
+ and normal, in the order they were pushed. */
+typedef void (*QueueBatch)(const struct QueueCommand *const commands,
+	const size_t size);
+
+void Queue_(void);
+int QueuePush(const unsigned pass, const unsigned shader,
+	const unsigned texture, const unsigned normal, const unsigned data);
+size_t QueueGetSize(void);
+unsigned QueueGetShader(const struct QueueCommand *const command);
+unsigned QueueGetTexture(const struct QueueCommand *const command);
+unsigned QueueGetNormal(const struct QueueCommand *const command);
+void QueueSubmit(const QueueShader shader, const QueueBatch batch,
+	struct QueueStats *const stats);
+
+#endif /* idempotent --> */
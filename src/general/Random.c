@@ -1,31 +1,187 @@
 /** Copyright 2016 Neil Edelman, distributed under the terms of the
  GNU General Public License, see copying.txt.
 
- This provides access to random functions. There is no object, just static.
- These functions use rand(), so if you want it to return different values, you
- can use srand().
+ This provides random streams. {xoshiro128**} by David Blackman and Sebastiano
+ Vigna, \url{ http://xoshiro.di.unimi.it/ }, is small, fast, and has a period
+ of {2^128 - 1}; the jump function gives {2^64} non-overlapping streams. It
+ uses only 32-bit words, so it works with {unsigned long} in C89.
+
+ There is one stream for every subsystem, \see{RandomStream}, all seeded from
+ the one value given to \see{Random}. Anything that wants a stream of it's own,
+ (eg, a thread,) can have a {struct Random} and \see{RandomSplit} it off of
+ one of the subsystem's streams.
 
  @title		Random
  @author	Neil
- @version	3.3; 2016-01
+ @std		C89/90
+ @version	2018-01 Replaced {rand} with {xoshiro128**} streams.
  @since		3.3; 2016-01 */
 
-#include <stdlib.h> /* rand */
+#include <math.h> /* sqrt log */
+#include <assert.h>
 #include "Random.h"
 
-/* public */
+#define RANDOM_32 (0xffffffffUL)
+
+/* The subsystem streams. */
+static struct Randoms {
+	int is_seeded;
+	unsigned long seed;
+	struct Random streams[RANDOM_STREAMS];
+} randoms;
+
+/** @return {x} rotated by {k} in 32 bits. */
+static unsigned long rotl(const unsigned long x, const unsigned k) {
+	return ((x << k) | (x >> (32 - k))) & RANDOM_32;
+}
+
+/** {splitmix32}; used to expand a seed into a state. */
+static unsigned long splitmix(unsigned long *const z) {
+	unsigned long x;
+	assert(z);
+	x = *z = (*z + 0x9e3779b9UL) & RANDOM_32;
+	x = ((x ^ (x >> 16)) * 0x85ebca6bUL) & RANDOM_32;
+	x = ((x ^ (x >> 13)) * 0xc2b2ae35UL) & RANDOM_32;
+	return x ^ (x >> 16);
+}
+
+/** Seeds {this} with {seed}. */
+void RandomSeed(struct Random *const this, const unsigned long seed) {
+	unsigned long z = seed & RANDOM_32;
+	unsigned i;
+	if(!this) return;
+	for(i = 0; i < 4; i++) this->s[i] = splitmix(&z);
+	/* The all-zero state is the only one that doesn't work. */
+	if(!(this->s[0] | this->s[1] | this->s[2] | this->s[3])) this->s[0] = 1;
+	this->gauss = 0.0f;
+	this->is_gauss = 0;
+}
+
+/** @return The next 32 bits of {this}.
+ @order \Theta(1) */
+unsigned long RandomNext(struct Random *const this) {
+	unsigned long *const s = this->s, result, t;
+	assert(this);
+	result = (rotl((s[1] * 5) & RANDOM_32, 7) * 9) & RANDOM_32;
+	t = (s[1] << 9) & RANDOM_32;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 11);
+	return result;
+}
+
+/** Advances {this} by {2^64} numbers, so it doesn't overlap with where it
+ was. */
+void RandomJump(struct Random *const this) {
+	static const unsigned long jump[] =
+		{ 0x8764000bUL, 0xf542d2d3UL, 0x6fa035c3UL, 0x77f2db5bUL };
+	unsigned long s[4] = { 0, 0, 0, 0 };
+	unsigned i, b, j;
+	if(!this) return;
+	for(i = 0; i < sizeof jump / sizeof *jump; i++) {
+		for(b = 0; b < 32; b++) {
+			if(jump[i] & (1UL << b))
+				for(j = 0; j < 4; j++) s[j] ^= this->s[j];
+			RandomNext(this);
+		}
+	}
+	for(j = 0; j < 4; j++) this->s[j] = s[j];
+	this->is_gauss = 0;
+}
+
+/** Gives {this} a stream of it's own that is independent of {parent}; {parent}
+ is advanced. */
+void RandomSplit(struct Random *const this, struct Random *const parent) {
+	if(!this || !parent) return;
+	RandomJump(parent);
+	*this = *parent;
+	RandomJump(parent);
+}
+
+/** Seeds all the subsystem streams with one {seed}. */
+void Random(const unsigned long seed) {
+	unsigned i;
+	randoms.seed = seed & RANDOM_32;
+	RandomSeed(randoms.streams, randoms.seed);
+	for(i = 1; i < RANDOM_STREAMS; i++) {
+		randoms.streams[i] = randoms.streams[i - 1];
+		RandomJump(randoms.streams + i);
+	}
+	randoms.is_seeded = 1;
+}
+
+/** @return The seed that was given to \see{Random}. */
+unsigned long RandomGetSeed(void) {
+	if(!randoms.is_seeded) Random(0);
+	return randoms.seed;
+}
+
+/** @return The {stream}. If one hasn't called \see{Random}, it's seeded with
+ zero. */
+struct Random *RandomStream(const enum RandomStream stream) {
+	if(stream >= RANDOM_STREAMS) return 0;
+	if(!randoms.is_seeded) Random(0);
+	return randoms.streams + stream;
+}
 
 /** Uniform integer.
- @param sigma
- @return		Random int about [-max, max]. */
-int RandomUniformInt(const int max) {
+ @return Random int {[0, max)}, or zero if {max} is not positive. */
+int RandomUniformInt(struct Random *const this, const int max) {
 	if(max <= 0) return 0;
-	return rand() / (RAND_MAX / max + 1);
+	/* Multiply-shift; fast, but has a bias of {max/2^32}. */
+	return (int)((RandomNext(this) >> 16) * (unsigned long)max >> 16);
 }
 
 /** Uniform float.
- @param sigma
- @return		Random int about [-max, max]. */
-float RandomUniformFloat(const float max) {
-	return (float)((rand() / (1.0 + RAND_MAX) - 0.5) * 2.0 * max);
+ @return Random float {[-max, max)}. */
+float RandomUniformFloat(struct Random *const this, const float max) {
+	/* 24 bits is all a float has. */
+	return ((float)(RandomNext(this) >> 8) * (2.0f / 16777216.0f) - 1.0f)
+		* max;
+}
+
+/** Normal distribution by Marsaglia's polar method; it makes two at a time,
+ so every other one is free.
+ @return Random float with mean zero and standard deviation {sigma}. */
+float RandomGaussFloat(struct Random *const this, const float sigma) {
+	float u, v, s;
+	assert(this);
+	if(this->is_gauss) return this->is_gauss = 0, this->gauss * sigma;
+	do {
+		u = RandomUniformFloat(this, 1.0f);
+		v = RandomUniformFloat(this, 1.0f);
+		s = u * u + v * v;
+	} while(s >= 1.0f || s == 0.0f);
+	s = (float)sqrt(-2.0 * log(s) / s);
+	this->gauss = v * s, this->is_gauss = 1;
+	return u * s * sigma;
+}
+
+/** Fills {a} with {a_size} uniform floats, \see{RandomUniformFloat}. */
+void RandomUniformFloats(struct Random *const this, float *const a,
+	const size_t a_size, const float max) {
+	unsigned long s0, s1, s2, s3, t, r;
+	size_t i;
+	if(!this || !a) return;
+	/* Local copy of the state so it can stay in registers. */
+	s0 = this->s[0], s1 = this->s[1], s2 = this->s[2], s3 = this->s[3];
+	for(i = 0; i < a_size; i++) {
+		r = (rotl((s1 * 5) & RANDOM_32, 7) * 9) & RANDOM_32;
+		t = (s1 << 9) & RANDOM_32;
+		s2 ^= s0, s3 ^= s1, s1 ^= s2, s0 ^= s3, s2 ^= t;
+		s3 = rotl(s3, 11);
+		a[i] = ((float)(r >> 8) * (2.0f / 16777216.0f) - 1.0f) * max;
+	}
+	this->s[0] = s0, this->s[1] = s1, this->s[2] = s2, this->s[3] = s3;
+}
+
+/** Fills {a} with {a_size} normal floats, \see{RandomGaussFloat}. */
+void RandomGaussFloats(struct Random *const this, float *const a,
+	const size_t a_size, const float sigma) {
+	size_t i;
+	if(!this || !a) return;
+	for(i = 0; i < a_size; i++) a[i] = RandomGaussFloat(this, sigma);
 }
@@ -1,2 +1,39 @@
-int RandomUniformInt(const int max);
-float RandomUniformFloat(const float max);
+#ifndef RANDOM_H /* <-- idempotent */
+#define RANDOM_H
+
+#include <stddef.h> /* size_t */
+
+/** One independent stream of random numbers. Streams are small and have no
+ hidden state, so anything, (eg, a thread,) can own one. */
+struct Random {
+	unsigned long s[4];
+	float gauss;
+	int is_gauss;
+};
+
+/** Each subsystem has it's own stream so that they don't disturb each other;
+ this makes runs reproducible given \see{RandomGetSeed}. */
+enum RandomStream {
+	RANDOM_LAYER,
+	RANDOM_ORCISH,
+	RANDOM_DEBRIS,
+	RANDOM_AI,
+	RANDOM_STREAMS
+};
+
+void RandomSeed(struct Random *const this, const unsigned long seed);
+void RandomJump(struct Random *const this);
+void RandomSplit(struct Random *const this, struct Random *const parent);
+void Random(const unsigned long seed);
+unsigned long RandomGetSeed(void);
+struct Random *RandomStream(const enum RandomStream stream);
+unsigned long RandomNext(struct Random *const this);
+int RandomUniformInt(struct Random *const this, const int max);
+float RandomUniformFloat(struct Random *const this, const float max);
+float RandomGaussFloat(struct Random *const this, const float sigma);
+void RandomUniformFloats(struct Random *const this, float *const a,
+	const size_t a_size, const float max);
+void RandomGaussFloats(struct Random *const this, float *const a,
+	const size_t a_size, const float sigma);
+
+#endif /* idempotent --> */
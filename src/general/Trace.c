@@ -0,0 +1,210 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ Scoped markers for the phases of a frame. \see{TraceBegin} and
+ \see{TraceEnd} nest; when a marker ends, it becomes a span in a ring buffer
+ that holds the last {TRACE_SPANS}, so it costs two clock readings and no
+ allocation. Every thread that traces has a ring of its own, taken the first
+ time and given back when the thread exits, so only taking one needs a lock;
+ {Workers} jobs are spans on their thread's ring. \see{TraceDump} writes the
+ rings in the Chrome trace event format, one track per ring, which can be
+ opened in {chrome://tracing} or \url{ https://ui.perfetto.dev/ }. It should
+ be called when no other thread is tracing, as it is between {Workers} jobs.
+
+ @title		Trace
+ @author	Neil
+ @std		C89/90, POSIX gettimeofday and threads if available
+ @version	2018-02 */
+
+/* Milliseconds from {GLUT} are too coarse for a frame. */
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)) /* <-- posix */
+#define TRACE_GETTIMEOFDAY
+#define TRACE_PTHREAD
+#define _XOPEN_SOURCE 500
+#include <sys/time.h> /* gettimeofday */
+#include <pthread.h>
+#else /* posix --><-- !posix */
+#include <time.h> /* clock */
+#endif /* !posix --> */
+#include <stdio.h> /* fopen fprintf */
+#include "Trace.h"
+
+/* Must be a power of two. */
+#define TRACE_SPANS (8192)
+#define TRACE_DEPTH (16)
+/* Threads that can trace at once; more are not traced. */
+#define TRACE_THREADS (8)
+
+static const char *const trace_default_fn = "Void.trace.json";
+
+static struct Trace {
+	const char *fn;
+	int is_started;
+	unsigned long start;
+	/* Ring {0} is the first thread that traced, which is the one that runs
+	 GLUT. Only its own thread writes to a ring. */
+	struct TraceRing {
+		int is_used;
+		struct TraceOpen { const char *name; unsigned long us; }
+			open[TRACE_DEPTH];
+		unsigned depth;
+		struct TraceSpan { const char *name; unsigned long us, dur; }
+			span[TRACE_SPANS];
+		unsigned long spans;
+	} ring[TRACE_THREADS];
+	unsigned rings; /* the most that have been used */
+#ifdef TRACE_PTHREAD /* <-- pthread */
+	pthread_once_t once;
+	pthread_key_t key;
+	pthread_mutex_t mutex;
+	int is_key;
+#endif /* pthread --> */
+} trace
+#ifdef TRACE_PTHREAD /* <-- pthread */
+	= { 0, 0, 0ul, { { 0, { { 0, 0ul } }, 0, { { 0, 0ul, 0ul } }, 0ul } }, 0,
+	PTHREAD_ONCE_INIT, 0, PTHREAD_MUTEX_INITIALIZER, 0 }
+#endif /* pthread --> */
+	;
+
+/** @return Microseconds since the first ring was taken; it loops around. */
+static unsigned long trace_us(void) {
+	unsigned long us;
+#ifdef TRACE_GETTIMEOFDAY /* <-- posix */
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	us = (unsigned long)tv.tv_sec * 1000000ul + (unsigned long)tv.tv_usec;
+#else /* posix --><-- !posix; processor time is better than nothing */
+	us = (unsigned long)(clock() * (1000000.0 / CLOCKS_PER_SEC));
+#endif /* !posix --> */
+	return us - trace.start;
+}
+
+/** Takes the first free ring; under the lock if there are threads.
+ @return The ring or null if they are all used. */
+static struct TraceRing *trace_take(void) {
+	struct TraceRing *r;
+	unsigned i;
+	for(i = 0; i < TRACE_THREADS && trace.ring[i].is_used; i++);
+	if(i >= TRACE_THREADS) return 0;
+	r = trace.ring + i;
+	r->is_used = 1;
+	r->depth = 0;
+	if(i >= trace.rings) trace.rings = i + 1;
+	if(!trace.is_started) trace.start = 0, trace.start = trace_us(),
+		trace.is_started = 1;
+	return r;
+}
+
+#ifdef TRACE_PTHREAD /* <-- pthread */
+/** Gives back the ring of a thread that's exiting; the spans stay until
+ another thread takes it.
+ @implements pthread_key_create */
+static void trace_give(void *const ring) {
+	struct TraceRing *const r = ring;
+	pthread_mutex_lock(&trace.mutex);
+	r->is_used = 0;
+	pthread_mutex_unlock(&trace.mutex);
+}
+/** @implements pthread_once */
+static void trace_key(void) {
+	trace.is_key = !pthread_key_create(&trace.key, &trace_give);
+}
+#endif /* pthread --> */
+
+/** @return The ring of this thread, taking one if it has none, or null if
+ they are all used. */
+static struct TraceRing *trace_ring(void) {
+#ifdef TRACE_PTHREAD /* <-- pthread */
+	struct TraceRing *r;
+	pthread_once(&trace.once, &trace_key);
+	if(!trace.is_key) return 0;
+	if((r = pthread_getspecific(trace.key))) return r;
+	pthread_mutex_lock(&trace.mutex);
+	r = trace_take();
+	pthread_mutex_unlock(&trace.mutex);
+	if(r && pthread_setspecific(trace.key, r)) trace_give(r), r = 0;
+	return r;
+#else /* pthread --><-- !pthread; one thread */
+	return trace.ring[0].is_used ? trace.ring : trace_take();
+#endif /* !pthread --> */
+}
+
+/** Writes the rings to {fn} as a Chrome trace. */
+static void trace_dump(const char *const fn) {
+	FILE *fp;
+	const struct TraceRing *r;
+	unsigned t;
+	unsigned long i, from, spans = 0;
+	int is_over = 0;
+	if(!(fp = fopen(fn, "w"))) { perror(fn); return; }
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+		"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+		"\"args\":{\"name\":\"Void\"}}");
+	for(t = 0; t < trace.rings; t++) {
+		r = trace.ring + t;
+		from = i = r->spans > TRACE_SPANS ? r->spans - TRACE_SPANS : 0;
+		fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+			"\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}", t + 1,
+			t ? "worker" : "GLUT", t);
+		for( ; i < r->spans; i++) {
+			const struct TraceSpan *const s = r->span + (i & (TRACE_SPANS - 1));
+			fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lu,"
+				"\"dur\":%lu,\"pid\":1,\"tid\":%u}", s->name, s->us, s->dur,
+				t + 1);
+		}
+		spans += r->spans - from;
+		if(from) is_over = 1;
+	}
+	fprintf(fp, "\n]}\n");
+	if(fclose(fp) == EOF) { perror(fn); return; }
+	fprintf(stderr, "Trace: wrote %lu spans from %u threads to %s%s.\n", spans,
+		trace.rings, fn, is_over ? " (older spans were overwritten)" : "");
+}
+
+/** Writes the trace if \see{Trace} was given a file. */
+void Trace_(void) {
+	if(trace.fn) trace_dump(trace.fn);
+	trace.fn = 0;
+}
+
+/** Markers are always recorded; this sets where they go on exit.
+ @param fn: The file that \see{Trace_} writes; if null, it writes nothing. */
+void Trace(const char *const fn) {
+	trace.fn = fn;
+	trace_ring();
+}
+
+/** Starts a marker.
+ @param name: A string literal, without quotes, that is shown as the name of
+ the span; it is not copied. */
+void TraceBegin(const char *const name) {
+	struct TraceRing *const r = trace_ring();
+	if(!r) return;
+	if(r->depth < TRACE_DEPTH) {
+		struct TraceOpen *const o = r->open + r->depth;
+		o->name = name;
+		o->us   = trace_us();
+	}
+	r->depth++;
+}
+
+/** Ends the most recent \see{TraceBegin}, making it a span. */
+void TraceEnd(void) {
+	struct TraceRing *const r = trace_ring();
+	const struct TraceOpen *o;
+	struct TraceSpan *s;
+	if(!r || !r->depth || --r->depth >= TRACE_DEPTH) return;
+	o = r->open + r->depth;
+	s = r->span + (r->spans++ & (TRACE_SPANS - 1));
+	s->name = o->name;
+	s->us   = o->us;
+	s->dur  = trace_us() - o->us;
+}
+
+/** Writes the spans so far to the file given to \see{Trace}, or
+ {Void.trace.json}.
+ @implements Runnable */
+void TraceDump(void) {
+	trace_dump(trace.fn ? trace.fn : trace_default_fn);
+}
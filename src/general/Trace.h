@@ -0,0 +1,5 @@
+void Trace_(void);
+void Trace(const char *const fn);
+void TraceBegin(const char *const name);
+void TraceEnd(void);
+void TraceDump(void);
@@ -0,0 +1,161 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ A pool of threads, one for each core, that do numbered jobs while the
+ thread that started them takes them back one at a time as they finish,
+ \see{WorkersNext}. The jobs are started in order, but they finish in any
+ order. Without POSIX threads, or if they can't be started, the jobs are done
+ one at a time in \see{WorkersNext} instead, so the caller doesn't change.
+
+ @title		Workers
+ @author	Neil
+ @std		C89/90, POSIX threads
+ @version	2018-02 */
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)) /* <-- posix */
+#define WORKERS_PTHREAD
+#define _XOPEN_SOURCE 500 /* sysconf */
+#include <pthread.h>
+#include <unistd.h>
+#endif /* posix --> */
+#include <stdlib.h> /* malloc free */
+#include <stdio.h>  /* perror */
+#include "Trace.h"
+#include "Workers.h"
+
+/* The most threads, whatever the number of cores. */
+#define WORKERS_MAX (16)
+
+static struct {
+	WorkersWork work;
+	size_t size;
+	/* Jobs given to a thread, and jobs given back by \see{WorkersNext}. */
+	size_t started, returned;
+	/* Jobs in the order they finished, and whether each worked. */
+	size_t *finished, finished_size;
+	int *is_done;
+	unsigned threads_size;
+#ifdef WORKERS_PTHREAD /* <-- pthread */
+	int is_sync;
+	pthread_t threads[WORKERS_MAX];
+	pthread_mutex_t mutex;
+	pthread_cond_t is_finished;
+#endif /* pthread --> */
+} workers;
+
+/** Waits for the jobs that have started; the rest are never done. Frees
+ everything. */
+void WorkersEnd(void) {
+#ifdef WORKERS_PTHREAD /* <-- pthread */
+	unsigned t;
+	if(workers.is_sync) {
+		pthread_mutex_lock(&workers.mutex);
+		workers.started = workers.size;
+		pthread_mutex_unlock(&workers.mutex);
+		for(t = 0; t < workers.threads_size; t++)
+			pthread_join(workers.threads[t], 0);
+		pthread_cond_destroy(&workers.is_finished);
+		pthread_mutex_destroy(&workers.mutex);
+		workers.is_sync = 0;
+	}
+#endif /* pthread --> */
+	workers.threads_size = 0;
+	free(workers.finished), workers.finished = 0;
+	free(workers.is_done), workers.is_done = 0;
+	workers.size = workers.started = workers.returned = 0;
+	workers.finished_size = 0;
+}
+
+#ifdef WORKERS_PTHREAD /* <-- pthread */
+/** Does jobs until there are none left to start.
+ @implements pthread_create */
+static void *worker(void *const unused) {
+	size_t i;
+	int is_done;
+	(void)unused;
+	for( ; ; ) {
+		pthread_mutex_lock(&workers.mutex);
+		if(workers.started >= workers.size)
+			{ pthread_mutex_unlock(&workers.mutex); break; }
+		i = workers.started++;
+		pthread_mutex_unlock(&workers.mutex);
+		TraceBegin("work");
+		is_done = workers.work(i);
+		TraceEnd();
+		pthread_mutex_lock(&workers.mutex);
+		workers.is_done[i] = is_done;
+		workers.finished[workers.finished_size++] = i;
+		pthread_cond_signal(&workers.is_finished);
+		pthread_mutex_unlock(&workers.mutex);
+	}
+	return 0;
+}
+
+/** @return How many threads to start for {size} jobs. */
+static unsigned cores(const size_t size) {
+	long c = 0;
+#ifdef _SC_NPROCESSORS_ONLN /* <-- cores */
+	c = sysconf(_SC_NPROCESSORS_ONLN);
+#endif /* cores --> */
+	if(c < 1) c = 1;
+	if(c > WORKERS_MAX) c = WORKERS_MAX;
+	if((size_t)c > size) c = (long)size;
+	return (unsigned)c;
+}
+#endif /* pthread --> */
+
+/** Starts {size} jobs, numbered from zero, each done by {work}; they're taken
+ back with \see{WorkersNext} and then \see{WorkersEnd}.
+ @return The number of threads doing them; zero if they're done in
+ \see{WorkersNext}. */
+unsigned WorkersBegin(const size_t size, const WorkersWork work) {
+#ifdef WORKERS_PTHREAD /* <-- pthread */
+	unsigned threads;
+#endif /* pthread --> */
+	WorkersEnd();
+	workers.work = work, workers.size = size;
+	if(!size) return 0;
+#ifdef WORKERS_PTHREAD /* <-- pthread */
+	threads = cores(size);
+	if(!(workers.finished = malloc(sizeof *workers.finished * size))
+		|| !(workers.is_done = malloc(sizeof *workers.is_done * size))) {
+		perror("Workers");
+		return 0;
+	}
+	if(pthread_mutex_init(&workers.mutex, 0)) return 0;
+	if(pthread_cond_init(&workers.is_finished, 0))
+		{ pthread_mutex_destroy(&workers.mutex); return 0; }
+	workers.is_sync = 1;
+	while(workers.threads_size < threads && !pthread_create(workers.threads
+		+ workers.threads_size, 0, &worker, 0)) workers.threads_size++;
+#endif /* pthread --> */
+	return workers.threads_size;
+}
+
+/** Waits for any job to finish, if none have.
+ @param index: The job that finished.
+ @param is_done: What it returned.
+ @return Whether there was a job; false after all of them. */
+int WorkersNext(size_t *const index, int *const is_done) {
+	size_t i;
+	if(workers.returned >= workers.size) return 0;
+#ifdef WORKERS_PTHREAD /* <-- pthread */
+	if(workers.threads_size) {
+		pthread_mutex_lock(&workers.mutex);
+		while(workers.returned >= workers.finished_size)
+			pthread_cond_wait(&workers.is_finished, &workers.mutex);
+		i = workers.finished[workers.returned++];
+		*is_done = workers.is_done[i];
+		pthread_mutex_unlock(&workers.mutex);
+		*index = i;
+		return 1;
+	}
+#endif /* pthread --> */
+	/* No threads; it's done here. */
+	i = workers.started++, workers.returned++;
+	TraceBegin("work");
+	*index = i, *is_done = workers.work(i);
+	TraceEnd();
+	return 1;
+}
@@ -0,0 +1,10 @@
+#include <stddef.h> /* size_t */
+
+/** Does job {index}; called from a worker thread, so it must not touch
+ anything the other jobs or the caller of \see{WorkersNext} do.
+ @return Success. */
+typedef int (*WorkersWork)(const size_t index);
+
+unsigned WorkersBegin(const size_t size, const WorkersWork work);
+int WorkersNext(size_t *const index, int *const is_done);
+void WorkersEnd(void);
@@ -8,17 +8,23 @@
  @version	2015-05
  @since		2000 */
 
+#include <stddef.h> /* offsetof */
 #include <stdio.h>  /* *printf */
-#include <stdlib.h> /* free */
+#include <stdlib.h> /* malloc free */
 #include <assert.h> /* assert */
 #include <math.h>   /* sqrtf fminf fmodf atan2f */
+#include <string.h> /* strstr memcpy */
 #include "../../build/Auto.h" /* for images */
 #include "../Ortho.h"
 #include "../game/Sprites.h" /* in display */
 #include "../game/Fars.h" /* in display */
-#include "../../external/lodepng.h"  /* in texture */
-#include "../../external/nanojpeg.h" /* in texture */
+#include "../general/Trace.h" /* in display */
+#include "../general/Queue.h" /* in display */
+#include "../general/Lz4.h" /* in textures */
+#include "../general/Workers.h" /* in textures */
 #include "../Window.h" /* WindowIsGlError */
+#include "Programs.h" /* ProgramsLoad ProgramsStore in the shaders */
+#include "Glew.h" /* GlewIsExtension */
 #include "Draw.h"
 /* Auto-generated, hard coded resouce files from Vsfs2h; run "make"
  and this should be automated.
@@ -28,6 +34,22 @@
 #include "../../build/shaders/Far_vsfs.h"
 #include "../../build/shaders/Info_vsfs.h"
 #include "../../build/shaders/Hud_vsfs.h"
+#include "../../build/shaders/Normals_vsfs.h"
+#include "../../build/shaders/Light_vsfs.h"
+
+/* Must be the same as in Lambert.fs and Sprites.c. The screen is split into
+ {LIGHT_TILES} by {LIGHT_TILES} tiles and each tile has up to
+ {LIGHTS_PER_TILE} of the lights that reach it, so a fragment only has to look
+ at those. */
+#define MAX_LIGHTS (256)
+#define LIGHT_TILES (16)
+#define LIGHTS_PER_TILE (16)
+/* A light reaches as far as it's brightest channel over this. */
+static const float light_threshold = 0.1f;
+/* Lambert is compiled with each of these as {LIGHTS}, the most lights it looks
+ at in a tile; \see{lambert_use}. */
+static const unsigned lambert_lights[] = { 0, 4, LIGHTS_PER_TILE };
+#define LAMBERT_TIERS (sizeof lambert_lights / sizeof *lambert_lights)
 
 #define M_2PI 6.283185307179586476925286766559005768394338798750211641949889
 #define M_1_2PI 0.159154943091895335768883763372514362034459645740456448747667
@@ -42,6 +64,10 @@ enum TexClass {
 	TEX_CLASS_SPRITE,
 	TEX_CLASS_NORMAL,
 	TEX_CLASS_BACKGROUND,
+	TEX_CLASS_LIGHT_TABLE,
+	TEX_CLASS_LIGHT_INDEX,
+	TEX_CLASS_DEFERRED_NORMALS,
+	TEX_CLASS_DEFERRED_LIGHT,
 	TEX_CLASS_NO
 };
 static GLuint TexClassTexture(const enum TexClass class) {
@@ -72,7 +98,10 @@ struct {
 /* Used in {vertex_attribute} as an index. */
 enum {
 	/* vec2 */ VBO_ATTRIB_VERTEX,
-	/* vec2 */ VBO_ATTRIB_TEXTURE
+	/* vec2 */ VBO_ATTRIB_TEXTURE,
+	/* vec4 */ VBO_ATTRIB_INSTANCE, /* {attrib_light} in Light */
+	/* vec4 */ VBO_ATTRIB_TEXTURE_RECT, /* {attrib_colour} in Light */
+	/* vec4 */ VBO_ATTRIB_NORMAL_RECT
 };
 /** Shader attribute assignment. There are two two-vectors corresponding to the
  two VBO enums, and hence four entries per vertex in {vertices}. */
@@ -89,6 +118,23 @@ static const struct {
 	GLint first;
 	GLsizei count;
 } vertex_index_background = { 0, 4 }, vertex_index_square = { 4, 4 };
+/* {attrib_instance}, {attrib_texture_rect}, and {attrib_normal_rect} in
+ Lambert.vs; one per sprite. */
+struct Instance { GLfloat x, y, angle, size, texture[4], normal[4]; };
+/* The rectangle of an image that has it's own texture. */
+static const GLfloat whole_rect[] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+/* Order of drawing; \see{QueuePush}. The first two are only when lighting is
+ deferred, \see{DrawDeferred.h}. */
+enum DrawPass { PASS_NORMALS, PASS_LIGHTS, PASS_FAR, PASS_SPRITES, PASS_INFO };
+/* Shaders that draw from the queue. */
+enum DrawShader { SHADER_NORMALS, SHADER_LIGHT, SHADER_FAR, SHADER_LAMBERT,
+	SHADER_INFO, SHADER_NONE };
+/* What a command in the queue draws. */
+struct DrawItem {
+	struct Instance instance;
+	const struct AutoImage *texture, *normal;
+};
 
 /* Internal draw things. */
 static struct {
@@ -96,16 +142,421 @@ static struct {
 	int is_started;
 	/* Sprites used in debugging; initialised in {Draw}. */
 	const struct AutoImage *icon_light;
+	/* Small images packed by the Loader, or null. */
+	const struct AutoImage *atlas;
 	/* Pointers to a GPU-buffers. */
 	struct { GLuint vertices; } arrays;
 	/* Pointers to GPU textures. */
-	struct { GLuint light, background, shield; } textures;
+	struct { GLuint light, background, shield, light_table, light_index; }
+		textures;
 	/* A separate frame-buffer is used to bake text. */
 	struct { GLuint text; } framebuffers;
 	/* The camera. */
 	struct { struct Vec2f x, extent; } camera;
+	/* Lights in each screen tile, \see{light_cull}; the layout of the
+	 {light_index} texture. */
+	struct {
+		GLfloat index[LIGHTS_PER_TILE][LIGHT_TILES * LIGHT_TILES];
+		float score[LIGHT_TILES * LIGHT_TILES][LIGHTS_PER_TILE];
+		unsigned size[LIGHT_TILES * LIGHT_TILES];
+	} tiles;
+	/* Draw calls in the frame being drawn and the last one. */
+	struct { unsigned current, last; } calls;
+	/* A Lambert programme for each of {lambert_lights}; the one in use is
+	 copied into {auto_Lambert_shader}. */
+	struct {
+		struct AutoLambertShader tiers[LAMBERT_TIERS];
+		unsigned tier;
+		/* Until the programmes are ended, \see{lambert_end}. */
+		char defines[LAMBERT_TIERS][32];
+		int is_begun[LAMBERT_TIERS];
+	} lambert;
+	/* Milliseconds from {glutInit} to the programmes being ready and to the
+	 first frame being drawn; zero until then. */
+	struct { int programmes, first_frame; } ms;
+	/* Everything from the {DrawDisplay*} functions is queued as a
+	 {DrawItem} and drawn by \see{queue_submit}. {instances} is a batch of
+	 Lambert sprites on it's way to the ring, \see{DrawRing.h}. */
+	struct {
+		int is_instanced;
+		enum DrawShader shader;
+		struct DrawItem *items;
+		struct Instance *instances;
+		size_t size, capacity;
+		struct QueueStats stats;
+	} queue;
 } draw;
 
+/* Current texture and normal; don't want to switch textures to the same
+ one. */
+static unsigned current_texture, current_normal;
+
+
+
+/** Puts light {l} in {tile} if it's one of the brightest there. */
+static void light_tile(const unsigned tile, const unsigned l,
+	const float score) {
+	unsigned *const size = draw.tiles.size + tile, i;
+	float *const scores = draw.tiles.score[tile];
+	assert(tile < LIGHT_TILES * LIGHT_TILES && l < MAX_LIGHTS);
+	if(*size >= LIGHTS_PER_TILE) {
+		if(score <= scores[LIGHTS_PER_TILE - 1]) return;
+		i = LIGHTS_PER_TILE - 1;
+	} else {
+		i = (*size)++;
+	}
+	for( ; i && scores[i - 1] < score; i--) {
+		scores[i] = scores[i - 1];
+		draw.tiles.index[i][tile] = draw.tiles.index[i - 1][tile];
+	}
+	scores[i] = score;
+	draw.tiles.index[i][tile] = (GLfloat)(l + 1);
+}
+
+/** Bins the {lights_size} {positions} with {colours} into screen tiles and
+ uploads them so that \see{Lambert.fs} only has to look at the ones that
+ reach each tile.
+ @return The most lights in any tile. */
+static unsigned light_cull(const unsigned lights_size,
+	const struct Vec2f *const positions, const struct Colour3f *const colours) {
+	const float tile_w = 2.0f * draw.camera.extent.x / LIGHT_TILES,
+		tile_h = 2.0f * draw.camera.extent.y / LIGHT_TILES,
+		x0 = draw.camera.x.x - draw.camera.extent.x,
+		y0 = draw.camera.x.y - draw.camera.extent.y;
+	const unsigned lights = lights_size > MAX_LIGHTS ? MAX_LIGHTS : lights_size;
+	unsigned l, i, most = 0;
+	int tx, ty, tx_min, tx_max, ty_min, ty_max;
+	float r, c, dx, dy, d2, f;
+	for(i = 0; i < LIGHT_TILES * LIGHT_TILES; i++) draw.tiles.size[i] = 0;
+	if(tile_w > 0.0f && tile_h > 0.0f) for(l = 0; l < lights; l++) {
+		const struct Vec2f *const p = positions + l;
+		const struct Colour3f *const colour = colours + l;
+		c = colour->r > colour->g ? colour->r : colour->g;
+		if(colour->b > c) c = colour->b;
+		if((r = c / light_threshold) <= 0.0f) continue;
+		f = floorf((p->x - r - x0) / tile_w), tx_min = (int)f;
+		f = floorf((p->x + r - x0) / tile_w), tx_max = (int)f;
+		f = floorf((p->y - r - y0) / tile_h), ty_min = (int)f;
+		f = floorf((p->y + r - y0) / tile_h), ty_max = (int)f;
+		if(tx_max < 0 || tx_min >= LIGHT_TILES
+			|| ty_max < 0 || ty_min >= LIGHT_TILES) continue;
+		if(tx_min < 0) tx_min = 0;
+		if(tx_max >= LIGHT_TILES) tx_max = LIGHT_TILES - 1;
+		if(ty_min < 0) ty_min = 0;
+		if(ty_max >= LIGHT_TILES) ty_max = LIGHT_TILES - 1;
+		for(ty = ty_min; ty <= ty_max; ty++) {
+			for(tx = tx_min; tx <= tx_max; tx++) {
+				/* Closest point on the tile to the light. */
+				dx = p->x - x0 - tx * tile_w;
+				if(dx > tile_w) dx -= tile_w; else if(dx > 0.0f) dx = 0.0f;
+				dy = p->y - y0 - ty * tile_h;
+				if(dy > tile_h) dy -= tile_h; else if(dy > 0.0f) dy = 0.0f;
+				if((d2 = dx * dx + dy * dy) > r * r) continue;
+				light_tile((unsigned)(ty * LIGHT_TILES + tx), l,
+					c / (1.0f + sqrtf(d2)));
+			}
+		}
+	}
+	/* Zero-terminate. */
+	for(i = 0; i < LIGHT_TILES * LIGHT_TILES; i++) {
+		if(draw.tiles.size[i] > most) most = draw.tiles.size[i];
+		if(draw.tiles.size[i] < LIGHTS_PER_TILE)
+			draw.tiles.index[draw.tiles.size[i]][i] = 0.0f;
+	}
+	glActiveTexture(TexClassTexture(TEX_CLASS_LIGHT_INDEX));
+	glBindTexture(GL_TEXTURE_2D, draw.textures.light_index);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, LIGHT_TILES * LIGHT_TILES,
+		LIGHTS_PER_TILE, GL_RED, GL_FLOAT, draw.tiles.index);
+	if(lights) {
+		glActiveTexture(TexClassTexture(TEX_CLASS_LIGHT_TABLE));
+		glBindTexture(GL_TEXTURE_2D, draw.textures.light_table);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (GLsizei)lights, 1, GL_RG,
+			GL_FLOAT, positions);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 1, (GLsizei)lights, 1, GL_RGB,
+			GL_FLOAT, colours);
+	}
+	glActiveTexture(TexClassTexture(TEX_CLASS_SPRITE));
+	return most;
+}
+
+#include "DrawView.h"
+#include "DrawRing.h"
+#include "DrawDeferred.h"
+
+/** Starts Lambert once for each of {lambert_lights}; \see{lambert_end}.
+ One that fails doesn't stop the others.
+ @return Success. */
+static int lambert_begin(void) {
+	unsigned t;
+	int is_begun = 1;
+	for(t = 0; t < LAMBERT_TIERS; t++) {
+		sprintf(draw.lambert.defines[t], "#define LIGHTS %u\n",
+			lambert_lights[t]);
+		if(!(draw.lambert.is_begun[t] = auto_Lambert_begin(VBO_ATTRIB_VERTEX,
+			VBO_ATTRIB_TEXTURE, VBO_ATTRIB_INSTANCE, VBO_ATTRIB_TEXTURE_RECT,
+			VBO_ATTRIB_NORMAL_RECT, view_binding(), draw.lambert.defines[t])))
+			is_begun = 0;
+		draw.lambert.tiers[t] = auto_Lambert_shader;
+	}
+	return is_begun;
+}
+
+/** Finishes everything started in \see{lambert_begin}.
+ @return Success. */
+static int lambert_end(void) {
+	unsigned t;
+	int is_ended = 1;
+	for(t = 0; t < LAMBERT_TIERS; t++) {
+		auto_Lambert_shader = draw.lambert.tiers[t];
+		if(draw.lambert.is_begun[t] && auto_Lambert_end()) {
+			glUniform1i(auto_Lambert_shader.bmp_sprite, TEX_CLASS_SPRITE);
+			glUniform1i(auto_Lambert_shader.bmp_normal, TEX_CLASS_NORMAL);
+			glUniform1i(auto_Lambert_shader.light_table,
+				TEX_CLASS_LIGHT_TABLE);
+			glUniform1i(auto_Lambert_shader.light_index,
+				TEX_CLASS_LIGHT_INDEX);
+			glUniform1i(auto_Lambert_shader.light_buffer,
+				TEX_CLASS_DEFERRED_LIGHT);
+			glUniform1i(auto_Lambert_shader.is_deferred, 0);
+		} else {
+			is_ended = 0;
+		}
+		draw.lambert.tiers[t] = auto_Lambert_shader;
+	}
+	draw.lambert.tier = LAMBERT_TIERS - 1;
+	return is_ended;
+}
+
+/** Erases all the Lambert programmes. */
+static void lambert_destroy(void) {
+	unsigned t;
+	for(t = 0; t < LAMBERT_TIERS; t++) {
+		auto_Lambert_shader = draw.lambert.tiers[t];
+		auto_Lambert_();
+		draw.lambert.tiers[t].compiled = 0;
+	}
+}
+
+/** Uses the Lambert with the fewest lights that has room for {lights} in a
+ tile, so the frames without lights don't pay for them. */
+static void lambert_use(const unsigned lights) {
+	unsigned t;
+	for(t = 0; t < LAMBERT_TIERS - 1 && lambert_lights[t] < lights; t++);
+	if(t == draw.lambert.tier && auto_Lambert_shader.compiled) return;
+	draw.lambert.tier = t;
+	auto_Lambert_shader = draw.lambert.tiers[t];
+}
+
+/** Makes sure there's room to queue {min} items in {draw.queue}.
+ @return Success. */
+static int queue_reserve(const size_t min) {
+	struct DrawItem *items;
+	struct Instance *instances;
+	size_t c = draw.queue.capacity ? draw.queue.capacity : 256;
+	while(c < min) c <<= 1;
+	if(c <= draw.queue.capacity) return 1;
+	if(!(items = realloc(draw.queue.items, c * sizeof *items)))
+		return perror("queue"), 0;
+	draw.queue.items = items;
+	if(!(instances = realloc(draw.queue.instances, c * sizeof *instances)))
+		return perror("queue"), 0;
+	draw.queue.instances = instances;
+	draw.queue.capacity  = c;
+	return 1;
+}
+
+/** @return The number of {image} in the queue key; no image is zero. */
+static unsigned queue_image(const struct AutoImage *const image) {
+	if(!image) return 0;
+	assert(image >= auto_images && image < auto_images + max_auto_images);
+	return (unsigned)(image - auto_images);
+}
+
+/** Queues an item with texture {tex} and normal {nor}, which can be null.
+ @return The item to fill in, or null if it couldn't be queued. */
+static struct DrawItem *queue_item(const enum DrawPass pass,
+	const enum DrawShader shader, const struct AutoImage *const tex,
+	const struct AutoImage *const nor) {
+	struct DrawItem *item;
+	assert(tex);
+	if(draw.queue.size >= draw.queue.capacity
+		&& !queue_reserve(draw.queue.size + 1)) return 0;
+	if(!QueuePush(pass, shader, queue_image(tex), queue_image(nor),
+		(unsigned)draw.queue.size)) return 0;
+	item = draw.queue.items + draw.queue.size++;
+	item->texture = tex;
+	item->normal  = nor;
+	return item;
+}
+
+/** Starts using instance arrays from the ring for Lambert and Normals. */
+static void queue_lambert_begin(void) {
+	if(!draw.queue.is_instanced) return;
+	glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+	glEnableVertexAttribArray(VBO_ATTRIB_INSTANCE);
+	glEnableVertexAttribArray(VBO_ATTRIB_TEXTURE_RECT);
+	glEnableVertexAttribArray(VBO_ATTRIB_NORMAL_RECT);
+}
+
+/** Stops using instance arrays after the Lambert shader. */
+static void queue_lambert_end(void) {
+	if(!draw.queue.is_instanced) return;
+	glDisableVertexAttribArray(VBO_ATTRIB_INSTANCE);
+	glDisableVertexAttribArray(VBO_ATTRIB_TEXTURE_RECT);
+	glDisableVertexAttribArray(VBO_ATTRIB_NORMAL_RECT);
+	glBindBuffer(GL_ARRAY_BUFFER, draw.arrays.vertices);
+}
+
+/** Changes to {shader}; the view must be uploaded, \see{view_upload}.
+ @implements QueueShader */
+static void queue_shader(const unsigned shader) {
+	switch(draw.queue.shader) {
+	case SHADER_NORMALS: queue_lambert_end(); deferred_end(); break;
+	case SHADER_LIGHT: deferred_end(); break;
+	case SHADER_LAMBERT: queue_lambert_end(); break;
+	default: break;
+	}
+	draw.queue.shader = (enum DrawShader)shader;
+	current_texture = current_normal = 0;
+	switch(draw.queue.shader) {
+	case SHADER_NORMALS:
+		deferred_normals_begin();
+		queue_lambert_begin();
+		break;
+	case SHADER_LIGHT:
+		deferred_light_begin();
+		break;
+	case SHADER_FAR:
+		glUseProgram(auto_Far_shader.compiled);
+		break;
+	case SHADER_LAMBERT:
+		glUseProgram(auto_Lambert_shader.compiled);
+		glUniform1i(auto_Lambert_shader.is_deferred, deferred.is_frame);
+		queue_lambert_begin();
+		break;
+	case SHADER_INFO:
+		glUseProgram(auto_Info_shader.compiled);
+		glUniform2f(auto_Info_shader.camera, draw.camera.x.x, draw.camera.x.y);
+		break;
+	case SHADER_NONE: break;
+	}
+}
+
+/** Binds the textures of {item} if they are not already. */
+static void queue_texture(const struct DrawItem *const item) {
+	const int is_normal = item->normal
+		&& current_normal != item->normal->texture;
+	if(!is_normal && current_texture == item->texture->texture) return;
+	if(is_normal) {
+		glActiveTexture(TexClassTexture(TEX_CLASS_NORMAL));
+		glBindTexture(GL_TEXTURE_2D, item->normal->texture);
+		current_normal = item->normal->texture;
+	}
+	glActiveTexture(TexClassTexture(TEX_CLASS_SPRITE));
+	glBindTexture(GL_TEXTURE_2D, item->texture->texture);
+	current_texture = item->texture->texture;
+}
+
+/** Draws Lambert sprites that share a texture. With instancing, they are
+ written to the ring and drawn in one call; if not,
+ the instance attributes are set as constants for each sprite. */
+static void queue_lambert(const struct QueueCommand *const commands,
+	const size_t size) {
+	size_t i;
+	if(draw.queue.is_instanced) {
+		size_t first;
+		for(i = 0; i < size; i++) draw.queue.instances[i]
+			= draw.queue.items[commands[i].data].instance;
+		first = ring_write(draw.queue.instances,
+			size * sizeof *draw.queue.instances);
+		glVertexAttribPointer(VBO_ATTRIB_INSTANCE, 4, GL_FLOAT, GL_FALSE,
+			sizeof(struct Instance), (GLvoid *)first);
+		glVertexAttribPointer(VBO_ATTRIB_TEXTURE_RECT, 4, GL_FLOAT,
+			GL_FALSE, sizeof(struct Instance),
+			(GLvoid *)(first + offsetof(struct Instance, texture)));
+		glVertexAttribPointer(VBO_ATTRIB_NORMAL_RECT, 4, GL_FLOAT,
+			GL_FALSE, sizeof(struct Instance),
+			(GLvoid *)(first + offsetof(struct Instance, normal)));
+		glDrawArraysInstancedARB(GL_TRIANGLE_STRIP,
+			vertex_index_square.first, vertex_index_square.count,
+			(GLsizei)size);
+		draw.calls.current++;
+	} else {
+		for(i = 0; i < size; i++) {
+			const struct Instance *const in
+				= &draw.queue.items[commands[i].data].instance;
+			glVertexAttrib4fv(VBO_ATTRIB_INSTANCE, &in->x);
+			glVertexAttrib4fv(VBO_ATTRIB_TEXTURE_RECT, in->texture);
+			glVertexAttrib4fv(VBO_ATTRIB_NORMAL_RECT, in->normal);
+			glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_square.first,
+				vertex_index_square.count);
+			draw.calls.current++;
+		}
+	}
+}
+
+/** Draws a run of commands with the same shader and texture.
+ @implements QueueBatch */
+static void queue_batch(const struct QueueCommand *const commands,
+	const size_t size) {
+	const struct DrawItem *item = draw.queue.items + commands[0].data;
+	size_t i;
+	if(draw.queue.shader == SHADER_LIGHT) { deferred_lights_draw(); return; }
+	queue_texture(item);
+	switch(draw.queue.shader) {
+	case SHADER_NORMALS:
+	case SHADER_LAMBERT:
+		queue_lambert(commands, size);
+		break;
+	case SHADER_FAR:
+		glUniform1f(auto_Far_shader.size, item->instance.size);
+		for(i = 0; i < size; i++) {
+			item = draw.queue.items + commands[i].data;
+			glUniform1f(auto_Far_shader.angle, item->instance.angle);
+			glUniform2f(auto_Far_shader.object, item->instance.x,
+				item->instance.y);
+			glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_square.first,
+				vertex_index_square.count);
+			draw.calls.current++;
+		}
+		break;
+	case SHADER_INFO:
+		glUniform1f(auto_Info_shader.size, item->instance.size);
+		for(i = 0; i < size; i++) {
+			item = draw.queue.items + commands[i].data;
+			glUniform2f(auto_Info_shader.object, item->instance.x,
+				item->instance.y);
+			glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_square.first,
+				vertex_index_square.count);
+			draw.calls.current++;
+		}
+		break;
+	case SHADER_LIGHT:
+	case SHADER_NONE: assert(0); break;
+	}
+}
+
+/** Draws everything that was queued this frame, sorted by pass, shader, and
+ texture, and empties the queue. */
+static void queue_submit(void) {
+	/* Every instance, plus alignment for every batch, and the lights. */
+	if(draw.queue.is_instanced && !ring_begin(QueueGetSize()
+		* (sizeof *draw.queue.instances + 16)
+		+ sizeof deferred.lights + 16)) {
+		fprintf(stderr, "Draw: ring failed; drawing sprites one by one.\n");
+		draw.queue.is_instanced = 0;
+	}
+	draw.queue.shader = SHADER_NONE;
+	QueueSubmit(&queue_shader, &queue_batch, &draw.queue.stats);
+	queue_shader(SHADER_NONE);
+	if(draw.queue.is_instanced) ring_end();
+	/* {resize} expects the static geometry. */
+	glBindBuffer(GL_ARRAY_BUFFER, draw.arrays.vertices);
+	draw.queue.shader = SHADER_NONE;
+	draw.queue.size = 0;
+	current_texture = current_normal = 0;
+}
+
 
 /** Callback for {glutDisplayFunc}; this is where all of the drawing happens.
  It sets up the shaders, then calls whatever draw functions use those
@@ -123,6 +574,7 @@ static void display(void) {
 
 	/* Use sprites; triangle strips, two to form a square, vertex buffer,
 	 [-0.5, 0.5 : -0.5, 0.5] */
+	TraceBegin("display");
 	glBindBuffer(GL_ARRAY_BUFFER, draw.arrays.vertices);
 
 	/* @fixme Don't use painters' algorithm; stencil test! */
@@ -133,6 +585,7 @@ static void display(void) {
 	 update glUniform1i(GLint location, GLint v0)
 	 update glUniformMatrix4fv(location, count, transpose, *value)
 	 glDrawArrays(type flag, offset, no) */
+	TraceBegin("background");
 	if(draw.textures.background) {
 		/* use background shader */
 		glUseProgram(auto_Background_shader.compiled);
@@ -144,37 +597,55 @@ static void display(void) {
 		/*glUniform1i(background_sampler_location, TEX_CLASS_BACKGROUND);*/
 		/*glUniformMatrix4fv(tex_map_matrix_location, 1, GL_FALSE, background_matrix);*/
 		glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_background.first, vertex_index_background.count);
+		draw.calls.current++;
 	}
+	TraceEnd();
 
 	glEnable(GL_BLEND);
 
-	/* Draw far objects. */
-	glUseProgram(auto_Far_shader.compiled);
-	glUniform2f(auto_Far_shader.camera, draw.camera.x.x, draw.camera.x.y);
+	/* Queue far objects. */
+	TraceBegin("FarsDraw");
 	FarsDraw();
+	TraceEnd();
 
-	/* Set up lights, draw sprites in foreground. */
+	/* Set up lights, queue sprites in foreground. */
 	glUseProgram(auto_Lambert_shader.compiled);
-	glUniform2f(auto_Lambert_shader.camera, draw.camera.x.x, draw.camera.x.y);
-	glUniform1i(auto_Lambert_shader.points, lights = (unsigned)SpritesLightGetSize());
-	if(lights) {
+	TraceBegin("lights");
+	deferred.is_frame = deferred_is_on();
+	{
 		struct Vec2f *parray = SpritesLightPositions();
 		unsigned i;
-		glUniform2fv(auto_Lambert_shader.point_position, lights,
-					 (GLfloat *)parray);
-		glUniform3fv(auto_Lambert_shader.point_colour, lights,
-					 (GLfloat *)SpritesLightGetColours());
+		lights = (unsigned)SpritesLightGetSize();
+		if(deferred.is_frame) {
+			deferred_lights(lights, parray, SpritesLightGetColours());
+			lambert_use(0);
+		} else {
+			lambert_use(light_cull(lights, parray, SpritesLightGetColours()));
+		}
 		/* Debug. */
 		for(i = 0; i < lights; i++) Info(parray + i, draw.icon_light);
 	}
+	TraceEnd();
+	TraceBegin("SpritesDraw");
 	SpritesDraw();
+	/* The lights go between the normals and the sprites. */
+	if(deferred.is_frame) QueuePush(PASS_LIGHTS, SHADER_LIGHT, 0, 0, 0);
+	TraceEnd();
 
-	/* Display info on top without lighting. */
-	glUseProgram(auto_Info_shader.compiled);
-	glUniform2f(auto_Info_shader.camera, draw.camera.x.x, draw.camera.x.y);
+	/* Queue info on top without lighting. */
+	TraceBegin("SpritesInfo");
 	SpritesInfo();
+	TraceEnd();
+
+	/* Draw all that, in order of pass, shader, and texture. */
+	TraceBegin("queue");
+	view_camera(&draw.camera.x);
+	view_upload();
+	queue_submit();
+	TraceEnd();
 
 	/* Overlay hud. @fixme */
+	TraceBegin("hud");
 	if(draw.textures.shield) {
 		struct Ship *player;
 		const struct Ortho3f *x;
@@ -189,8 +660,10 @@ static void display(void) {
 			glUniform2f(auto_Hud_shader.position, x->x, x->y + 64.0f);
 			glUniform2i(auto_Hud_shader.shield, hit->x, hit->y);
 			glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_square.first, vertex_index_square.count);
+			draw.calls.current++;
 		}
 	}
+	TraceEnd();
 
 	/* We want to do this:
 	 glActiveTexture(TexClassTexture(TEX_CLASS_SPRITE));
@@ -206,8 +679,19 @@ static void display(void) {
 	 calls the fuction more times? does it build up in a queue? */
 	/*glFinish(); <- does nothing */
 	/* <-- glut glFlush implied. */
+	TraceBegin("glutSwapBuffers");
 	glutSwapBuffers();
+	TraceEnd();
 	/* glut --> */
+	draw.calls.last = draw.calls.current, draw.calls.current = 0;
+	if(!draw.ms.first_frame) {
+		/* <-- glut */
+		draw.ms.first_frame = glutGet(GLUT_ELAPSED_TIME);
+		/* glut --> */
+		fprintf(stderr, "Draw: first frame at %dms; programmes were ready at "
+			"%dms.\n", draw.ms.first_frame, draw.ms.programmes);
+	}
+	TraceEnd();
 }
 
 /** Callback for glutReshapeFunc.
@@ -260,10 +744,9 @@ static void resize(int width, int height) {
 	}
 	two_screen.x = 2.0f / width;
 	two_screen.y = 2.0f / height;
-	glUseProgram(auto_Lambert_shader.compiled);
-	glUniform2f(auto_Lambert_shader.projection, two_screen.x, two_screen.y);
-	glUseProgram(auto_Far_shader.compiled);
-	glUniform2f(auto_Far_shader.projection, two_screen.x, two_screen.y);
+	/* Far, Lambert, Normals, and Light share the view. */
+	view_screen(width, height);
+	deferred_resize(width, height);
 	glUseProgram(auto_Info_shader.compiled);
 	glUniform2f(auto_Info_shader.projection, two_screen.x, two_screen.y);
 	glUseProgram(auto_Hud_shader.compiled);
@@ -273,52 +756,15 @@ static void resize(int width, int height) {
 /** Creates a texture from an image; sets the image texture unit.
  @fixme This should go in Auto?
  @param image: The Image as seen in Lores.h.
+ @param pixels: Decoded, bottom row first, as \see{textures} leaves them; or
+ an offset into the bound {GL_PIXEL_UNPACK_BUFFER}.
  @return Success. */
-static int texture(struct AutoImage *image) {
-	unsigned width, height, depth, error;
-	unsigned char *pic;
-	int is_alloc = 0, is_bad = 0;
+static int texture(struct AutoImage *image, const void *const pixels) {
 	unsigned format = 0, internal = 0;
 	unsigned tex = 0;
 	if(!image || image->texture) return 0;
-	/* Uncompress the image. */
-	switch(image->data_format) {
-		case IF_PNG:
-			/* @fixme This will force it to be 32-bit RGBA even if it doesn't
-			 have an alpha channel, potentially wasteful. */
-			if((error = lodepng_decode32(&pic, &width, &height, image->data,
-										 image->data_size))) {
-				fprintf(stderr, "texture: lodepng error %u: %s\n", error,
-						lodepng_error_text(error));
-				break;
-			}
-			is_alloc = -1;
-			depth    = 4;
-			break;
-		case IF_JPEG:
-			if(njDecode(image->data, (int)image->data_size)) break;
-			is_alloc = -1;
-			pic = njGetImage();
-			if(!njIsColor()) is_bad = -1;
-			width  = njGetWidth();
-			height = njGetHeight();
-			depth  = 3;
-			break;
-		case IF_UNKNOWN:
-		default:
-			fprintf(stderr, "texture: unknown image format.\n");
-	}
-	if(!is_alloc) {
-		fprintf(stderr, "texture: allocation failed.\n");
-		return 0;
-	}
-	if(width != image->width || height != image->height || depth!=image->depth){
-		fprintf(stderr, "texture: dimension mismatch %u:%ux%u vs %u:%ux%u.\n",
-				image->width, image->height, image->depth, width, height, depth);
-		is_bad = -1;
-	}
 	/* select image format */
-	switch(depth) {
+	switch(image->depth) {
 		case 1:
 			/* We use exclusively for shaders, so I don't think this matters. */
 			/* GL_LUMINANCE; <- "core context depriciated," I was using that. */
@@ -335,57 +781,141 @@ static int texture(struct AutoImage *image) {
 			format   = GL_RGBA;
 			break;
 		default:
-			fprintf(stderr, "texture: not a recognised depth, %d.\n", depth);
-			is_bad = -1;
-	}
-	/* Invert to go with OpenGL's strict adherence to standards vs traditions.*/
-	{
-		unsigned bytes_line = width * depth;
-		unsigned top, bottom, i;
-		unsigned char *pb_t, *pb_b;
-		for(top = 0, bottom = height - 1; top < bottom; top++, bottom--) {
-			pb_t = pic + top    * bytes_line;
-			pb_b = pic + bottom * bytes_line;
-			for(i = 0; i < bytes_line; i++, pb_t++, pb_b++)
-				*pb_t ^= *pb_b, *pb_b ^= *pb_t, *pb_t ^= *pb_b;
-		}
+			fprintf(stderr, "texture: not a recognised depth, %d.\n",
+				image->depth);
+			return 0;
 	}
 	/* Load the uncompressed image into a texture. */
-	if(!is_bad) {
-		glGenTextures(1, (unsigned *)&tex);
-		glActiveTexture((unsigned)(image->depth == 3 ? TexClassTexture(TEX_CLASS_BACKGROUND) : TexClassTexture(TEX_CLASS_SPRITE)));
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		/* linear because fractional positioning; may be changed with
-		 backgrounds in resize */
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		/* no mipmap */
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
-		/* void glTexImage2D(target, level, internalFormat, width, height,
-		 border, format, type, *data); */
-		glTexImage2D(GL_TEXTURE_2D, 0, internal, (int)width, (int)height, 0,
-					 format, GL_UNSIGNED_BYTE, pic);
-		image->texture = tex;
-		/* debug */
-#ifdef PRINT_PEDANTIC
-		printf("texture: %u:\n", image->texture);
-		if(image->width <= 80) image_print(image, pic);
-		else printf(" . . . too big to show.\n");
-#endif
-	}
-	/* Free the pic. */
+	glGenTextures(1, (unsigned *)&tex);
+	glActiveTexture((unsigned)(image->depth == 3 ? TexClassTexture(TEX_CLASS_BACKGROUND) : TexClassTexture(TEX_CLASS_SPRITE)));
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	/* linear because fractional positioning; may be changed with
+	 backgrounds in resize */
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	/* no mipmap */
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	/* The rows are packed; three channels wouldn't be aligned. */
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	/* void glTexImage2D(target, level, internalFormat, width, height,
+	 border, format, type, *data); */
+	glTexImage2D(GL_TEXTURE_2D, 0, internal, (int)image->width,
+		(int)image->height, 0, format, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	image->texture = tex;
+	fprintf(stderr, "texture: created %ux%ux%u texture, Tex%u.\n",
+		image->width, image->height, image->depth, tex);
+	WindowIsGlError("texture");
+	return 1;
+}
+
+/* An image on it's way to a texture, \see{textures}. */
+struct Upload {
+	struct AutoImage *image;
+	size_t size;
+	/* Where it's decompressed to; in {buffer} if it's non-zero. */
+	unsigned char *pixels;
+	GLuint buffer;
+};
+static struct Upload *uploads;
+
+/** Biggest first, so the longest is started first.
+ @implements qsort */
+static int upload_compare(const void *const a, const void *const b) {
+	const size_t x = ((const struct Upload *)a)->size,
+		y = ((const struct Upload *)b)->size;
+	return (x < y) - (x > y);
+}
+
+/** Decompresses {uploads[index]}; it's on a worker thread, so no OpenGL.
+ @implements WorkersWork */
+static int upload_work(const size_t index) {
+	struct Upload *const u = uploads + index;
+	const struct AutoImage *const image = u->image;
 	switch(image->data_format) {
-		case IF_PNG: free(pic); break;
-		case IF_JPEG: njDone(); break;
-		default: break;
+		case IF_RAW:
+			if(image->data_size == u->size) return 1;
+			fprintf(stderr, "texture: %s is %luB, but %ux%ux%u.\n",
+				image->name, (unsigned long)image->data_size, image->width,
+				image->height, image->depth);
+			return 0;
+		case IF_LZ4:
+			if(u->pixels
+				&& Lz4Decompress(image->data, image->data_size, u->pixels,
+				u->size)) return 1;
+			fprintf(stderr, "texture: %s doesn't decompress to %ux%ux%u.\n",
+				image->name, image->width, image->height, image->depth);
+			return 0;
+		case IF_UNKNOWN:
+		default:
+			fprintf(stderr, "texture: %s is an unknown image format.\n",
+				image->name);
+			return 0;
 	}
-	fprintf(stderr, "texture: created %dx%dx%d texture, Tex%u.\n",
-			width, height, depth, tex);
-	WindowIsGlError("texture");
-	return tex ? 1 : 0;
+}
+
+/** Creates textures from all {auto_images}. The Loader has already decoded
+ them and put the bottom row first; the compressed ones are decompressed by
+ \see{Workers}, one thread a core, and each is uploaded on this thread as
+ soon as it's done. Where {ARB_pixel_buffer_object} is supported, they're
+ decompressed straight into mapped pixel-unpack buffers. */
+static void textures(void) {
+	const int is_buffer = GlewIsExtension("GL_ARB_pixel_buffer_object");
+	const int ms = glutGet(GLUT_ELAPSED_TIME);
+	const size_t size = (size_t)max_auto_images;
+	struct Upload *u;
+	size_t i;
+	unsigned threads;
+	int is_done;
+	if(!size) return;
+	if(!(uploads = malloc(sizeof *uploads * size))) { perror("textures"); return; }
+	for(i = 0; i < size; i++) {
+		u = uploads + i;
+		u->image = auto_images + i;
+		u->size = (size_t)u->image->width * u->image->height
+			* u->image->depth;
+		u->pixels = 0, u->buffer = 0;
+	}
+	qsort(uploads, size, sizeof *uploads, &upload_compare);
+	/* Workers can't call OpenGL, so everything is mapped first. */
+	for(i = 0; i < size; i++) {
+		u = uploads + i;
+		if(u->image->data_format != IF_LZ4) continue;
+		if(is_buffer) {
+			glGenBuffers(1, &u->buffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, u->buffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)u->size, 0,
+				GL_STREAM_DRAW);
+			if((u->pixels = glMapBuffer(GL_PIXEL_UNPACK_BUFFER,
+				GL_WRITE_ONLY))) continue;
+			glDeleteBuffers(1, &u->buffer), u->buffer = 0;
+		}
+		if(!(u->pixels = malloc(u->size))) perror(u->image->name);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	threads = WorkersBegin(size, &upload_work);
+	while(WorkersNext(&i, &is_done)) {
+		u = uploads + i;
+		if(u->buffer) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, u->buffer);
+			if(!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) is_done = 0;
+			if(is_done) texture(u->image, 0);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glDeleteBuffers(1, &u->buffer);
+		} else if(is_done) {
+			texture(u->image, u->pixels ? u->pixels : u->image->data);
+		}
+		if(!u->buffer) free(u->pixels);
+		u->pixels = 0, u->buffer = 0;
+	}
+	WorkersEnd();
+	free(uploads), uploads = 0;
+	fprintf(stderr, "textures: %lu images in %dms; %u worker thread%s, "
+		"%s.\n", (unsigned long)size, glutGet(GLUT_ELAPSED_TIME) - ms, threads,
+		threads == 1 ? "" : "s", is_buffer ? "pixel-unpack buffers" : "memory");
 }
 
 /** New texture with {str}.
@@ -466,15 +996,46 @@ static int light_compute_texture(void) {
 	return name;
 }
 
+/** Creates an empty floating-point texture on {tex_class} for data.
+ @return The texture or zero. */
+static GLuint data_texture(const enum TexClass tex_class, const GLint internal,
+	const GLsizei width, const GLsizei height, const GLenum format) {
+	GLuint name;
+	glGenTextures(1, &name);
+	glActiveTexture(TexClassTexture(tex_class));
+	glBindTexture(GL_TEXTURE_2D, name);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	/* It's data; no interpolating. */
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, internal, width, height, 0, format,
+		GL_FLOAT, 0);
+	fprintf(stderr, "data_texture: created %dx%d data texture, Tex%u.\n",
+		width, height, name);
+	WindowIsGlError("data_texture");
+	return name;
+}
+
+/** @return Whether instanced arrays can be drawn. */
+static int is_instancing(void) {
+	return GlewIsExtension("GL_ARB_instanced_arrays")
+		&& GlewIsExtension("GL_ARB_draw_instanced");
+}
+
 /** Gets all the graphics stuff started. Must have a window.
  @return All good to draw? */
 int Draw(void) {
-	const float sunshine[] = { 1.0f * 3.0f, 1.0f * 3.0f, 1.0f * 3.0f };
-	int i;
+	const float sunshine[] = { 1.0f * 3.0f, 1.0f * 3.0f, 1.0f * 3.0f },
+		sun_direction[] = { -0.2f, -0.2f, 0.1f };
+	/* Which programmes were begun; only those are ended. */
+	int is_background, is_far, is_hud, is_info, is_lambert, is_normals,
+		is_light, is_ended = 1, is_deferred = 1;
 
 	if(draw.is_started) return 1;
 
 	draw.icon_light = AutoImageSearch("Idea16.png");
+	draw.atlas = AutoImageSearch("Atlas.png");
 	assert(draw.icon_light);
 
 	if(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS < TEX_CLASS_NO)
@@ -516,6 +1077,24 @@ int Draw(void) {
 		vertex_attribute[VBO_ATTRIB_TEXTURE].offset);
 	fprintf(stderr, "Draw: created vertex buffer, Vbo%u.\n",
 		draw.arrays.vertices);
+	/* Everything is queued and drawn by texture, \see{queue_submit}. */
+	if((unsigned)max_auto_images > 1u << QUEUE_TEXTURE_BITS) {
+		fprintf(stderr, "Draw: %d images don't fit in the queue.\n",
+			max_auto_images);
+		return Draw_(), 0;
+	}
+	draw.queue.shader = SHADER_NONE;
+	draw.queue.is_instanced = is_instancing();
+	if(draw.queue.is_instanced && !ring_create(0))
+		ring_destroy(), draw.queue.is_instanced = 0;
+	if(draw.queue.is_instanced) {
+		glVertexAttribDivisorARB(VBO_ATTRIB_INSTANCE, 1);
+		glVertexAttribDivisorARB(VBO_ATTRIB_TEXTURE_RECT, 1);
+		glVertexAttribDivisorARB(VBO_ATTRIB_NORMAL_RECT, 1);
+	} else {
+		fprintf(stderr, "Draw: no instancing; drawing sprites one by one.\n");
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, draw.arrays.vertices);
 
 	/* textures */
 	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_FASTEST);
@@ -523,31 +1102,72 @@ int Draw(void) {
 	glActiveTexture(TexClassTexture(TEX_CLASS_NORMAL));
 	if(!(draw.textures.light = light_compute_texture()))
 		fprintf(stderr, "Draw: failed computing light texture.\n");
+	/* the lights in screen tiles, \see{light_cull} */
+	draw.textures.light_table = data_texture(TEX_CLASS_LIGHT_TABLE, GL_RGB32F,
+		MAX_LIGHTS, 2, GL_RGB);
+	draw.textures.light_index = data_texture(TEX_CLASS_LIGHT_INDEX, GL_R32F,
+		LIGHT_TILES * LIGHT_TILES, LIGHTS_PER_TILE, GL_RED);
 	/* textures stored in imgs */
-	for(i = 0; i < max_auto_images; i++) texture(&auto_images[i]);
+	textures();
 
 	/* Text rendering. */
 	glGenFramebuffers(1, &draw.framebuffers.text);
 
-	/* Shader initialisation. */
-	if(!auto_Background(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE)) return Draw_(), 0;
-	/* These are constant. @fixme Could they be declared as such? */
-	glUniform1i(auto_Background_shader.sampler, TEX_CLASS_BACKGROUND);
-	if(!auto_Far(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE)) return Draw_(), 0;
-	glUniform1i(auto_Far_shader.bmp_sprite, TEX_CLASS_SPRITE);
-	glUniform1i(auto_Far_shader.bmp_normal, TEX_CLASS_NORMAL);
-	glUniform3f(auto_Far_shader.sun_direction, -0.2f, -0.2f, 0.1f);
-	glUniform3fv(auto_Far_shader.sun_colour, 1, sunshine);
-	glUniform1i(auto_Far_shader.foreshortening, 0.25f);
-	if(!auto_Hud(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE)) return Draw_(), 0;
-	glUniform1i(auto_Hud_shader.sampler, TEX_CLASS_SPRITE);
-	if(!auto_Info(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE)) return Draw_(), 0;
-	glUniform1i(auto_Info_shader.bmp_sprite, TEX_CLASS_SPRITE);
-	if(!auto_Lambert(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE)) return Draw_(), 0;
-	glUniform1i(auto_Lambert_shader.bmp_sprite, TEX_CLASS_SPRITE);
-	glUniform1i(auto_Lambert_shader.bmp_normal, TEX_CLASS_NORMAL);
-	glUniform3f(auto_Lambert_shader.sun_direction, -0.2f, -0.2f, 0.1f);
-	glUniform3fv(auto_Lambert_shader.sun_colour, 1, sunshine);
+	/* Shader initialisation; the view is shared by some, \see{DrawView.h}.
+	 They are all started before any are ended, so the driver can compile
+	 them at the same time, or they come from the cache, \see{Programs.c}. One
+	 that fails to begin doesn't stop the rest. */
+	view_create();
+	ProgramsParallel();
+	is_background = auto_Background_begin(VBO_ATTRIB_VERTEX,
+		VBO_ATTRIB_TEXTURE, 0);
+	is_far = auto_Far_begin(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE,
+		view_binding(), 0);
+	is_hud = auto_Hud_begin(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE, 0);
+	is_info = auto_Info_begin(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE, 0);
+	is_lambert = lambert_begin();
+	is_normals = auto_Normals_begin(VBO_ATTRIB_VERTEX, VBO_ATTRIB_TEXTURE,
+		VBO_ATTRIB_INSTANCE, VBO_ATTRIB_TEXTURE_RECT, VBO_ATTRIB_NORMAL_RECT,
+		view_binding(), 0);
+	is_light = auto_Light_begin(VBO_ATTRIB_VERTEX, VBO_ATTRIB_INSTANCE,
+		VBO_ATTRIB_TEXTURE_RECT, view_binding(), 0);
+	/* Everything that was begun is ended; the ones that weren't failed.
+	 These are constant. @fixme Could they be declared as such? */
+	if(is_background && auto_Background_end()) {
+		glUniform1i(auto_Background_shader.sampler, TEX_CLASS_BACKGROUND);
+	} else is_ended = 0;
+	if(is_far && auto_Far_end()) {
+		glUniform1i(auto_Far_shader.bmp_sprite, TEX_CLASS_SPRITE);
+		glUniform1i(auto_Far_shader.bmp_normal, TEX_CLASS_NORMAL);
+		glUniform1i(auto_Far_shader.foreshortening, 0.25f);
+	} else is_ended = 0;
+	if(is_hud && auto_Hud_end()) {
+		glUniform1i(auto_Hud_shader.sampler, TEX_CLASS_SPRITE);
+	} else is_ended = 0;
+	if(is_info && auto_Info_end()) {
+		glUniform1i(auto_Info_shader.bmp_sprite, TEX_CLASS_SPRITE);
+	} else is_ended = 0;
+	/* Ends the tiers that began, even if one didn't. */
+	if(!lambert_end() || !is_lambert) is_ended = 0;
+	/* Deferred lighting, if it can; if not, it's forward, and still draws. */
+	if(is_normals && auto_Normals_end()) {
+		glUniform1i(auto_Normals_shader.bmp_sprite, TEX_CLASS_SPRITE);
+		glUniform1i(auto_Normals_shader.bmp_normal, TEX_CLASS_NORMAL);
+	} else is_deferred = 0;
+	if(is_light && auto_Light_end()) {
+		glUniform1i(auto_Light_shader.normals, TEX_CLASS_DEFERRED_NORMALS);
+	} else is_deferred = 0;
+	if(!is_ended) return Draw_(), 0;
+	/* <-- glut */
+	draw.ms.programmes = glutGet(GLUT_ELAPSED_TIME);
+	/* glut --> */
+	fprintf(stderr, "Draw: programmes ready at %dms; %u from the cache.\n",
+		draw.ms.programmes, ProgramsGetHits());
+	if(is_deferred) deferred_create();
+	else fprintf(stderr, "Draw: deferred programmes failed; lighting is "
+		"forward.\n");
+	view_check();
+	view_sun(sun_direction, sunshine);
 
 	WindowIsGlError("Draw");
 
@@ -560,12 +1180,16 @@ void Draw_(void) {
 	unsigned tex;
 	int i;
 	/* Erase the shaders. */
-	auto_Lambert_();
+	deferred_destroy();
+	auto_Light_();
+	auto_Normals_();
+	lambert_destroy();
 	auto_Info_();
 	/*auto_Lighting_();*/
 	auto_Hud_();
 	auto_Far_();
 	auto_Background_();
+	view_destroy();
 	/* Erase the text frame-buffer if it exists. */
 	glDeleteFramebuffers(1, &draw.framebuffers.text);
 	/* Erase the textures. @fixme glDeleteTexture is safe to use. */
@@ -576,13 +1200,30 @@ void Draw_(void) {
 		auto_images[i].texture = 0;
 	}
 	draw.textures.background = draw.textures.shield = 0;
-	/* Erase generated texture. */
+	/* Erase generated textures. */
+	if(draw.textures.light_table) {
+		fprintf(stderr, "~Draw: erase light table texture, Tex%u.\n",
+			draw.textures.light_table);
+		glDeleteTextures(1, &draw.textures.light_table);
+		draw.textures.light_table = 0;
+	}
+	if(draw.textures.light_index) {
+		fprintf(stderr, "~Draw: erase light index texture, Tex%u.\n",
+			draw.textures.light_index);
+		glDeleteTextures(1, &draw.textures.light_index);
+		draw.textures.light_index = 0;
+	}
 	if(draw.textures.light) {
 		fprintf(stderr, "~Draw: erase lighting texture, Tex%u.\n",
 				draw.textures.light);
 		glDeleteTextures(1, &draw.textures.light);
 		draw.textures.light = 0;
 	}
+	ring_destroy();
+	Queue_();
+	free(draw.queue.items), draw.queue.items = 0;
+	free(draw.queue.instances), draw.queue.instances = 0;
+	draw.queue.size = draw.queue.capacity = 0;
 	if(draw.arrays.vertices && glIsBuffer(draw.arrays.vertices)) {
 		fprintf(stderr, "~Draw: erase Vbo%u.\n", draw.arrays.vertices);
 		glDeleteBuffers(1, &draw.arrays.vertices);
@@ -609,6 +1250,21 @@ void DrawGetScreen(struct Rectangle4f *const rect) {
 	rect->y_max = draw.camera.x.y + draw.camera.extent.y;
 }
 
+/** Switches between deferred and forward point lights, if deferred is
+ supported.
+ @implements Runnable */
+void DrawToggleDeferred(void) {
+	deferred.is_enabled = !deferred.is_enabled;
+	fprintf(stderr, "Draw: %s lighting%s.\n", deferred.is_enabled
+		? "deferred" : "forward", deferred.is_supported ? "" : " (deferred is "
+		"not supported)");
+}
+
+/** @return The number of draw calls in the last frame. */
+unsigned DrawGetCalls(void) {
+	return draw.calls.last;
+}
+
 
 
 /* Texture functions. */
@@ -679,60 +1335,55 @@ static int text_compute_texture(void) {
 /* This is the shader texture display. Each one goes with a certian shader, so
  the OpenGL state must be set to that shader before calling. */
 
-/* Current texture; don't want to switch textures to the same one. */
-static unsigned current_texture;
-
-/** Only used as a callback from \see{display} while OpenGL is using Lambert.
- For \see{SpritesDraw}.
+/** Only used as a callback from \see{display}, for \see{SpritesDraw}; the
+ sprite is queued, and drawn with Lambert in \see{queue_submit}.
  @implements DrawOutput */
 void DrawDisplayLambert(const struct Ortho3f *const x,
 	const struct AutoImage *const tex, const struct AutoImage *const nor) {
+	/* Both in the atlas, they can be drawn with everything else in it. */
+	const int is_atlas = draw.atlas && tex->atlas[2] > 0.0f
+		&& nor->atlas[2] > 0.0f;
+	struct DrawItem *item;
 	assert(x && tex && nor);
-	if(current_texture != tex->texture) {
-		glActiveTexture(TexClassTexture(TEX_CLASS_NORMAL));
-		glBindTexture(GL_TEXTURE_2D, nor->texture);
-		glActiveTexture(TexClassTexture(TEX_CLASS_SPRITE));
-		glBindTexture(GL_TEXTURE_2D, tex->texture);
-		current_texture = tex->texture;
-		glUniform1f(auto_Lambert_shader.size, tex->width);
-	}
-	glUniform1f(auto_Lambert_shader.angle, x->theta);
-	glUniform2f(auto_Lambert_shader.object, x->x, x->y);
-	glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_square.first,
-		vertex_index_square.count);
+	if(!(item = queue_item(PASS_SPRITES, SHADER_LAMBERT,
+		is_atlas ? draw.atlas : tex, is_atlas ? draw.atlas : nor))) return;
+	/* The same item is drawn first into the normals, \see{DrawDeferred.h}. */
+	if(deferred.is_frame) QueuePush(PASS_NORMALS, SHADER_NORMALS,
+		queue_image(item->texture), queue_image(item->normal),
+		(unsigned)(item - draw.queue.items));
+	item->instance.x     = x->x;
+	item->instance.y     = x->y;
+	item->instance.angle = x->theta;
+	item->instance.size  = (GLfloat)tex->width;
+	memcpy(item->instance.texture, is_atlas ? tex->atlas : whole_rect,
+		sizeof item->instance.texture);
+	memcpy(item->instance.normal, is_atlas ? nor->atlas : whole_rect,
+		sizeof item->instance.normal);
 }
 
-/** Only used as a callback from \see{display} while OpenGL is using Far. For
- \see{FarsDraw}.
+/** Only used as a callback from \see{display}, for \see{FarsDraw}; drawn with
+ Far in \see{queue_submit}.
  @implements DrawOutput */
 void DrawDisplayFar(const struct Ortho3f *const x,
 	const struct AutoImage *const tex, const struct AutoImage *const nor) {
+	struct DrawItem *item;
 	assert(x && tex && nor);
-	if(current_texture != tex->texture) {
-		glActiveTexture(TexClassTexture(TEX_CLASS_NORMAL));
-		glBindTexture(GL_TEXTURE_2D, nor->texture);
-		glActiveTexture(TexClassTexture(TEX_CLASS_SPRITE));
-		glBindTexture(GL_TEXTURE_2D, tex->texture);
-		current_texture = tex->texture;
-		glUniform1f(auto_Far_shader.size, tex->width);
-	}
-	glUniform1f(auto_Far_shader.angle, x->theta);
-	glUniform2f(auto_Far_shader.object, x->x, x->y);
-	glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_square.first,
-		vertex_index_square.count);
+	if(!(item = queue_item(PASS_FAR, SHADER_FAR, tex, nor))) return;
+	item->instance.x     = x->x;
+	item->instance.y     = x->y;
+	item->instance.angle = x->theta;
+	item->instance.size  = (GLfloat)tex->width;
 }
 
-/** Only used as a callback from \see{display} while OpenGL is using Info. */
+/** Only used as a callback from \see{display}, for \see{SpritesInfo}; drawn
+ with Info in \see{queue_submit}. */
 void DrawDisplayInfo(const struct Vec2f *const x,
 	const struct AutoImage *const tex) {
+	struct DrawItem *item;
 	assert(x && tex);
-	if(current_texture != tex->texture) {
-		glActiveTexture(TexClassTexture(TEX_CLASS_SPRITE));
-		glBindTexture(GL_TEXTURE_2D, tex->texture);
-		current_texture = tex->texture;
-		glUniform1f(auto_Info_shader.size, tex->width);
-	}
-	glUniform2f(auto_Info_shader.object, x->x, x->y);
-	glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_square.first,
-		vertex_index_square.count);
+	if(!(item = queue_item(PASS_INFO, SHADER_INFO, tex, 0))) return;
+	item->instance.x     = x->x;
+	item->instance.y     = x->y;
+	item->instance.angle = 0.0f;
+	item->instance.size  = (GLfloat)tex->width;
 }
@@ -10,6 +10,8 @@ int Draw(void);
 void Draw_(void);
 void DrawSetCamera(const struct Vec2f *const x);
 void DrawGetScreen(struct Rectangle4f *const rect);
+unsigned DrawGetCalls(void);
+void DrawToggleDeferred(void);
 void DrawSetBackground(const char *const key);
 void DrawSetShield(const char *const key);
 void DrawDisplayLambert(const struct Ortho3f *const x,
@@ -0,0 +1,203 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ This is included in \see{Draw.c}. Deferred point lights. The Lambert
+ sprites are first drawn with Normals into {normals}, a screen-sized texture
+ of the normal of the top sprite at every pixel. Then every light is drawn
+ with Light as a square just covering it's radius, added up in {light} only
+ where there are normals. Then Lambert looks up {light} instead of going
+ though the lights in it's tile. The cost goes with lit pixels instead of
+ sprite pixels times lights. It needs frame-buffer objects, a
+ floating-point colour buffer, and the Normals and Light programmes; if the
+ frame-buffers aren't complete or the programmes fail, lighting stays
+ forward.
+
+ @title		DrawDeferred
+ @author	Neil
+ @std		C89/90
+ @version	2018-02
+ @since		2018-02 */
+
+/* {attrib_light} and {attrib_colour} in Light.vs; one per light. */
+struct LightInstance { GLfloat x, y, radius, unused, colour[4]; };
+
+static struct Deferred {
+	int is_supported, is_enabled;
+	/* Set every frame by \see{display}. */
+	int is_frame;
+	GLuint normals, light, fb_normals, fb_light;
+	/* The lights given to \see{deferred_lights}. */
+	struct LightInstance lights[MAX_LIGHTS];
+	unsigned lights_size;
+} deferred;
+
+/** @return Whether this frame is lit deferred. */
+static int deferred_is_on(void) {
+	return deferred.is_supported && deferred.is_enabled;
+}
+
+/** (Re)allocates the {tex} with {internal} format at the screen size.
+ @param class: The texture unit it is bound to for reading. */
+static void deferred_texture(const GLuint tex, const enum TexClass class,
+	const GLint internal, const GLenum type, const int width,
+	const int height) {
+	glActiveTexture(TexClassTexture(class));
+	glBindTexture(GL_TEXTURE_2D, tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, internal, width, height, 0, GL_RGBA, type,
+		0);
+	glActiveTexture(TexClassTexture(TEX_CLASS_SPRITE));
+}
+
+/** Attaches {tex} to {fb}.
+ @return Whether the frame-buffer is complete. */
+static int deferred_attach(const GLuint fb, const GLuint tex) {
+	GLenum status;
+	glBindFramebuffer(GL_FRAMEBUFFER, fb);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_TEXTURE_2D, tex, 0);
+	status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	return status == GL_FRAMEBUFFER_COMPLETE;
+}
+
+/** Called from \see{resize}; the buffers are the size of the screen. */
+static void deferred_resize(const int width, const int height) {
+	if(!deferred.fb_normals) return;
+	deferred_texture(deferred.normals, TEX_CLASS_DEFERRED_NORMALS, GL_RGBA8,
+		GL_UNSIGNED_BYTE, width, height);
+	deferred_texture(deferred.light, TEX_CLASS_DEFERRED_LIGHT, GL_RGBA16F,
+		GL_FLOAT, width, height);
+	deferred.is_supported
+		= deferred_attach(deferred.fb_normals, deferred.normals)
+		&& deferred_attach(deferred.fb_light, deferred.light);
+	if(!deferred.is_supported)
+		fprintf(stderr, "deferred: frame-buffers are not complete at %dx%d; "
+		"lighting is forward.\n", width, height);
+	WindowIsGlError("deferred_resize");
+}
+
+/** Erases the buffers. */
+static void deferred_destroy(void) {
+	if(deferred.fb_normals) {
+		fprintf(stderr, "deferred_destroy: erase Fbo%u, Fbo%u, Tex%u, Tex%u.\n",
+			deferred.fb_normals, deferred.fb_light, deferred.normals,
+			deferred.light);
+		glDeleteFramebuffers(1, &deferred.fb_normals);
+		glDeleteFramebuffers(1, &deferred.fb_light);
+		glDeleteTextures(1, &deferred.normals);
+		glDeleteTextures(1, &deferred.light);
+	}
+	deferred.fb_normals = deferred.fb_light = 0;
+	deferred.normals = deferred.light = 0;
+	deferred.is_supported = deferred.is_frame = 0;
+}
+
+/** Creates the buffers; they're sized in \see{deferred_resize}.
+ @return Whether deferred lighting is possible. */
+static int deferred_create(void) {
+	GLuint tex[2];
+	unsigned i;
+	if(deferred.fb_normals) return deferred.is_supported;
+	glGenTextures(2, tex);
+	deferred.normals = tex[0], deferred.light = tex[1];
+	for(i = 0; i < 2; i++) {
+		glBindTexture(GL_TEXTURE_2D, tex[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+	glGenFramebuffers(1, &deferred.fb_normals);
+	glGenFramebuffers(1, &deferred.fb_light);
+	deferred_resize(16, 16);
+	deferred.is_enabled = 1;
+	fprintf(stderr, "deferred: %s; Fbo%u, Fbo%u, Tex%u, Tex%u.\n",
+		deferred.is_supported ? "ready" : "not supported",
+		deferred.fb_normals, deferred.fb_light, deferred.normals,
+		deferred.light);
+	return deferred.is_supported;
+}
+
+/** Takes the lights for this frame; the radius is where it falls below
+ {light_threshold}, the same as \see{light_cull}. */
+static void deferred_lights(const unsigned lights_size,
+	const struct Vec2f *const positions, const struct Colour3f *const colours) {
+	const unsigned lights = lights_size > MAX_LIGHTS ? MAX_LIGHTS : lights_size;
+	unsigned l;
+	float c;
+	deferred.lights_size = 0;
+	for(l = 0; l < lights; l++) {
+		const struct Colour3f *const colour = colours + l;
+		struct LightInstance *li;
+		c = colour->r > colour->g ? colour->r : colour->g;
+		if(colour->b > c) c = colour->b;
+		if(c <= 0.0f) continue;
+		li = deferred.lights + deferred.lights_size++;
+		li->x = positions[l].x, li->y = positions[l].y;
+		li->radius = c / light_threshold, li->unused = 0.0f;
+		li->colour[0] = colour->r, li->colour[1] = colour->g;
+		li->colour[2] = colour->b, li->colour[3] = 1.0f;
+	}
+}
+
+/** Starts drawing normals; then Lambert sprites are drawn with Normals. */
+static void deferred_normals_begin(void) {
+	glBindFramebuffer(GL_FRAMEBUFFER, deferred.fb_normals);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glDisable(GL_BLEND);
+	glUseProgram(auto_Normals_shader.compiled);
+}
+
+/** Starts adding up lights. */
+static void deferred_light_begin(void) {
+	glBindFramebuffer(GL_FRAMEBUFFER, deferred.fb_light);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glUseProgram(auto_Light_shader.compiled);
+}
+
+/** Back to the screen after either of the deferred passes. */
+static void deferred_end(void) {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+/** Draws the lights from \see{deferred_lights} in one call, or one at a time
+ without instancing. */
+static void deferred_lights_draw(void) {
+	const size_t size = deferred.lights_size;
+	unsigned i;
+	if(!size) return;
+	if(draw.queue.is_instanced) {
+		size_t first;
+		glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+		first = ring_write(deferred.lights, size * sizeof *deferred.lights);
+		glEnableVertexAttribArray(VBO_ATTRIB_INSTANCE);
+		glEnableVertexAttribArray(VBO_ATTRIB_TEXTURE_RECT);
+		glVertexAttribPointer(VBO_ATTRIB_INSTANCE, 4, GL_FLOAT, GL_FALSE,
+			sizeof(struct LightInstance), (GLvoid *)first);
+		glVertexAttribPointer(VBO_ATTRIB_TEXTURE_RECT, 4, GL_FLOAT, GL_FALSE,
+			sizeof(struct LightInstance),
+			(GLvoid *)(first + offsetof(struct LightInstance, colour)));
+		glDrawArraysInstancedARB(GL_TRIANGLE_STRIP, vertex_index_square.first,
+			vertex_index_square.count, (GLsizei)size);
+		draw.calls.current++;
+		glDisableVertexAttribArray(VBO_ATTRIB_INSTANCE);
+		glDisableVertexAttribArray(VBO_ATTRIB_TEXTURE_RECT);
+		glBindBuffer(GL_ARRAY_BUFFER, draw.arrays.vertices);
+	} else {
+		for(i = 0; i < size; i++) {
+			const struct LightInstance *const li = deferred.lights + i;
+			glVertexAttrib4fv(VBO_ATTRIB_INSTANCE, &li->x);
+			glVertexAttrib4fv(VBO_ATTRIB_TEXTURE_RECT, li->colour);
+			glDrawArrays(GL_TRIANGLE_STRIP, vertex_index_square.first,
+				vertex_index_square.count);
+			draw.calls.current++;
+		}
+	}
+}
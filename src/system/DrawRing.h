@@ -0,0 +1,167 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ This is included in \see{Draw.c}. A streaming buffer for data that changes
+ every frame. It is split in {RING_FRAMES} segments, and a frame writes only
+ to it's own; a fence at the end of the frame says when the GPU is done with
+ it, and it's only written again after that, three frames later, so there's
+ almost never a wait. Where {ARB_buffer_storage} and {ARB_sync} are
+ supported, the buffer is mapped once, persistently, and written with
+ {memcpy}. Where not, the whole buffer is orphaned at the start of each frame
+ and written with {glBufferSubData}; the driver does the renaming.
+
+ @title		DrawRing
+ @author	Neil
+ @std		C89/90
+ @version	2018-02
+ @since		2018-02 */
+
+#define RING_FRAMES (3)
+
+#ifdef GL_ARB_buffer_storage /* <-- storage */
+#define RING_PERSISTENT_FLAGS \
+	(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT)
+#endif /* storage --> */
+
+static struct Ring {
+	GLuint buffer;
+	int is_persistent;
+	/* Bytes in each segment, the segment, and how much of it is used. */
+	size_t segment, used;
+	unsigned frame;
+	/* Waits on the GPU; hopefully zero. */
+	unsigned long stalls;
+#ifdef GL_ARB_buffer_storage /* <-- storage */
+	unsigned char *map;
+	GLsync fence[RING_FRAMES];
+#endif /* storage --> */
+} ring;
+
+/** @return Whether the buffer can be persistently mapped. */
+static int ring_is_persistent(void) {
+#ifdef GL_ARB_buffer_storage /* <-- storage */
+	const char *const ext = (const char *)glGetString(GL_EXTENSIONS);
+	return ext && strstr(ext, "GL_ARB_buffer_storage")
+		&& strstr(ext, "GL_ARB_sync");
+#else /* storage --><-- !storage */
+	return 0;
+#endif /* !storage --> */
+}
+
+/** Waits for the GPU to be done with the segment {frame}. */
+static void ring_wait(const unsigned frame) {
+#ifdef GL_ARB_buffer_storage /* <-- storage */
+	GLsync *const fence = ring.fence + frame;
+	GLenum status;
+	if(!*fence) return;
+	for( ; ; ) {
+		status = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+			(GLuint64)1000000000);
+		if(status == GL_ALREADY_SIGNALED) break;
+		ring.stalls++;
+		if(status == GL_CONDITION_SATISFIED) break;
+		if(status == GL_WAIT_FAILED)
+			{ WindowIsGlError("ring_wait"); break; }
+	}
+	glDeleteSync(*fence), *fence = 0;
+#else /* storage --><-- !storage */
+	(void)frame;
+#endif /* !storage --> */
+}
+
+/** Deletes the buffer. */
+static void ring_destroy(void) {
+	unsigned i;
+	if(!ring.buffer) return;
+	for(i = 0; i < RING_FRAMES; i++) ring_wait(i);
+	if(glIsBuffer(ring.buffer)) {
+		fprintf(stderr, "ring_destroy: erase Vbo%u; waited on the GPU %lu "
+			"times.\n", ring.buffer, ring.stalls);
+#ifdef GL_ARB_buffer_storage /* <-- storage */
+		if(ring.map) {
+			glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			ring.map = 0;
+		}
+#endif /* storage --> */
+		glDeleteBuffers(1, &ring.buffer);
+	}
+	ring.buffer = 0;
+	ring.segment = ring.used = 0;
+	ring.frame = 0;
+}
+
+/** Creates the buffer with at least {segment} bytes a frame. Leaves it bound
+ to {GL_ARRAY_BUFFER}.
+ @return Success. */
+static int ring_create(const size_t segment) {
+	size_t s = 4096;
+	while(s < segment) s <<= 1;
+	ring_destroy();
+	glGenBuffers(1, &ring.buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+	ring.segment = s;
+#ifdef GL_ARB_buffer_storage /* <-- storage */
+	if((ring.is_persistent = ring_is_persistent())) {
+		glBufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)(s * RING_FRAMES), 0,
+			RING_PERSISTENT_FLAGS);
+		if(!(ring.map = glMapBufferRange(GL_ARRAY_BUFFER, 0,
+			(GLsizeiptr)(s * RING_FRAMES), RING_PERSISTENT_FLAGS))) {
+			WindowIsGlError("ring_create");
+			fprintf(stderr, "ring_create: can't map; orphaning instead.\n");
+			glDeleteBuffers(1, &ring.buffer);
+			glGenBuffers(1, &ring.buffer);
+			glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+			ring.is_persistent = 0;
+		}
+	}
+#endif /* storage --> */
+	if(!ring.is_persistent) glBufferData(GL_ARRAY_BUFFER,
+		(GLsizeiptr)(s * RING_FRAMES), 0, GL_STREAM_DRAW);
+	fprintf(stderr, "ring_create: %s ring of %u by %luB, Vbo%u.\n",
+		ring.is_persistent ? "persistent" : "orphaning", RING_FRAMES,
+		(unsigned long)s, ring.buffer);
+	return !WindowIsGlError("ring_create");
+}
+
+/** Starts the next segment, growing if it would not fit {need} bytes, and
+ binds it to {GL_ARRAY_BUFFER}.
+ @return Success. */
+static int ring_begin(const size_t need) {
+	if(need > ring.segment && !ring_create(need)) return 0;
+	ring.frame = (ring.frame + 1) % RING_FRAMES;
+	ring.used  = 0;
+	glBindBuffer(GL_ARRAY_BUFFER, ring.buffer);
+	if(ring.is_persistent) {
+		ring_wait(ring.frame);
+	} else {
+		glBufferData(GL_ARRAY_BUFFER,
+			(GLsizeiptr)(ring.segment * RING_FRAMES), 0, GL_STREAM_DRAW);
+	}
+	return 1;
+}
+
+/** Copies {size} bytes of {data} into the segment; the ring must be bound.
+ Must fit in what was given to \see{ring_begin}.
+ @return The offset in the buffer. */
+static size_t ring_write(const void *const data, const size_t size) {
+	const size_t offset = ring.frame * ring.segment + ring.used;
+	assert(ring.used + size <= ring.segment);
+#ifdef GL_ARB_buffer_storage /* <-- storage */
+	if(ring.is_persistent) memcpy(ring.map + offset, data, size); else
+#endif /* storage --> */
+	glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)offset, (GLsizeiptr)size,
+		data);
+	/* Keep the next one aligned for vertex attributes. */
+	ring.used += (size + 15) & ~(size_t)15;
+	return offset;
+}
+
+/** Ends the frame; the segment can't be written until the GPU is done. */
+static void ring_end(void) {
+#ifdef GL_ARB_buffer_storage /* <-- storage */
+	if(ring.is_persistent) ring.fence[ring.frame]
+		= glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+#endif /* storage --> */
+}
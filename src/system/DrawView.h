@@ -0,0 +1,154 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ This is included in \see{Draw.c}. The view is what Far, every Lambert,
+ Normals, and Light all need: the camera, the projection, the screen scales, and the
+ sun. It's kept in {struct AutoView}, generated by Vsfs2h from the block
+ {View} in {View.glsl}, which the shaders include. Where {ARB_uniform_buffer_object} is supported, it's
+ uploaded once a frame into one buffer that all the programmes read;
+ otherwise, it's set as uniforms in each programme, but still only when it
+ changes.
+
+ @title		DrawView
+ @author	Neil
+ @std		C89/90
+ @version	2018-02
+ @since		2018-02 */
+
+/* The uniform buffer binding point of {View}. */
+#define VIEW_BINDING (0)
+
+static struct View {
+	int is_buffer, is_dirty;
+	GLuint buffer;
+	struct AutoView block;
+} view;
+
+/** @return Whether the view can be a uniform buffer. */
+static int view_is_buffer(void) {
+#ifdef GL_ARB_uniform_buffer_object /* <-- ubo */
+	const char *const ext = (const char *)glGetString(GL_EXTENSIONS);
+	return ext && strstr(ext, "GL_ARB_uniform_buffer_object");
+#else /* ubo --><-- !ubo */
+	return 0;
+#endif /* !ubo --> */
+}
+
+/** @return The binding point to give the programmes. */
+static GLuint view_binding(void) {
+	return view.is_buffer ? VIEW_BINDING : AUTO_BLOCK_NONE;
+}
+
+/** Erases the buffer; the view is set as uniforms after this. */
+static void view_destroy(void) {
+	if(view.buffer) {
+		fprintf(stderr, "view_destroy: erase Ubo%u.\n", view.buffer);
+		glDeleteBuffers(1, &view.buffer);
+	}
+	view.buffer = 0;
+	view.is_buffer = 0;
+	view.is_dirty = 1;
+}
+
+/** Creates the buffer if it can, before the programmes are compiled. */
+static void view_create(void) {
+	view.is_dirty = 1;
+	if(!(view.is_buffer = view_is_buffer())) {
+		fprintf(stderr, "view_create: no uniform buffers; setting uniforms "
+			"in each programme.\n");
+		return;
+	}
+#ifdef GL_ARB_uniform_buffer_object /* <-- ubo */
+	glGenBuffers(1, &view.buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, view.buffer);
+	glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)sizeof view.block, 0,
+		GL_STREAM_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, VIEW_BINDING, view.buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	fprintf(stderr, "view_create: %luB at binding %u, Ubo%u.\n",
+		(unsigned long)sizeof view.block, VIEW_BINDING, view.buffer);
+#endif /* ubo --> */
+	if(WindowIsGlError("view_create")) view_destroy();
+}
+
+/** After the programmes are compiled. If the shaders didn't see
+ {GL_ARB_uniform_buffer_object}, they have uniforms instead of the block. */
+static void view_check(void) {
+	unsigned t;
+	if(!view.is_buffer) return;
+	for(t = 0; t < LAMBERT_TIERS; t++)
+		if(draw.lambert.tiers[t].View == AUTO_BLOCK_NONE) break;
+	if(t == LAMBERT_TIERS && auto_Far_shader.View != AUTO_BLOCK_NONE
+		&& auto_Normals_shader.View != AUTO_BLOCK_NONE
+		&& auto_Light_shader.View != AUTO_BLOCK_NONE) return;
+	fprintf(stderr, "view_check: the shaders don't have block View; setting "
+		"uniforms in each programme.\n");
+	view_destroy();
+}
+
+/** Sets the camera; called every frame. */
+static void view_camera(const struct Vec2f *const x) {
+	if(view.block.camera[0] == x->x && view.block.camera[1] == x->y) return;
+	view.block.camera[0] = x->x, view.block.camera[1] = x->y;
+	view.is_dirty = 1;
+}
+
+/** Sets everything that depends on the screen size. */
+static void view_screen(const int width, const int height) {
+	view.block.projection[0] = 2.0f / width;
+	view.block.projection[1] = 2.0f / height;
+	view.block.tile_scale[0] = (float)LIGHT_TILES / width;
+	view.block.tile_scale[1] = (float)LIGHT_TILES / height;
+	view.block.screen_scale[0] = 1.0f / width;
+	view.block.screen_scale[1] = 1.0f / height;
+	view.is_dirty = 1;
+}
+
+/** Sets the sun. */
+static void view_sun(const float direction[3], const float colour[3]) {
+	memcpy(view.block.sun_direction, direction,
+		sizeof view.block.sun_direction);
+	memcpy(view.block.sun_colour, colour, sizeof view.block.sun_colour);
+	view.is_dirty = 1;
+}
+
+/** Sends the view to the buffer or to the programmes if it's changed; before
+ anything is drawn with them. */
+static void view_upload(void) {
+	const struct AutoView *const b = &view.block;
+	unsigned t;
+	if(!view.is_dirty) return;
+	view.is_dirty = 0;
+#ifdef GL_ARB_uniform_buffer_object /* <-- ubo */
+	if(view.is_buffer) {
+		/* Orphaned; the last frame may still be using it. */
+		glBindBuffer(GL_UNIFORM_BUFFER, view.buffer);
+		glBufferData(GL_UNIFORM_BUFFER, (GLsizeiptr)sizeof *b, b,
+			GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		return;
+	}
+#endif /* ubo --> */
+	glUseProgram(auto_Far_shader.compiled);
+	glUniform2fv(auto_Far_shader.camera, 1, b->camera);
+	glUniform2fv(auto_Far_shader.projection, 1, b->projection);
+	glUniform3fv(auto_Far_shader.sun_direction, 1, b->sun_direction);
+	glUniform3fv(auto_Far_shader.sun_colour, 1, b->sun_colour);
+	for(t = 0; t < LAMBERT_TIERS; t++) {
+		const struct AutoLambertShader *const l = draw.lambert.tiers + t;
+		glUseProgram(l->compiled);
+		glUniform2fv(l->camera, 1, b->camera);
+		glUniform2fv(l->projection, 1, b->projection);
+		glUniform2fv(l->tile_scale, 1, b->tile_scale);
+		glUniform3fv(l->sun_direction, 1, b->sun_direction);
+		glUniform3fv(l->sun_colour, 1, b->sun_colour);
+	}
+	glUseProgram(auto_Normals_shader.compiled);
+	glUniform2fv(auto_Normals_shader.camera, 1, b->camera);
+	glUniform2fv(auto_Normals_shader.projection, 1, b->projection);
+	glUseProgram(auto_Light_shader.compiled);
+	glUniform2fv(auto_Light_shader.camera, 1, b->camera);
+	glUniform2fv(auto_Light_shader.projection, 1, b->projection);
+	glUniform2fv(auto_Light_shader.screen_scale, 1, b->screen_scale);
+}
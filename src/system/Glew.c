@@ -11,6 +11,7 @@
  @version	2018-01 */
 
 #include <stdio.h>  /* fprintf */
+#include <string.h> /* strlen strstr */
 /* Inexplicably, Glew will include {win.h} in Windows, which has a bajillon
  warnings that are not the slightest bit useful; assuming you are using {MSVC},
  this silences them. Before {Window.h}. */
@@ -30,6 +31,7 @@
 #endif /* msvc --> */
 
 #endif /* glew --> */
+#include "../Window.h" /* glGetString */
 #include "Glew.h"
 
 /** Load {OpenGL2+} from the library under {-D GLEW}.
@@ -47,3 +49,22 @@ int Glew(void) {
 #endif
 	return 1;
 }
+
+/** Must have a context.
+ @param name: The name of an extension, eg, {GL_ARB_instanced_arrays}.
+ @return Whether the driver has {name}. Under {GLEW}, that's the same as it's
+ flag; otherwise, it's the whole word in {GL_EXTENSIONS}, not just the start
+ of a longer one. */
+int GlewIsExtension(const char *const name) {
+#ifdef GLEW
+	return glewIsSupported(name) ? 1 : 0;
+#else
+	const char *const ext = (const char *)glGetString(GL_EXTENSIONS), *e;
+	const size_t len = strlen(name);
+	if(!ext || !len) return 0;
+	for(e = ext; (e = strstr(e, name)); e += len)
+		if((e == ext || e[-1] == ' ') && (e[len] == ' ' || e[len] == '\0'))
+			return 1;
+	return 0;
+#endif
+}
@@ -1 +1,2 @@
 int Glew(void);
+int GlewIsExtension(const char *const name);
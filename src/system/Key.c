@@ -14,6 +14,7 @@
 #include "../Window.h" /* glut */
 #include "../Unused.h"
 #include "Timer.h"
+#include "Replay.h"
 #include "Key.h"
 
 static struct Key {
@@ -22,9 +23,11 @@ static struct Key {
 	int integral;
 	int time;
 	void (*handler)(void);
+	int is_live;
 } keys[KEY_MAX];
 
 /* private prototypes */
+static void key_handle(const int k);
 /* <-- glut */
 static enum Keys glut_to_keys(const int k);
 static void key_down(unsigned char k, int x, int y);
@@ -44,10 +47,26 @@ void Key(void) {
 	/* glut --> */
 }
 
-/** Registers a function to call asynchronously on press. */
+/** Registers a function to call asynchronously on press. It's part of the
+ input, so it's recorded and played back by \see{ReplayKey}. */
 void KeyRegister(const unsigned k, void (*const handler)(void)) {
 	if(k >= KEY_MAX) return;
 	keys[k].handler = handler;
+	keys[k].is_live = 0;
+}
+
+/** Registers a function to call asynchronously on press that doesn't change
+ the game, so it always runs, even when playing back, and isn't recorded. */
+void KeyRegisterLive(const unsigned k, void (*const handler)(void)) {
+	if(k >= KEY_MAX) return;
+	keys[k].handler = handler;
+	keys[k].is_live = 1;
+}
+
+/** Calls the function registered with {k}; used when playing back. */
+void KeyCall(const unsigned k) {
+	if(k >= KEY_MAX || !keys[k].handler) return;
+	keys[k].handler();
 }
 
 /** Polls how long the key has been pressed, without repeat rate. Destructive.
@@ -69,6 +88,14 @@ int KeyTime(const int key) {
 	return time;
 }
 
+/** Calls the handler of {k}, which was just pressed, if \see{ReplayKey} lets
+ it. */
+static void key_handle(const int k) {
+	struct Key *const key = &keys[k];
+	if(!key->handler || (!key->is_live && !ReplayKey((unsigned)k))) return;
+	key->handler();
+}
+
 /* <-- glut */
 
 /** GLUT_ to internal keys.
@@ -107,7 +134,7 @@ static void key_down(unsigned char k, int x, int y) {
 	if(key->state) return;
 	key->state = -1;
 	key->down  = TimerGetTime();
-	if(key->handler) key->handler();
+	key_handle(k);
 	/* fprintf(stderr, "key_down: key %d hit at %d ms.\n", k, key->down);*/
 	UNUSED(x), UNUSED(y);
 }
@@ -128,7 +155,7 @@ static void key_down_special(int k, int x, int y) {
 	if(key->state) return;
 	key->state  = -1;
 	key->down = TimerGetTime();
-	if(key->handler) key->handler();
+	key_handle(glut_to_keys(k));
 	/* fprintf(stderr, "key_down_special: key %d hit at %d ms.\n", k, key->down);*/
 	UNUSED(x), UNUSED(y);
 }
@@ -32,5 +32,7 @@ enum Keys {
 
 void Key(void);
 void KeyRegister(const unsigned k, void (*const handler)(void));
+void KeyRegisterLive(const unsigned k, void (*const handler)(void));
+void KeyCall(const unsigned k);
 int KeyTime(const int key);
 int KeyPress(const int key);
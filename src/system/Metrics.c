@@ -0,0 +1,109 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ Counters for watching a running game from outside, for soak tests. The
+ {Metrics} struct is mapped to a file, so setting a counter is a store to
+ memory and there are no system calls on the game side; another process can
+ map the same file and poll it. Where the file can't be mapped, there are no
+ metrics.
+
+ @title		Metrics
+ @author	Neil
+ @std		C89/90, POSIX mmap
+ @version	2018-02 */
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)) /* <-- mmap */
+#define METRICS_MMAP
+#define _XOPEN_SOURCE 500 /* ftruncate */
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif /* mmap --> */
+#include <stdio.h>  /* perror fprintf */
+#include <string.h> /* memset memcpy */
+#include "Metrics.h"
+
+/* The counters have to be stored between the two stores to {sequence}, as
+ the compiler and the processor see it; {volatile} only orders {sequence}. */
+#ifdef __GNUC__ /* <-- gnu */
+#define METRICS_BARRIER() __sync_synchronize()
+#else /* gnu --><-- !gnu */
+#define METRICS_BARRIER() ((void)0) /* a reader may see a torn frame */
+#endif /* !gnu --> */
+
+static const char metrics_magic[8] = { 'V', 'o', 'i', 'd', 'M', 'e', 't', 'r' };
+static const unsigned metrics_version = 1;
+
+static struct {
+	const char *fn;
+	struct Metrics *page;
+	/* Written through this so the stores to the sequence are not elided. */
+	volatile unsigned *sequence;
+} metrics;
+
+/** Unmaps the file; it's left behind with the last values. */
+void Metrics_(void) {
+	if(!metrics.page) return;
+#ifdef METRICS_MMAP /* <-- mmap */
+	if(munmap((void *)metrics.page, sizeof *metrics.page)) perror(metrics.fn);
+#endif /* mmap --> */
+	fprintf(stderr, "~Metrics: %s.\n", metrics.fn);
+	metrics.page = 0, metrics.sequence = 0, metrics.fn = 0;
+}
+
+/** Creates {fn} and maps it.
+ @return Success. */
+int Metrics(const char *const fn) {
+#ifdef METRICS_MMAP /* <-- mmap */
+	int fd;
+	void *map;
+	if(metrics.page || !fn) return 0;
+	if((fd = open(fn, O_RDWR | O_CREAT | O_TRUNC, 0644)) == -1)
+		return perror(fn), 0;
+	if(ftruncate(fd, (off_t)sizeof *metrics.page)) {
+		perror(fn), close(fd);
+		return 0;
+	}
+	map = mmap(0, sizeof *metrics.page, PROT_READ | PROT_WRITE, MAP_SHARED,
+		fd, 0);
+	/* The mapping stays after the descriptor is closed. */
+	if(close(fd)) perror(fn);
+	if(map == MAP_FAILED) return perror(fn), 0;
+	metrics.fn   = fn;
+	metrics.page = map;
+	memset(metrics.page, 0, sizeof *metrics.page);
+	memcpy(metrics.page->magic, metrics_magic, sizeof metrics_magic);
+	metrics.page->version = metrics_version;
+	metrics.page->size    = sizeof *metrics.page;
+	metrics.sequence = &metrics.page->sequence;
+	fprintf(stderr, "Metrics: mapped %s.\n", fn);
+	return 1;
+#else /* mmap --><-- !mmap */
+	fprintf(stderr, "Metrics: %s: not supported on this system.\n", fn);
+	return 0;
+#endif /* !mmap --> */
+}
+
+/** Starts updating the counters; every call must be followed by
+ \see{MetricsEnd}.
+ @return The counters, or null if there's no file. */
+struct Metrics *MetricsBegin(void) {
+	if(!metrics.page) return 0;
+	(*metrics.sequence)++;
+	METRICS_BARRIER();
+	return metrics.page;
+}
+
+/** Puts {ms_frame} in the histogram and lets readers have the counters. */
+void MetricsEnd(const unsigned ms_frame) {
+	unsigned bucket = 0, ms = ms_frame;
+	if(!metrics.page) return;
+	while(ms && bucket < METRICS_BUCKETS - 1) ms >>= 1, bucket++;
+	metrics.page->frame_ms[bucket]++;
+	metrics.page->ms_frame = ms_frame;
+	metrics.page->frame++;
+	METRICS_BARRIER();
+	(*metrics.sequence)++;
+}
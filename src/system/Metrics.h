@@ -0,0 +1,25 @@
+/* Frame-time histogram; bucket {i > 0} counts frames of {[2^(i-1), 2^i)}ms,
+ and the last one counts everything longer. */
+#define METRICS_BUCKETS (16)
+
+/** The layout of the metrics file; an external tool can map it and poll.
+ {sequence} is odd while the game is writing; a reader copies the struct and
+ tries again if {sequence} was odd or changed. There's a full barrier after
+ the first and before the second change of {sequence}, so a reader needs one
+ after reading it before the copy and before reading it again after. */
+struct Metrics {
+	char magic[8];
+	unsigned version, size;
+	unsigned sequence;
+	unsigned frame, ms_game, ms_frame;
+	unsigned ships, ships_capacity, debris, debris_capacity,
+		wmds, wmds_capacity, gates, gates_capacity;
+	unsigned bins, covers, collisions, lights, logical_lights, events,
+		draw_calls;
+	unsigned frame_ms[METRICS_BUCKETS];
+};
+
+void Metrics_(void);
+int Metrics(const char *const fn);
+struct Metrics *MetricsBegin(void);
+void MetricsEnd(const unsigned ms_frame);
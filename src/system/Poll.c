@@ -14,6 +14,7 @@
 #include <stdlib.h> /* malloc */
 #include <stdio.h> /* perror */
 #include "Key.h"
+#include "Replay.h"
 #include "Poll.h"
 
 struct PollKey {
@@ -56,11 +57,16 @@ static void axis(struct PollAxis *a) {
 	a->ms = KeyTime(a->increase) - KeyTime(a->decrease);
 }
 
-/** Should be called every frame to update the joystick-like keys. */
+/** Should be called every frame to update the joystick-like keys. They are
+ recorded or replaced by \see{ReplayInput}. */
 void PollUpdate(void) {
+	int shoot;
 	axis(&poll.move_x);
 	axis(&poll.move_y);
 	press(&poll.shoot);
+	shoot = (int)poll.shoot.ms;
+	ReplayInput(&poll.move_x.ms, &poll.move_y.ms, &shoot);
+	poll.shoot.ms = (unsigned)shoot;
 }
 
 /** Accessor. */
@@ -0,0 +1,264 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ A cache of linked shader programmes, so that the second time the game starts
+ it doesn't compile anything. The programmes generated by Vsfs2h ask
+ \see{ProgramsLoad} before they compile, and give the result to
+ \see{ProgramsStore} after they link. The binary is only good for the same
+ driver, so the key is the vendor, renderer, and version strings, followed
+ by the name, the defines, and the sources; it's hashed for the file name and
+ compared in full when it's read. A file that doesn't match or that the
+ driver refuses is a miss, and is overwritten. Without
+ {ARB_get_program_binary}, or without any binary formats, there is no cache.
+
+ @title		Programs
+ @author	Neil
+ @std		C89/90, POSIX mkdir
+ @version	2018-02 */
+
+#if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__)) /* <-- posix */
+#define PROGRAMS_MKDIR
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif /* posix --> */
+#include <stdlib.h> /* malloc realloc free */
+#include <stdio.h>  /* fopen fread fwrite fclose remove perror fprintf */
+#include <string.h> /* strlen strstr memcpy memcmp memset */
+#include "Programs.h"
+
+/* Enough for the directory and "/<name>-<hash>.bin". */
+#define PROGRAMS_PATH (256)
+
+static const char programs_magic[8] = { 'V', 'o', 'i', 'd', 'P', 'r', 'o', 'g' };
+static const unsigned programs_version = 1;
+
+/* What is written before the key and the binary. */
+struct ProgramsHeader {
+	char magic[8];
+	unsigned version;
+	GLenum format;
+	unsigned long key_size, binary_size;
+};
+
+static struct {
+	const char *directory;
+	/* Checked on the first use, when there's a context. */
+	int is_checked, is_supported;
+	/* The key of the last programme. */
+	char *key;
+	size_t key_size, key_capacity;
+	char path[PROGRAMS_PATH];
+	unsigned hits, misses, stores;
+} programs = { "cache", 0, 0, 0, 0, 0, "", 0, 0, 0 };
+
+/** Prints what the cache did and frees the key. */
+void Programs_(void) {
+	if(programs.is_supported) fprintf(stderr, "Programs: %u loaded, %u "
+		"compiled, %u stored in \"%s\".\n", programs.hits, programs.misses,
+		programs.stores, programs.directory);
+	free(programs.key), programs.key = 0;
+	programs.key_size = programs.key_capacity = 0;
+}
+
+/** Sets where the programmes are kept; it's created when the first is stored.
+ @param directory: If null, there's no cache. The default is {cache}.
+ @return Success. */
+int Programs(const char *const directory) {
+	if(directory && strlen(directory) > PROGRAMS_PATH - 32) {
+		fprintf(stderr, "Programs: \"%s\" is too long.\n", directory);
+		return 0;
+	}
+	programs.directory = directory;
+	return 1;
+}
+
+/** @return Whether programme binaries can be got and given back. */
+static int is_supported(void) {
+	if(programs.is_checked) return programs.is_supported;
+	programs.is_checked = 1;
+	if(!programs.directory) return 0;
+#ifdef GL_ARB_get_program_binary /* <-- binary */
+	{
+		const char *const ext = (const char *)glGetString(GL_EXTENSIONS);
+		GLint formats = 0;
+		if(!ext || !strstr(ext, "GL_ARB_get_program_binary")) {
+			fprintf(stderr, "Programs: no programme binaries; compiling "
+				"every time.\n");
+			return 0;
+		}
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if(formats <= 0) {
+			fprintf(stderr, "Programs: the driver has no programme binary "
+				"formats; compiling every time.\n");
+			return 0;
+		}
+		fprintf(stderr, "Programs: caching programmes in \"%s\"; %d binary "
+			"format%s.\n", programs.directory, formats, formats == 1 ? "" : "s");
+	}
+	return programs.is_supported = 1;
+#else /* binary --><-- !binary */
+	return 0;
+#endif /* !binary --> */
+}
+
+/** Lets the driver compile on as many threads as it has; the programmes are
+ then all started before any are checked. */
+void ProgramsParallel(void) {
+	const char *const ext = (const char *)glGetString(GL_EXTENSIONS);
+	if(!ext) return;
+#ifdef GL_KHR_parallel_shader_compile /* <-- khr */
+	if(strstr(ext, "GL_KHR_parallel_shader_compile")) {
+		glMaxShaderCompilerThreadsKHR(0xffffffff);
+		fprintf(stderr, "Programs: compiling in parallel, KHR.\n");
+		return;
+	}
+#endif /* khr --> */
+#ifdef GL_ARB_parallel_shader_compile /* <-- arb */
+	if(strstr(ext, "GL_ARB_parallel_shader_compile")) {
+		glMaxShaderCompilerThreadsARB(0xffffffff);
+		fprintf(stderr, "Programs: compiling in parallel, ARB.\n");
+		return;
+	}
+#endif /* arb --> */
+}
+
+/** Appends {s} and a separator to the key.
+ @return Success. */
+static int key_append(const char *const s) {
+	const size_t size = strlen(s) + 1;
+	if(programs.key_size + size > programs.key_capacity) {
+		size_t c = programs.key_capacity ? programs.key_capacity : 4096;
+		char *key;
+		while(c < programs.key_size + size) c <<= 1;
+		if(!(key = realloc(programs.key, c))) return perror("Programs"), 0;
+		programs.key = key, programs.key_capacity = c;
+	}
+	memcpy(programs.key + programs.key_size, s, size);
+	programs.key_size += size;
+	return 1;
+}
+
+/** Builds the key and the file name, {programs.path}.
+ @return Success. */
+static int key(const char *const name, const char *const defines,
+	const char *const vs, const char *const fs) {
+	const char *driver[3];
+	unsigned long hash = 2166136261ul;
+	size_t i;
+	driver[0] = (const char *)glGetString(GL_VENDOR);
+	driver[1] = (const char *)glGetString(GL_RENDERER);
+	driver[2] = (const char *)glGetString(GL_VERSION);
+	programs.key_size = 0;
+	for(i = 0; i < 3; i++) if(!key_append(driver[i] ? driver[i] : "")) return 0;
+	if(!key_append(name) || !key_append(defines ? defines : "")
+		|| !key_append(vs) || !key_append(fs)) return 0;
+	/* FNV-1a, 32 bits. */
+	for(i = 0; i < programs.key_size; i++) {
+		hash ^= (unsigned char)programs.key[i];
+		hash = (hash * 16777619ul) & 0xfffffffful;
+	}
+	if(strlen(name) > PROGRAMS_PATH - strlen(programs.directory) - 16) {
+		fprintf(stderr, "Programs: \"%s\" is too long.\n", name);
+		return 0;
+	}
+	sprintf(programs.path, "%s/%s-%08lx.bin", programs.directory, name, hash);
+	return 1;
+}
+
+/** Tries to give {programme} the binary that was stored for these sources.
+ Before {programme} is linked.
+ @return Whether {programme} is linked from the cache; if not, it must be
+ compiled. */
+int ProgramsLoad(const GLuint programme, const char *const name,
+	const char *const defines, const char *const vs, const char *const fs) {
+#ifdef GL_ARB_get_program_binary /* <-- binary */
+	struct ProgramsHeader h;
+	FILE *fp;
+	char *buffer = 0;
+	size_t size;
+	GLint status = 0;
+	if(!is_supported()) return 0;
+	/* Otherwise, the driver might not keep it to give back. */
+	glProgramParameteri(programme, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+		GL_TRUE);
+	if(!key(name, defines, vs, fs)) return 0;
+	if(!(fp = fopen(programs.path, "rb"))) return programs.misses++, 0;
+	do {
+		if(fread(&h, sizeof h, 1, fp) != 1
+			|| memcmp(h.magic, programs_magic, sizeof h.magic)
+			|| h.version != programs_version
+			|| h.key_size != programs.key_size
+			|| !h.binary_size || h.binary_size > 0x7ffffffful) break;
+		size = programs.key_size + h.binary_size;
+		if(!(buffer = malloc(size))) { perror(programs.path); break; }
+		if(fread(buffer, 1, size, fp) != size
+			|| memcmp(buffer, programs.key, programs.key_size)) break;
+		glProgramBinary(programme, h.format, buffer + programs.key_size,
+			(GLsizei)h.binary_size);
+		glGetProgramiv(programme, GL_LINK_STATUS, &status);
+	} while(0);
+	free(buffer);
+	fclose(fp);
+	if(!status) {
+		fprintf(stderr, "Programs: \"%s\" is stale.\n", programs.path);
+		return programs.misses++, 0;
+	}
+	programs.hits++;
+	return 1;
+#else /* binary --><-- !binary */
+	(void)programme, (void)name, (void)defines, (void)vs, (void)fs;
+	return 0;
+#endif /* !binary --> */
+}
+
+/** Stores the binary of {programme}, just linked from these sources, so that
+ \see{ProgramsLoad} can find it next time. */
+void ProgramsStore(const GLuint programme, const char *const name,
+	const char *const defines, const char *const vs, const char *const fs) {
+#ifdef GL_ARB_get_program_binary /* <-- binary */
+	struct ProgramsHeader h;
+	FILE *fp = 0;
+	char *binary = 0;
+	GLint length = 0;
+	GLsizei got = 0;
+	enum { E_NO, E_BINARY, E_FILE } e = E_NO;
+	if(!is_supported() || !key(name, defines, vs, fs)) return;
+	glGetProgramiv(programme, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0) return;
+	memset(&h, 0, sizeof h);
+	do {
+		if(!(binary = malloc((size_t)length))) { e = E_BINARY; break; }
+		glGetProgramBinary(programme, length, &got, &h.format, binary);
+		if(got <= 0) break;
+#ifdef PROGRAMS_MKDIR /* <-- mkdir */
+		mkdir(programs.directory, 0755); /* Usually it's there already. */
+#endif /* mkdir --> */
+		memcpy(h.magic, programs_magic, sizeof h.magic);
+		h.version     = programs_version;
+		h.key_size    = (unsigned long)programs.key_size;
+		h.binary_size = (unsigned long)got;
+		if(!(fp = fopen(programs.path, "wb"))
+			|| fwrite(&h, sizeof h, 1, fp) != 1
+			|| fwrite(programs.key, 1, programs.key_size, fp)
+			!= programs.key_size
+			|| fwrite(binary, 1, (size_t)got, fp) != (size_t)got)
+			{ e = E_FILE; break; }
+	} while(0); switch(e) { /* catch */
+		case E_NO: break;
+		case E_BINARY: perror("Programs"); break;
+		case E_FILE: perror(programs.path); break;
+	} { /* finally */
+		if(fp && fclose(fp)) e = E_FILE, perror(programs.path);
+		/* Half a file would only be stale. */
+		if(fp && e) remove(programs.path);
+		free(binary);
+	}
+	if(!e && got > 0) programs.stores++;
+#else /* binary --><-- !binary */
+	(void)programme, (void)name, (void)defines, (void)vs, (void)fs;
+#endif /* !binary --> */
+}
+
+/** @return How many programmes were loaded from the cache. */
+unsigned ProgramsGetHits(void) { return programs.hits; }
@@ -0,0 +1,10 @@
+#include "../Window.h" /* GL */
+
+void Programs_(void);
+int Programs(const char *const directory);
+void ProgramsParallel(void);
+int ProgramsLoad(const GLuint programme, const char *const name,
+	const char *const defines, const char *const vs, const char *const fs);
+void ProgramsStore(const GLuint programme, const char *const name,
+	const char *const defines, const char *const vs, const char *const fs);
+unsigned ProgramsGetHits(void);
@@ -0,0 +1,174 @@
+/** 2018 Neil Edelman, distributed under the terms of the GNU General
+ Public License 3, see copying.txt, or
+ \url{ https://opensource.org/licenses/GPL-3.0 }.
+
+ Records the input on every tick, so that a session can be played back
+ exactly. A file has a header line with the version and the seed given to
+ \see{Random}, then one line per tick of the game-time, the frame-time, and
+ the \see{Poll} axes. Keys that have handlers, \see{KeyRegister}, are lines
+ of their own, {key <k>}, between the ticks they were pressed between, and
+ are called there on playback, instead of from the keyboard. On playback, the time comes from the file instead of
+ the clock, so the simulation is the same; it can also run unthrottled, for
+ benchmarking, and stops at the end of the file. The window should be the same
+ size, since that determines what's updated.
+
+ @title		Replay
+ @author	Neil
+ @std		C89/90
+ @version	2018-02 */
+
+#include <stdio.h>  /* fopen fprintf fscanf */
+#include <time.h>   /* time clock */
+#include <errno.h>  /* errno */
+#include "../general/Random.h"
+#include "Timer.h"
+#include "Key.h"
+#include "Replay.h"
+
+static const char *const replay_magic = "Void replay";
+static const unsigned replay_version = 2;
+
+static struct Replay {
+	enum ReplayMode mode;
+	int is_unthrottled;
+	FILE *fp;
+	const char *fn;
+	unsigned ticks, ms_start;
+	struct ReplayTick {
+		unsigned game, dt;
+		int right, up, shoot;
+	} tick;
+} replay;
+
+/** Closes the file; if it was playing, prints how long it took. */
+void Replay_(void) {
+	if(replay.mode == REPLAY_PLAY && replay.ticks) {
+		const unsigned ms = TimerGetTime() - replay.ms_start;
+		fprintf(stderr, "~Replay: %s: %u ticks in %ums, %.3fms per tick.\n",
+			replay.fn, replay.ticks, ms,
+			replay.ticks ? (double)ms / replay.ticks : 0.0);
+	}
+	if(replay.fp && fclose(replay.fp)) perror(replay.fn);
+	replay.fp = 0;
+	replay.mode = REPLAY_OFF;
+}
+
+/** Sets up the replay. Should be called before anything random, since it
+ calls \see{Random}.
+ @param fn: The file to record to or play back from.
+ @param mode: If {REPLAY_OFF}, it just seeds {Random} from the clock.
+ @param is_unthrottled: When playing, doesn't wait between ticks.
+ @return Success. */
+int Replay(const char *const fn, const enum ReplayMode mode,
+	const int is_unthrottled) {
+	unsigned version;
+	unsigned long seed;
+	replay.mode = REPLAY_OFF;
+	replay.is_unthrottled = 0;
+	replay.fp = 0;
+	replay.fn = fn;
+	replay.ticks = 0;
+	errno = 0;
+	switch(mode) {
+	case REPLAY_OFF:
+		/* Entropy increase. */
+		Random((unsigned long)time(0) ^ (unsigned long)clock());
+		return 1;
+	case REPLAY_RECORD:
+		if(!fn || !(replay.fp = fopen(fn, "w"))) break;
+		Random((unsigned long)time(0) ^ (unsigned long)clock());
+		if(fprintf(replay.fp, "%s %u %lu\n", replay_magic, replay_version,
+			RandomGetSeed()) < 0) break;
+		replay.mode = mode;
+		fprintf(stderr, "Replay: recording to %s.\n", fn);
+		return 1;
+	case REPLAY_PLAY:
+		if(!fn || !(replay.fp = fopen(fn, "r"))) break;
+		if(fscanf(replay.fp, "Void replay %u %lu\n", &version, &seed) != 2
+			|| version != replay_version) {
+			fprintf(stderr, "Replay: %s is not a version %u replay.\n", fn,
+				replay_version);
+			Replay_();
+			return 0;
+		}
+		Random(seed);
+		replay.mode = mode;
+		replay.is_unthrottled = is_unthrottled;
+		/* The timer isn't running yet; it starts on the first tick. */
+		replay.ms_start = 0;
+		fprintf(stderr, "Replay: playing %s%s.\n", fn,
+			is_unthrottled ? ", unthrottled" : "");
+		return 1;
+	}
+	if(errno) perror(fn);
+	Replay_();
+	return 0;
+}
+
+/** @return Whether time and input is coming from the file. */
+int ReplayIsPlaying(void) { return replay.mode == REPLAY_PLAY; }
+
+/** @return Whether the playback should go as fast as possible. */
+int ReplayIsUnthrottled(void) {
+	return replay.mode == REPLAY_PLAY && replay.is_unthrottled;
+}
+
+/** Called by the \see{Timer} every tick before the game logic. When
+ recording, remembers {game} and {dt}; when playing, calls the keys that were
+ pressed since the last tick with the game-time of that tick, then replaces
+ {game} and {dt} with the next tick in the file.
+ @return False if the playback is over. */
+int ReplayTime(unsigned *const game, unsigned *const dt) {
+	struct ReplayTick *const t = &replay.tick;
+	char line[64];
+	unsigned key;
+	switch(replay.mode) {
+	case REPLAY_OFF: break;
+	case REPLAY_RECORD: t->game = *game, t->dt = *dt; break;
+	case REPLAY_PLAY:
+		if(!replay.ticks) replay.ms_start = TimerGetTime();
+		else *game = t->game;
+		for( ; ; ) {
+			if(!fgets(line, sizeof line, replay.fp)) return 0;
+			if(sscanf(line, "key %u", &key) != 1) break;
+			KeyCall(key);
+		}
+		if(sscanf(line, "%u %u %d %d %d", &t->game, &t->dt,
+			&t->right, &t->up, &t->shoot) != 5) return 0;
+		replay.ticks++;
+		*game = t->game, *dt = t->dt;
+		break;
+	}
+	return 1;
+}
+
+/** Called by \see{Key} when {k}, which has a handler, is pressed. When
+ recording, writes it; when playing, it comes from the file instead.
+ @return Whether to call the handler. */
+int ReplayKey(const unsigned k) {
+	switch(replay.mode) {
+	case REPLAY_OFF: break;
+	case REPLAY_RECORD:
+		if(fprintf(replay.fp, "key %u\n", k) < 0) perror(replay.fn), Replay_();
+		break;
+	case REPLAY_PLAY: return 0;
+	}
+	return 1;
+}
+
+/** Called by \see{PollUpdate} every tick. When recording, writes the tick;
+ when playing, replaces the input with the tick's. */
+void ReplayInput(int *const right, int *const up, int *const shoot) {
+	struct ReplayTick *const t = &replay.tick;
+	switch(replay.mode) {
+	case REPLAY_OFF: break;
+	case REPLAY_RECORD:
+		if(fprintf(replay.fp, "%u %u %d %d %d\n", t->game, t->dt, *right, *up,
+			*shoot) < 0) perror(replay.fn), Replay_();
+		replay.ticks++;
+		break;
+	case REPLAY_PLAY:
+		*right = t->right, *up = t->up, *shoot = t->shoot;
+		break;
+	}
+}
@@ -0,0 +1,10 @@
+enum ReplayMode { REPLAY_OFF, REPLAY_RECORD, REPLAY_PLAY };
+
+int Replay(const char *const fn, const enum ReplayMode mode,
+	const int is_unthrottled);
+void Replay_(void);
+int ReplayIsPlaying(void);
+int ReplayIsUnthrottled(void);
+int ReplayTime(unsigned *const game, unsigned *const dt);
+void ReplayInput(int *const right, int *const up, int *const shoot);
+int ReplayKey(const unsigned k);
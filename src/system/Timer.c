@@ -11,7 +11,9 @@
 
 #include <stdio.h>	/* fprintf */
 #include <limits.h> /* MAX_INT, MIN_INT */
+#include <stdlib.h> /* exit */
 #include "../Unused.h"
+#include "Replay.h"
 #include "Timer.h"
 
 /* 50 fps. @fixme Sync to refresh, why is it so hard? */
@@ -37,13 +39,26 @@ static unsigned ms_time(void) {
  @param zero: Unused. */
 static void update(int zero) {
 	const unsigned time = ms_time();
-	const unsigned dt   = time - timer.last;
+	unsigned dt = time - timer.last;
 	if(!timer.is_running) return;
 	timer.last = time;
 	timer.game = timer.last - timer.paused;
+	/* The time might come from a recording. */
+	if(!ReplayTime(&timer.game, &dt)) {
+		fprintf(stderr, "Timer: end of replay.\n");
+		TimerPause();
+		/* <-- glut */
+#ifdef FREEGLUT /* <-- free */
+		glutLeaveMainLoop();
+#else /* free --><-- !free */
+		exit(EXIT_SUCCESS); /* GLUT1998 */
+#endif /* !free --> */
+		/* glut --> */
+		return;
+	}
 	timer.mean_frame
 		= (timer.mean_frame * persistance + dt * (1024 - persistance)) >> 10;
-	glutTimerFunc(frametime_ms, &update, 0);
+	glutTimerFunc(ReplayIsUnthrottled() ? 0 : frametime_ms, &update, 0);
 	timer.logic(dt);
 	glutPostRedisplay();
 	UNUSED(zero);
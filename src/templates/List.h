@@ -997,6 +997,7 @@ static void PRIVATE_T_U_(list, cat)(struct T_(List) *const this,
 		this->U_(first) = from->U_(first);
 	} else {                      /* there is something in both */
 		this->U_(last)->U_(next) = from->U_(first);
+		from->U_(first)->U_(prev) = this->U_(last);
 	}
 	this->U_(last) = from->U_(last);
 	from->U_(first) = from->U_(last) = 0;
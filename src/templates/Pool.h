@@ -526,6 +526,27 @@ static size_t T_(PoolGetIndex)(struct T_(Pool) *const this,
 		- this->array;
 }
 
+/** @param this: If {this} is null, returns zero.
+ @return The number of elements that are in the pool, not counting removed.
+ @order O({removed})
+ @allow */
+static size_t T_(PoolGetSize)(const struct T_(Pool) *const this) {
+	size_t size, e;
+	if(!this) return 0;
+	for(size = this->size, e = this->head; e != pool_null;
+		e = this->array[e].next) assert(size), size--;
+	return size;
+}
+
+/** @param this: If {this} is null, returns zero.
+ @return The number of elements that will fit before it has to grow.
+ @order \Theta(1)
+ @allow */
+static size_t T_(PoolGetCapacity)(const struct T_(Pool) *const this) {
+	if(!this) return 0;
+	return this->capacity[0];
+}
+
 /** Increases the capacity of this Pool to ensure that it can hold at least
  the number of elements specified by the {min_capacity}.
  @param this: If {this} is null, returns false.
@@ -726,6 +747,8 @@ static void PRIVATE_T_(unused_set)(void) {
 	T_(PoolIsValid)(0);
 	T_(PoolGetElement)(0, (size_t)0);
 	T_(PoolGetIndex)(0, 0);
+	T_(PoolGetSize)(0);
+	T_(PoolGetCapacity)(0);
 	T_(PoolReserve)(0, (size_t)0);
 	T_(PoolNew)(0);
 	T_(PoolRemove)(0, 0);
@@ -0,0 +1,57 @@
+/* Tests {Events} against a stand-in game clock; compile with
+ {gcc -ansi -pedantic -Wall -o EventsTest EventsTest.c ../src/general/Events.c}. */
+
+#include <stdlib.h> /* EXIT_ */
+#include <stdio.h>  /* printf */
+#include "../src/general/Events.h"
+
+/* {Events} reads the time from {Timer}. */
+static unsigned game_time;
+unsigned TimerGetGameTime(void);
+unsigned TimerGetGameTime(void) { return game_time; }
+
+#define TIMES (8)
+
+static unsigned fired[TIMES], fired_size;
+
+/* Reschedules itself {param} ms later, until it's done {TIMES}.
+ @implements IntConsumer */
+static void again(const int param) {
+	fired[fired_size++] = game_time;
+	if(fired_size < TIMES) EventsIntConsumer((unsigned)param, &again, param);
+}
+
+/** Runs {again} every {delay} ms, advancing the clock by {step}.
+ @return Whether it fired on time every time. */
+static int reschedule(const unsigned delay, const unsigned step) {
+	unsigned i, expect;
+	int is_good = 1;
+	fired_size = 0;
+	EventsIntConsumer(delay, &again, (int)delay);
+	for(i = 0; fired_size < TIMES && i < 100000; i++)
+		game_time += step, EventsUpdate();
+	for(expect = fired[0], i = 0; i < TIMES; i++) {
+		/* It can be late by up to a step; it can't be early. */
+		if(i >= fired_size || fired[i] < expect || fired[i] >= expect + step
+			+ (step > 1 ? 1 : 0)) is_good = 0;
+		if(i < fired_size) expect = fired[i] + delay;
+	}
+	printf("every %ums, stepping %ums: fired %u times, first at %u, last at "
+		"%u, %s.\n", delay, step, fired_size, fired[0],
+		fired_size ? fired[fired_size - 1] : 0, is_good ? "good" : "WRONG");
+	return is_good && !EventsGetSize();
+}
+
+int main(void) {
+	int is_pass = 1;
+	game_time = 1000;
+	if(!Events()) return EXIT_FAILURE;
+	/* A whole turn of the finest level used to land in the slot that was
+	 running, so it fired straight away. */
+	if(!reschedule(256, 1) || !reschedule(256, 10) || !reschedule(512, 7)
+		|| !reschedule(1, 1) || !reschedule(0, 3)
+		|| !reschedule(70000, 1000)) is_pass = 0;
+	Events_();
+	printf("%s.\n", is_pass ? "pass" : "FAIL");
+	return is_pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
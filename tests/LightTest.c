@@ -0,0 +1,131 @@
+/* Tests the light budget of {SpritesLight.h} with more lights than
+ {MAX_LIGHTS}; compile with
+ {gcc -std=c99 -pedantic -Wall -o LightTest LightTest.c ../src/general/Random.c -lm}. */
+
+#include <stdlib.h> /* EXIT_ */
+#include <stdio.h>  /* printf */
+#include <string.h> /* memcpy in SpritesLight.h */
+#include <float.h>  /* FLT_MAX in SpritesLight.h */
+#include "../src/Ortho.h"
+
+/* As in {Sprites.c}. */
+#define MAX_LIGHTS (256)
+#define MAX_LOGICAL_LIGHTS (2048)
+struct Sprite {
+	struct Ortho3f x;
+	struct Light *light;
+};
+static struct Sprites {
+	struct Lights {
+		size_t size, budget_size;
+		struct Light {
+			struct Sprite *sprite;
+			struct Colour3f colour;
+			unsigned expires;
+			float score;
+		} light_table[MAX_LOGICAL_LIGHTS];
+		unsigned short budget[MAX_LOGICAL_LIGHTS];
+		struct Vec2f x_table[MAX_LIGHTS];
+		struct Colour3f colour_table[MAX_LIGHTS];
+	} lights;
+} the_sprites, *sprites = &the_sprites;
+
+/* Everything is on the screen and never expires, so the score is just the
+ brightest channel. */
+static unsigned TimerGetGameTime(void) { return 1000; }
+static void DrawGetScreen(struct Rectangle4f *const rect) {
+	rect->x_min = rect->y_min = -100.0f, rect->x_max = rect->y_max = 100.0f;
+}
+
+#include "../src/game/SpritesLight.h"
+
+#define LIGHTS (1000)
+
+static struct Sprite lit[LIGHTS], extra[MAX_LOGICAL_LIGHTS + 2];
+
+/** Budgets {size} lights with brightness {bright(i, size)}.
+ @return Whether the best {MAX_LIGHTS} were picked. */
+static int budget(const char *const title,
+	float (*const bright)(const size_t, const size_t), const size_t size) {
+	const struct Lights *const lights = &sprites->lights;
+	float worst_in = 1e9f, best_out = -1.0f, b;
+	size_t i;
+	int is_in[LIGHTS] = { 0 }, is_good;
+	SpritesLightClear();
+	assert(size <= LIGHTS);
+	for(i = 0; i < size; i++) {
+		b = bright(i, size);
+		lit[i].x.x = lit[i].x.y = 0.0f, lit[i].light = 0;
+		Light(lit + i, b, b * 0.5f, 0.0f, 0);
+	}
+	SpritesLightPositions();
+	for(i = 0; i < lights->budget_size; i++) is_in[lights->budget[i]] = 1;
+	for(i = 0; i < lights->size; i++) {
+		b = lights->light_table[i].colour.r;
+		if(is_in[i]) { if(b < worst_in) worst_in = b; }
+		else if(b > best_out) best_out = b;
+	}
+	is_good = SpritesLightGetSize() == MAX_LIGHTS && worst_in >= best_out;
+	printf("%s, %lu: %lu picked, worst in %.1f, best out %.1f, %s.\n",
+		title, (unsigned long)size, (unsigned long)SpritesLightGetSize(),
+		worst_in, best_out, is_good ? "good" : "WRONG");
+	return is_good;
+}
+
+/** Fills the table and adds two more before the next budget.
+ @return Whether the first of them kept it's light through the second. */
+static int full(void) {
+	size_t i;
+	int is_good;
+	SpritesLightClear();
+	for(i = 0; i < MAX_LOGICAL_LIGHTS; i++) {
+		extra[i].x.x = extra[i].x.y = 0.0f, extra[i].light = 0;
+		Light(extra + i, 1.0f + (float)i, 0.0f, 0.0f, 0);
+	}
+	SpritesLightPositions();
+	for(i = MAX_LOGICAL_LIGHTS; i < MAX_LOGICAL_LIGHTS + 2; i++) {
+		extra[i].x.x = extra[i].x.y = 0.0f, extra[i].light = 0;
+		Light(extra + i, 1.0f, 0.0f, 0.0f, 0);
+	}
+	is_good = extra[MAX_LOGICAL_LIGHTS].light
+		&& extra[MAX_LOGICAL_LIGHTS + 1].light
+		&& SpritesLightGetSize() <= MAX_LIGHTS;
+	printf("full, two more: the first %s, the second %s, %s.\n",
+		extra[MAX_LOGICAL_LIGHTS].light ? "lit" : "unlit",
+		extra[MAX_LOGICAL_LIGHTS + 1].light ? "lit" : "unlit",
+		is_good ? "good" : "WRONG");
+	return is_good;
+}
+
+static float descending(const size_t i, const size_t size)
+	{ return (float)(size - i); }
+static float ascending(const size_t i, const size_t size)
+	{ (void)size; return (float)(i + 1); }
+static float same(const size_t i, const size_t size)
+	{ (void)i, (void)size; return 1.0f; }
+static float few(const size_t i, const size_t size)
+	{ (void)size; return (float)(i % 3 + 1); }
+static float scrambled(const size_t i, const size_t size)
+	{ return (float)((i * 379) % size + 1); }
+/* Already sorted, with ties, like they come out of the last budget. */
+static float steps(const size_t i, const size_t size)
+	{ return (float)((size - i) / 3); }
+
+int main(void) {
+	int is_pass = 1;
+	/* Just over; the select used to get stuck on the last two. */
+	if(!budget("descending", &descending, MAX_LIGHTS + 1)
+		|| !budget("descending", &descending, MAX_LIGHTS + 2)
+		|| !budget("descending", &descending, LIGHTS)
+		|| !budget("steps", &steps, MAX_LIGHTS + 2)
+		|| !budget("steps", &steps, LIGHTS)
+		|| !budget("ascending", &ascending, LIGHTS)
+		|| !budget("same", &same, LIGHTS)
+		|| !budget("few", &few, LIGHTS)
+		|| !budget("scrambled", &scrambled, MAX_LIGHTS + 1)
+		|| !budget("scrambled", &scrambled, LIGHTS)
+		/* A new light used to be the weakest, so the next one took it. */
+		|| !full()) is_pass = 0;
+	printf("%s.\n", is_pass ? "pass" : "FAIL");
+	return is_pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
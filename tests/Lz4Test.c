@@ -0,0 +1,62 @@
+/* Tests {Lz4} both ways; compile with
+ {gcc -ansi -pedantic -Wall -o Lz4Test Lz4Test.c ../src/general/Lz4.c}. */
+
+#include <stdlib.h> /* EXIT_ malloc free */
+#include <stdio.h>  /* printf */
+#include <string.h> /* memcmp memset */
+#include "../src/general/Lz4.h"
+
+#define SIZE (300000)
+
+static unsigned char original[SIZE], compressed[SIZE + SIZE / 255 + 16],
+	expanded[SIZE];
+
+/** Compresses and expands {size} of {original}.
+ @return Whether it came back the same. */
+static int round_trip(const char *const title, const size_t size) {
+	size_t c;
+	int is_same;
+	memset(expanded, 0xcd, sizeof expanded);
+	c = Lz4Compress(original, size, compressed, sizeof compressed);
+	is_same = (c || !size) && Lz4Decompress(compressed, c, expanded, size)
+		&& !memcmp(original, expanded, size);
+	printf("%s: %lu to %lu, %s.\n", title, (unsigned long)size,
+		(unsigned long)c, is_same ? "same" : "DIFFERENT");
+	return is_same;
+}
+
+int main(void) {
+	unsigned long r = 1;
+	size_t i, c;
+	int is_pass = 1;
+
+	/* Empty and too small for a match. */
+	if(!round_trip("empty", 0) || !round_trip("short", 12)) is_pass = 0;
+
+	/* Like an image with transparency: runs of zero and repeated rows. */
+	for(i = 0; i < SIZE; i++)
+		original[i] = (i / 4) % 64 < 20 ? 0 : (unsigned char)((i % 1024) * 7);
+	if(!round_trip("image", SIZE)) is_pass = 0;
+
+	/* Noise; it mostly doesn't compress, but it has to fit the bound. */
+	for(i = 0; i < SIZE; i++)
+		r = r * 1103515245ul + 12345ul, original[i] = (unsigned char)(r >> 16);
+	if(!round_trip("noise", SIZE)) is_pass = 0;
+
+	/* Long runs need the extra length bytes. */
+	memset(original, 'a', SIZE);
+	if(!round_trip("run", SIZE)) is_pass = 0;
+
+	/* Corrupt or short input is refused without going out of bounds. */
+	c = Lz4Compress(original, SIZE, compressed, sizeof compressed);
+	if(Lz4Decompress(compressed, c - 1, expanded, SIZE)
+		|| Lz4Decompress(compressed, c, expanded, SIZE - 1)) is_pass = 0;
+	compressed[1] = compressed[2] = 0xff;
+	if(Lz4Decompress(compressed, c, expanded, SIZE)) is_pass = 0;
+
+	/* Too little room to compress into. */
+	if(Lz4Compress(original, SIZE, compressed, SIZE)) is_pass = 0;
+
+	printf("%s.\n", is_pass ? "pass" : "FAIL");
+	return is_pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
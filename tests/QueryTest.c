@@ -0,0 +1,307 @@
+/* Tests the queries of {SpritesQuery.h}: the cone with half-angles either
+ side of {\pi/2}, and nearest and within against looking at every sprite, on
+ a layer with more than one ring; compile with
+ {gcc -std=c99 -pedantic -Wall -o QueryTest QueryTest.c ../src/general/Random.c -lm}. */
+
+#include <stdlib.h> /* EXIT_ */
+#include <stdio.h>  /* printf */
+#include <assert.h> /* assert */
+#include <math.h>   /* cosf sinf */
+#include "../src/Ortho.h"
+
+/* As in {Sprites.c}, but smaller, and the {Layer} is a stand-in that works
+ like {Layer.c}. The origin is in the middle of the middle bin. */
+#define LAYER_SIDE_SIZE (9)
+#define LAYER_SIZE (LAYER_SIDE_SIZE * LAYER_SIDE_SIZE)
+static const float layer_space = 256.0f;
+enum SpriteClass { SC_SHIP, SC_DEBRIS };
+struct SpriteVt { enum SpriteClass class; };
+struct Sprite { const struct SpriteVt *vt; struct Ortho3f x; };
+struct SpriteList { struct Sprite *data; size_t size; };
+static struct Sprites {
+	struct Bin { struct SpriteList sprites; } bins[LAYER_SIZE];
+	void *layer;
+} the_sprites, *sprites = &the_sprites;
+static void SpriteListBiForEach(struct SpriteList *const list,
+	void (*const action)(struct Sprite *const, void *const),
+	void *const param) {
+	size_t i;
+	for(i = 0; i < list->size; i++) action(list->data + i, param);
+}
+/* The furthest ring that {SpritesNearest} asked for. */
+static unsigned deepest_ring;
+/** @return The bin of {x} on one axis, clipped. */
+static int bin_axis(const float x) {
+	int b = (int)floorf((x + LAYER_SIDE_SIZE * layer_space / 2.0f)
+		/ layer_space);
+	return b < 0 ? 0 : b >= LAYER_SIDE_SIZE ? LAYER_SIDE_SIZE - 1 : b;
+}
+struct Query;
+typedef void (*LayerAcceptQuery)(const unsigned, struct Query *const);
+static int LayerForEachRingQuery(const void *const layer,
+	const struct Vec2f *const x, const unsigned ring,
+	const LayerAcceptQuery accept, struct Query *const query) {
+	const int cx = bin_axis(x->x), cy = bin_axis(x->y), n = (int)ring;
+	int i, j, is_any = 0;
+	(void)layer;
+	if(ring > deepest_ring) deepest_ring = ring;
+	for(j = cy - n; j <= cy + n; j++) {
+		if(j < 0 || j >= LAYER_SIDE_SIZE) continue;
+		for(i = cx - n; i <= cx + n; i++) {
+			if(i < 0 || i >= LAYER_SIDE_SIZE) continue;
+			/* Chebyshev distance {n} exactly. */
+			if(j != cy - n && j != cy + n && i != cx - n && i != cx + n)
+				continue;
+			accept((unsigned)(j * LAYER_SIDE_SIZE + i), query), is_any = 1;
+		}
+	}
+	return is_any;
+}
+static void LayerForEachRectangleQuery(const void *const layer,
+	const struct Rectangle4f *const rect, const LayerAcceptQuery accept,
+	struct Query *const query) {
+	int i, j;
+	(void)layer;
+	for(j = bin_axis(rect->y_min); j <= bin_axis(rect->y_max); j++)
+		for(i = bin_axis(rect->x_min); i <= bin_axis(rect->x_max); i++)
+			accept((unsigned)(j * LAYER_SIDE_SIZE + i), query);
+}
+
+#include "../src/game/SpritesQuery.h"
+
+/* Around the origin every 10 degrees, starting at 5, so none are on an edge
+ of a cone that's a whole number of 10 degrees. */
+#define AROUND (36)
+/* Scattered over the layer, sorted into the bins. */
+#define SCATTER (400)
+#define MIDDLE (LAYER_SIZE / 2)
+
+static const struct SpriteVt ship_vt = { SC_SHIP }, debris_vt = { SC_DEBRIS };
+static struct Sprite around[AROUND], scatter[SCATTER];
+static const float degree = M_PI_F / 180.0f;
+
+/** Empties every bin. */
+static void bins_clear(void) {
+	size_t b;
+	for(b = 0; b < LAYER_SIZE; b++)
+		sprites->bins[b].sprites.data = 0, sprites->bins[b].sprites.size = 0;
+}
+
+/** Puts {size} sprites at {x}, {y} into {scatter}, grouped by bin in the
+ order given, and points the bins at them. */
+static void bins_put(const float (*const xy)[2], const size_t size) {
+	size_t b, i, n = 0;
+	assert(size <= SCATTER);
+	bins_clear();
+	for(b = 0; b < LAYER_SIZE; b++) {
+		sprites->bins[b].sprites.data = scatter + n;
+		for(i = 0; i < size; i++) {
+			if((size_t)(bin_axis(xy[i][1]) * LAYER_SIDE_SIZE
+				+ bin_axis(xy[i][0])) != b) continue;
+			scatter[n].vt = i % 5 ? &ship_vt : &debris_vt;
+			scatter[n].x.x = xy[i][0], scatter[n].x.y = xy[i][1];
+			scatter[n].x.theta = 0.0f;
+			n++, sprites->bins[b].sprites.size++;
+		}
+	}
+	assert(n == size);
+}
+
+/** @return The square of the distance from {x} to {s}. */
+static float dist2(const struct Vec2f *const x, const struct Sprite *const s) {
+	const float dx = s->x.x - x->x, dy = s->x.y - x->y;
+	return dx * dx + dy * dy;
+}
+
+/** @return Whether {s} should be found from {x}. */
+static int is_match(const struct Vec2f *const x, const float radius,
+	const unsigned classes, const struct Sprite *const except,
+	const struct Sprite *const s) {
+	return s != except && (classes & (1u << s->vt->class))
+		&& dist2(x, s) <= radius * radius;
+}
+
+/** Looks in a cone facing {facing} degrees, {half} degrees either side.
+ @return Whether exactly the ones within {half} degrees were found. */
+static int cone(const int facing, const int half) {
+	struct Sprite *result[AROUND];
+	struct Ortho3f x;
+	size_t size, i, expect = 0;
+	int is_in[AROUND] = { 0 }, is_good = 1, a;
+	x.x = x.y = 0.0f, x.theta = facing * degree;
+	size = SpritesCone(&x, 200.0f, half * degree, ~0u, 0, result, AROUND);
+	for(i = 0; i < size; i++) is_in[result[i] - around] = 1;
+	for(i = 0; i < AROUND; i++) {
+		/* How far around from {facing}, {[0, 180]}. */
+		a = ((int)(5 + 10 * i) - facing) % 360;
+		if(a < 0) a += 360;
+		if(a > 180) a = 360 - a;
+		if(a <= half) expect++;
+		if((a <= half) != is_in[i]) is_good = 0;
+	}
+	printf("facing %d, half-angle %d: %lu found, %lu expected, %s.\n", facing,
+		half, (unsigned long)size, (unsigned long)expect,
+		is_good ? "good" : "WRONG");
+	return is_good;
+}
+
+/** Compares \see{SpritesNearest} with looking at all of {scatter}.
+ @return Whether it found the {k} nearest, nearest first. */
+static int nearest(const struct Vec2f *const x, const float radius,
+	const unsigned classes, const struct Sprite *const except, const size_t k,
+	const size_t scatter_size) {
+	struct Sprite *result[QUERY_MAX];
+	float last = -1.0f, d2, kth;
+	size_t size, i, expect = 0, closer = 0;
+	int is_good = 1;
+	assert(k <= QUERY_MAX);
+	size = SpritesNearest(x, radius, classes, except, result, k);
+	/* Sorted, and all of them match. */
+	for(i = 0; i < size; i++) {
+		d2 = dist2(x, result[i]);
+		if(d2 < last || !is_match(x, radius, classes, except, result[i]))
+			is_good = 0;
+		last = d2;
+	}
+	/* As many as there are, up to {k}, and none that aren't found are
+	 closer than the furthest found. */
+	for(i = 0; i < scatter_size; i++)
+		if(is_match(x, radius, classes, except, scatter + i)) expect++;
+	if(expect > k) expect = k;
+	kth = size ? dist2(x, result[size - 1]) : 0.0f;
+	for(i = 0; i < scatter_size; i++) {
+		size_t j;
+		if(!is_match(x, radius, classes, except, scatter + i)) continue;
+		for(j = 0; j < size && result[j] != scatter + i; j++);
+		if(j == size && dist2(x, scatter + i) < kth) closer++;
+	}
+	if(size != expect || closer) is_good = 0;
+	if(!is_good) printf("nearest (%.0f, %.0f), r %.0f, k %lu: %lu found, %lu "
+		"expected, %lu closer missed, WRONG.\n", x->x, x->y, radius,
+		(unsigned long)k, (unsigned long)size, (unsigned long)expect,
+		(unsigned long)closer);
+	return is_good;
+}
+
+/** Compares \see{SpritesWithin} with looking at all of {scatter}.
+ @return Whether it found exactly the ones within. */
+static int within(const struct Vec2f *const x, const float radius,
+	const unsigned classes, const struct Sprite *const except,
+	const size_t scatter_size) {
+	struct Sprite *result[SCATTER];
+	int is_in[SCATTER] = { 0 }, is_good = 1;
+	size_t size, i, expect = 0;
+	size = SpritesWithin(x, radius, classes, except, result, SCATTER);
+	for(i = 0; i < size; i++) {
+		if(is_in[result[i] - scatter]) is_good = 0;
+		is_in[result[i] - scatter] = 1;
+	}
+	for(i = 0; i < scatter_size; i++) {
+		const int is = is_match(x, radius, classes, except, scatter + i);
+		if(is) expect++;
+		if(is != is_in[i]) is_good = 0;
+	}
+	if(!is_good) printf("within (%.0f, %.0f), r %.0f: %lu found, %lu "
+		"expected, WRONG.\n", x->x, x->y, radius, (unsigned long)size,
+		(unsigned long)expect);
+	return is_good;
+}
+
+/** Three sprites close by in ring zero, in the bin in the order furthest
+ first, so the sorted insert has to move them; two more in ring one and one in
+ ring two. It should stop after ring one.
+ @return Whether it found the three in order, and didn't go to ring two. */
+static int nearest_stops(void) {
+	const float xy[][2] = { { 50.0f, 0.0f }, { 40.0f, 0.0f }, { 0.0f, 30.0f },
+		{ -20.0f, 0.0f }, { 10.0f, 0.0f }, { 200.0f, 0.0f },
+		{ 0.0f, -210.0f }, { 500.0f, 0.0f } };
+	const size_t size = sizeof xy / sizeof *xy;
+	struct Sprite *result[3];
+	struct Vec2f x;
+	size_t found;
+	int is_good;
+	bins_put(xy, size);
+	x.x = x.y = 0.0f, deepest_ring = 0;
+	found = SpritesNearest(&x, 1000.0f, ~0u, 0, result, 3);
+	is_good = found == 3 && dist2(&x, result[0]) == 100.0f
+		&& dist2(&x, result[1]) == 400.0f && dist2(&x, result[2]) == 900.0f
+		&& deepest_ring == 1;
+	printf("nearest, three in ring zero: %lu found, to ring %u, %s.\n",
+		(unsigned long)found, deepest_ring, is_good ? "good" : "WRONG");
+	return is_good;
+}
+
+/** One in ring zero, two in ring one, the third nearer than the one in ring
+ two; the third is too far to stop at ring one.
+ @return Whether it found the one, the two, and went to ring two. */
+static int nearest_goes_on(void) {
+	const float xy[][2] = { { 10.0f, 0.0f }, { 300.0f, 0.0f },
+		{ 370.0f, 100.0f }, { 390.0f, 0.0f }, { 0.0f, 900.0f } };
+	const size_t size = sizeof xy / sizeof *xy;
+	struct Sprite *result[3];
+	struct Vec2f x;
+	size_t found;
+	int is_good;
+	bins_put(xy, size);
+	x.x = x.y = 0.0f, deepest_ring = 0;
+	found = SpritesNearest(&x, 2000.0f, ~0u, 0, result, 3);
+	is_good = found == 3 && result[0]->x.x == 10.0f
+		&& result[1]->x.x == 300.0f && result[2]->x.x == 370.0f
+		&& deepest_ring == 2;
+	printf("nearest, third in ring one, further than ring one: %lu found, to "
+		"ring %u, %s.\n", (unsigned long)found, deepest_ring,
+		is_good ? "good" : "WRONG");
+	return is_good;
+}
+
+int main(void) {
+	const int halves[] = { 0, 30, 80, 90, 100, 120, 150, 170, 180, 200 };
+	const int facings[] = { 0, 90, 217 };
+	const size_t ks[] = { 1, 3, 8, QUERY_MAX };
+	const float radii[] = { 100.0f, 300.0f, 700.0f, 5000.0f };
+	static float xy[SCATTER][2];
+	struct Random r;
+	size_t i, j, n, bad = 0, tries = 0;
+	int is_pass = 1;
+	for(i = 0; i < AROUND; i++) {
+		around[i].vt = &ship_vt;
+		around[i].x.x = 100.0f * cosf((float)(5 + 10 * i) * degree);
+		around[i].x.y = 100.0f * sinf((float)(5 + 10 * i) * degree);
+		around[i].x.theta = 0.0f;
+	}
+	bins_clear();
+	sprites->bins[MIDDLE].sprites.data = around;
+	sprites->bins[MIDDLE].sprites.size = AROUND;
+	/* Over {\pi/2}, it used to be the whole circle. */
+	for(i = 0; i < sizeof facings / sizeof *facings; i++)
+		for(j = 0; j < sizeof halves / sizeof *halves; j++)
+			if(!cone(facings[i], halves[j])) is_pass = 0;
+	/* Nearest stopping early, and not. */
+	if(!nearest_stops() || !nearest_goes_on()) is_pass = 0;
+	/* All over the layer, which is {[-1152, 1152]}, from points in and out of
+	 the middle, against looking at all of them. */
+	RandomSeed(&r, 42);
+	for(i = 0; i < SCATTER; i++)
+		xy[i][0] = random_pm_max(&r, 1100.0f),
+		xy[i][1] = random_pm_max(&r, 1100.0f);
+	bins_put((const float (*)[2])xy, SCATTER);
+	for(n = 0; n < 60; n++) {
+		struct Vec2f x;
+		const struct Sprite *const except = scatter + n * 7 % SCATTER;
+		x.x = random_pm_max(&r, 1200.0f), x.y = random_pm_max(&r, 1200.0f);
+		for(i = 0; i < sizeof radii / sizeof *radii; i++) {
+			for(j = 0; j < sizeof ks / sizeof *ks; j++, tries++)
+				if(!nearest(&x, radii[i], ~0u, except, ks[j], SCATTER)
+					|| !nearest(&x, radii[i], 1u << SC_SHIP, 0, ks[j],
+					SCATTER)) bad++;
+			if(!within(&x, radii[i], ~0u, except, SCATTER)
+				|| !within(&x, radii[i], 1u << SC_DEBRIS, 0, SCATTER)) bad++;
+			tries++;
+		}
+	}
+	printf("nearest and within, scattered: %lu of %lu wrong.\n",
+		(unsigned long)bad, (unsigned long)tries);
+	if(bad) is_pass = 0;
+	printf("%s.\n", is_pass ? "pass" : "FAIL");
+	return is_pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
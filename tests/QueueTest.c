@@ -0,0 +1,79 @@
+/* Tests {Queue} headless, counting what would be drawn; compile with
+ {gcc -ansi -pedantic -Wall -o QueueTest QueueTest.c ../src/general/Queue.c}. */
+
+#include <stdlib.h> /* EXIT_ */
+#include <stdio.h>  /* printf */
+#include "../src/general/Queue.h"
+
+#define PUSHES (3000)
+
+static unsigned long last_key;
+static unsigned last_data, batches, batched, order_errors;
+static int is_first;
+
+/* @implements QueueBatch */
+static void batch(const struct QueueCommand *const commands,
+	const size_t size) {
+	size_t i;
+	batches++, batched += (unsigned)size;
+	for(i = 0; i < size; i++) {
+		const struct QueueCommand *const c = commands + i;
+		if(QueueGetTexture(c) != QueueGetTexture(commands)
+			|| QueueGetNormal(c) != QueueGetNormal(commands)
+			|| QueueGetShader(c) != QueueGetShader(commands)) order_errors++;
+		/* Sorted on key, and in the order pushed when the keys are equal. */
+		if(!is_first && (c->key < last_key
+			|| (c->key == last_key && c->data < last_data))) order_errors++;
+		is_first = 0, last_key = c->key, last_data = c->data;
+	}
+}
+
+int main(void) {
+	struct QueueStats stats;
+	unsigned i;
+	int is_pass = 1;
+
+	/* Interleaved like classes in bins: three passes with one shader each,
+	 ten textures shared by all of them. */
+	for(i = 0; i < PUSHES; i++)
+		if(!QueuePush(i % 3, i % 3, (i * 7) % 10, 0, i)) is_pass = 0;
+	if(QueueGetSize() != PUSHES) is_pass = 0;
+	QueueSubmit(0, 0, &stats);
+	printf("headless: %u commands, %u shaders, %u textures, %u batches.\n",
+		stats.commands, stats.shaders, stats.textures, stats.batches);
+	if(stats.commands != PUSHES || stats.shaders != 3 || stats.textures != 30
+		|| stats.batches != 30 || QueueGetSize()) is_pass = 0;
+
+	/* Within a texture, they stay in the order pushed. */
+	for(i = 0; i < PUSHES; i++)
+		QueuePush(1, 2, i % 4, 0, i);
+	is_first = 1, batches = batched = order_errors = 0;
+	QueueSubmit(0, &batch, &stats);
+	printf("batched: %u in %u batches, %u out of order.\n", batched, batches,
+		order_errors);
+	if(batched != PUSHES || batches != 4 || stats.batches != 4
+		|| stats.shaders != 1 || order_errors) is_pass = 0;
+
+	/* The same texture with different normals is different batches. */
+	for(i = 0; i < PUSHES; i++)
+		QueuePush(1, 2, 5, i % 2 ? 7 : 3, i);
+	is_first = 1, batches = batched = order_errors = 0;
+	QueueSubmit(0, &batch, &stats);
+	printf("normals: %u in %u batches, %u textures, %u out of order.\n",
+		batched, batches, stats.textures, order_errors);
+	if(batched != PUSHES || batches != 2 || stats.textures != 2
+		|| order_errors) is_pass = 0;
+
+	/* Out of range is refused. */
+	if(QueuePush(1u << QUEUE_PASS_BITS, 0, 0, 0, 0)
+		|| QueuePush(0, 0, 1u << QUEUE_TEXTURE_BITS, 0, 0)
+		|| QueuePush(0, 0, 0, 1u << QUEUE_NORMAL_BITS, 0)) is_pass = 0;
+
+	/* Empty is nothing. */
+	QueueSubmit(0, &batch, &stats);
+	if(stats.commands || stats.batches) is_pass = 0;
+
+	Queue_();
+	printf("%s.\n", is_pass ? "pass" : "FAIL");
+	return is_pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
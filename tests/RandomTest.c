@@ -0,0 +1,65 @@
+/* Tests {Random}; compile with
+ {gcc -ansi -pedantic -Wall -o RandomTest RandomTest.c ../src/general/Random.c -lm}. */
+
+#include <stdlib.h> /* EXIT_ */
+#include <stdio.h>  /* printf */
+#include <math.h>   /* fabs */
+#include "../src/general/Random.h"
+
+#define SAMPLES (100000)
+
+static float samples[SAMPLES];
+
+int main(void) {
+	struct Random a, b, c;
+	double mean, var;
+	unsigned long x;
+	size_t i;
+	int is_pass = 1;
+
+	/* Same seed, same numbers; split streams are different. */
+	RandomSeed(&a, 42), RandomSeed(&b, 42);
+	RandomSplit(&c, &b);
+	for(i = 0; i < 1000; i++) {
+		if((x = RandomNext(&a)) != RandomNext(&b)) continue;
+		if(x == RandomNext(&c)) { printf("split overlaps at %lu.\n",
+			(unsigned long)i); is_pass = 0; break; }
+	}
+	RandomSeed(&a, 42), RandomSeed(&b, 42);
+	for(i = 0; i < 1000; i++) if(RandomNext(&a) != RandomNext(&b))
+		{ printf("seed is not reproducible at %lu.\n", (unsigned long)i);
+		is_pass = 0; break; }
+
+	/* Batch and one-at-a-time are the same stream. */
+	RandomSeed(&a, 7), RandomSeed(&b, 7);
+	RandomUniformFloats(&a, samples, SAMPLES, 3.0f);
+	for(i = 0; i < SAMPLES; i++) if(samples[i] != RandomUniformFloat(&b, 3.0f))
+		{ printf("batch differs at %lu.\n", (unsigned long)i);
+		is_pass = 0; break; }
+	for(mean = 0.0, i = 0; i < SAMPLES; i++) {
+		if(samples[i] < -3.0f || samples[i] >= 3.0f)
+			{ printf("uniform %f out of range.\n", samples[i]); is_pass = 0; }
+		mean += samples[i];
+	}
+	mean /= SAMPLES;
+	printf("uniform [-3, 3): mean %f.\n", mean);
+	if(fabs(mean) > 0.05) is_pass = 0;
+
+	RandomGaussFloats(&a, samples, SAMPLES, 2.0f);
+	for(mean = 0.0, i = 0; i < SAMPLES; i++) mean += samples[i];
+	mean /= SAMPLES;
+	for(var = 0.0, i = 0; i < SAMPLES; i++)
+		var += (samples[i] - mean) * (samples[i] - mean);
+	var /= SAMPLES - 1;
+	printf("gauss sigma 2: mean %f, sigma %f.\n", mean, sqrt(var));
+	if(fabs(mean) > 0.05 || fabs(sqrt(var) - 2.0) > 0.05) is_pass = 0;
+
+	for(i = 0; i < 1000; i++) {
+		const int n = RandomUniformInt(&a, 10);
+		if(n < 0 || n >= 10) { printf("int %d out of range.\n", n);
+			is_pass = 0; break; }
+	}
+
+	printf("%s.\n", is_pass ? "pass" : "FAIL");
+	return is_pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,57 @@
+/* Tests {Workers}; compile with
+ {gcc -ansi -pedantic -Wall -o WorkersTest WorkersTest.c ../src/general/Workers.c
+ ../src/general/Trace.c -lpthread}. */
+
+#include <stdlib.h> /* EXIT_ */
+#include <stdio.h>  /* printf */
+#include "../src/general/Workers.h"
+
+#define JOBS (1000)
+
+static unsigned long sums[JOBS];
+static unsigned given[JOBS];
+
+/* Something to keep it busy; the odd ones fail.
+ @implements WorkersWork */
+static int work(const size_t index) {
+	unsigned long s = 0, i;
+	for(i = 0; i < 10000ul * (index % 7 + 1); i++) s += i ^ index;
+	sums[index] = s;
+	return !(index & 1);
+}
+
+int main(void) {
+	size_t index, returned = 0;
+	unsigned threads, bad = 0, i;
+	unsigned long s, j;
+	int is_done, is_pass = 1;
+
+	threads = WorkersBegin(JOBS, &work);
+	while(WorkersNext(&index, &is_done)) {
+		if(index >= JOBS || given[index]++ || is_done != !(index & 1)) bad++;
+		returned++;
+	}
+	WorkersEnd();
+	for(i = 0; i < JOBS; i++) {
+		for(s = 0, j = 0; j < 10000ul * (i % 7 + 1); j++) s += j ^ i;
+		if(sums[i] != s || given[i] != 1) bad++;
+	}
+	printf("%u threads: %lu jobs returned, %u wrong.\n", threads,
+		(unsigned long)returned, bad);
+	if(returned != JOBS || bad) is_pass = 0;
+
+	/* Nothing to do; and done again after. */
+	if(WorkersBegin(0, &work) || WorkersNext(&index, &is_done)) is_pass = 0;
+	WorkersBegin(3, &work);
+	for(returned = 0; WorkersNext(&index, &is_done); returned++);
+	WorkersEnd();
+	if(returned != 3) is_pass = 0;
+
+	/* Ending early waits for what's started and skips the rest. */
+	WorkersBegin(JOBS, &work);
+	WorkersNext(&index, &is_done);
+	WorkersEnd();
+
+	printf("%s.\n", is_pass ? "pass" : "FAIL");
+	return is_pass ? EXIT_SUCCESS : EXIT_FAILURE;
+}
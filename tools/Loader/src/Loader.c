@@ -15,6 +15,8 @@
 /* include code to load images for dimensions */
 #include "../../../external/lodepng.h"
 #include "../../../external/nanojpeg.h"
+/* images are compressed for Void to decompress */
+#include "../../../src/general/Lz4.h"
 
 #define SUFFIX
 #define STRCOPY
@@ -46,6 +48,8 @@ static void usage(const char *argvz);
 static int new_image(const char *const fn);
 static void sort(void);
 static int include_images(void);
+static int pack_atlas(const char *const dir, const char *const fn);
+static int image_header(char *const fn, const int is_lz4);
 static int print_images(const char *const dir);
 static int string_image_comp(const char **key_ptr, const struct ImageName *elem);
 
@@ -54,6 +58,10 @@ static int string_image_comp(const char **key_ptr, const struct ImageName *elem)
 static const int image_names_size = sizeof(image_names) / sizeof(char *);*/
 static struct ImageName {
 	char name[1024];
+	/* Where it is in the atlas, if {is_atlas}; \see{pack_atlas}. */
+	int is_atlas;
+	unsigned x, y, width, height;
+	unsigned char *pixels;
 } *image_names;
 static const size_t max_image_names_name = sizeof((struct ImageName *)0)->name / sizeof(char);
 static size_t no_image_names, image_names_capacity;
@@ -63,7 +71,7 @@ static int is_sorted = -1;
 static const char *programme   = "Loader";
 static const char *year        = "2015";
 static const int versionMajor  = 1;
-static const int versionMinor  = 0;
+static const int versionMinor  = 1;
 
 static const char *ext_type    = ".type";
 static const char *ext_lore    = ".lore";
@@ -72,6 +80,19 @@ static const char *ext_png_h   = ".png";
 static const char *ext_jpeg_h  = ".jpeg";
 static const char *ext_bmp_h   = ".bmp";
 
+/* Images that are no bigger than this are packed into the atlas, which is
+ this wide, and as high as it needs to be up to the maximum. */
+static const unsigned atlas_max_side   = 512;
+static const unsigned atlas_width      = 1024;
+static const unsigned atlas_max_height = 2048;
+/* Pixels of the edge repeated around each image so filtering doesn't bleed. */
+static const unsigned atlas_gutter     = 1;
+
+static struct Atlas {
+	const char *fn, *name;
+	unsigned width, height;
+} atlas;
+
 typedef int (*Compare)(const void *, const void *);
 
 /** If you add an image, the position probably won't be valid, so to this after
@@ -94,13 +115,19 @@ int LoaderImagePosition(const char *const str) {
 int main(int argc, char **argv) {
 	char *types_dir = 0, *lores_dir = 0; /* can have '/' or not! */
 
-	/* check that the user specified dir or two */
-	if(argc <= 1 || argc >= 4 || *argv[1] == '-') {
+	/* one image, decoded into a header */
+	if(argc == 3 && (!strcmp(argv[1], "-r") || !strcmp(argv[1], "-z")))
+		return image_header(argv[2], argv[1][1] == 'z')
+		? EXIT_SUCCESS : EXIT_FAILURE;
+
+	/* check that the user specified dir or two, and maybe the atlas */
+	if(argc <= 1 || argc >= 5 || *argv[1] == '-') {
 		usage(argv[0]);
 		return EXIT_FAILURE;
 	}
 	types_dir = argv[1];
-	if(argc == 3) lores_dir = argv[2];
+	if(argc >= 3) lores_dir = argv[2];
+	if(argc == 4) atlas.fn = argv[3];
 
 	/* load the types, whatever comes next */
 	if(!read_directory(types_dir, &Record, ext_type)) {
@@ -114,16 +141,20 @@ int main(int argc, char **argv) {
 			   types_dir, types_dir[strlen(argv[1]) - 1] != '/' ? "/" : "",
 			   programme, versionMajor, versionMinor, year);
 		printf("#include <stddef.h> /* size_t */\n\n");
-		printf("enum ImageFormat { IF_UNKNOWN, IF_PNG, IF_JPEG };\n\n");
+		printf("enum ImageFormat { IF_UNKNOWN, IF_RAW, IF_LZ4 };\n\n");
 		printf("/* image is a base datatype; it's not in c; we need this */\n");
 		printf("struct AutoImage {\n");
 		printf("\tconst char *name;\n");
+		printf("\t/* {width * height * depth} bytes, bottom row first, from \"Loader -r\"\n");
+		printf("\t or LZ4-compressed from \"Loader -z\" */\n");
 		printf("\tconst enum ImageFormat data_format;\n");
 		printf("\tconst size_t           data_size;\n");
 		printf("\tconst unsigned char    *data;\n");
 		printf("\tconst unsigned         width;\n");
 		printf("\tconst unsigned         height;\n");
 		printf("\tconst unsigned         depth;\n");
+		printf("\t/* s, t, width, height in \"Atlas.png\"; zero size if it's not */\n");
+		printf("\tconst float            atlas[4];\n");
 		printf("\tunsigned               texture;\n");
 		printf("};\n\n");
 
@@ -150,6 +181,10 @@ int main(int argc, char **argv) {
 	   || !read_directory(lores_dir, &new_image, ext_bmp_h))
 		{ main_(); return EXIT_FAILURE; }
 
+	/* pack the small images into an atlas, which is then an image itself */
+	if(atlas.fn && !pack_atlas(lores_dir, atlas.fn))
+		{ main_(); return EXIT_FAILURE; }
+
 	printf("/** auto-generated from %s%s by %s %d.%d %s */\n\n",
 	       lores_dir, lores_dir[strlen(argv[2]) - 1] != '/' ? "/" : "",
 	       programme, versionMajor, versionMinor, year);
@@ -219,8 +254,10 @@ int main(int argc, char **argv) {
 }
 
 static void main_(void) {
+	size_t i;
 	Lore_();
 	Record_();
+	for(i = 0; i < no_image_names; i++) free(image_names[i].pixels);
 	free(image_names);
 }
 
@@ -253,9 +290,12 @@ static int read_directory(const char *const directory, int (*exec)(const char *c
 }
 
 static void usage(const char *argvz) {
-	fprintf(stderr, "Usage: %s <types directory> [<resources directory>]\n", argvz);
+	fprintf(stderr, "Usage: %s <types directory> [<resources directory> [<atlas.png>]]\n", argvz);
 	fprintf(stderr, "This is a crude static database that preprocesses all the media files and\n");
 	fprintf(stderr, "turns them into C header files for inclusion in Void. If <resources\ndirectory> is specified, it outputs resources, otherwise, types.\n");
+	fprintf(stderr, "If <atlas.png> is specified, the small png images are also packed into\nit, and it is another image.\n");
+	fprintf(stderr, "Or: %s -r|-z <image.png|image.jpeg>\n", argvz);
+	fprintf(stderr, "Decodes the image into a header ready to be a texture, bottom row first;\n-z compresses it with LZ4.\n");
 	fprintf(stderr, "Version %d.%d.\n\n", versionMajor, versionMinor);
 	fprintf(stderr, "%s Copyright %s Neil Edelman\n", programme, year);
 	fprintf(stderr, "This program comes with ABSOLUTELY NO WARRANTY.\n");
@@ -282,6 +322,8 @@ static int new_image(const char *const fn) {
 		if(debug) fprintf(stderr, "Image names: grew size to %u.\n", fibonacci[0]);
 	}
 	strcopy(image_names[no_image_names].name, stripped, max_image_names_name);
+	image_names[no_image_names].is_atlas = 0;
+	image_names[no_image_names].pixels = 0;
 	no_image_names++;
 	is_sorted = 0;
 
@@ -299,7 +341,7 @@ static int include_images(void) {
 	size_t i;
 
 	if(!is_sorted) sort();
-	printf("/* external dependencies -- use File2h to automate */\n");
+	printf("/* external dependencies -- use Loader -r or -z to automate */\n");
 	for(i = 0; i < no_image_names; i++) {
 		printf("#include \"%s.h\"\n", to_name(image_names[i].name));
 	}
@@ -307,6 +349,190 @@ static int include_images(void) {
 	return -1;
 }
 
+/** Tallest first, for \see{pack_atlas}. */
+static int atlas_comp(const struct ImageName *const *const a_ptr,
+	const struct ImageName *const *const b_ptr) {
+	const struct ImageName *const a = *a_ptr, *const b = *b_ptr;
+	if(a->height != b->height) return a->height < b->height ? 1 : -1;
+	return strcmp(a->name, b->name);
+}
+
+/** Packs the png images in {directory} that are at most {atlas_max_side} in
+ shelves, tallest first, into one image, writes it to {fn}, and adds it to the
+ images. The Lambert sprites in Void bind it once and draw them all together.
+ Images that don't fit are left out; they still have their own textures.
+ @return Success. */
+static int pack_atlas(const char *const directory, const char *const fn) {
+	struct ImageName **packed = 0, *in = 0;
+	unsigned char *pixels = 0;
+	static char pn[1024];
+	const int max_pn = sizeof(pn) / sizeof(char);
+	const unsigned g = atlas_gutter;
+	unsigned x = 0, y = 0, shelf = 0, error, px, py, sx, sy;
+	size_t i, packed_size = 0;
+	enum { E_NO, E_PERROR, E_PATH, E_PNG } e = E_NO;
+	do {
+		if(!(packed = malloc(sizeof *packed * (no_image_names + 1))))
+			{ e = E_PERROR; break; }
+		/* Decode the candidates. */
+		for(i = 0; i < no_image_names; i++) {
+			in = image_names + i;
+			if(!suffix(in->name, ext_png_h)) continue;
+			if(snprintf(pn, sizeof(pn) / sizeof(char), "%s%s%s", directory,
+				directory[strlen(directory) - 1] != '/' ? "/" : "", in->name)
+				+ 1 > max_pn) { e = E_PATH; break; }
+			if((error = lodepng_decode32_file(&in->pixels, &in->width,
+				&in->height, pn))) { e = E_PNG; break; }
+			if(in->width > atlas_max_side || in->height > atlas_max_side) {
+				free(in->pixels), in->pixels = 0;
+				continue;
+			}
+			packed[packed_size++] = in;
+		}
+		if(e) break;
+		/* Shelves; tallest first keeps them from wasting much. */
+		qsort(packed, packed_size, sizeof *packed,
+			(int (*)(const void *, const void *))&atlas_comp);
+		for(i = 0; i < packed_size; i++) {
+			in = packed[i];
+			if(x + in->width + 2 * g > atlas_width)
+				y += shelf, x = 0, shelf = 0;
+			if(y + in->height + 2 * g > atlas_max_height) {
+				fprintf(stderr, "%s: %s doesn't fit.\n", fn, in->name);
+				continue;
+			}
+			in->is_atlas = -1;
+			in->x = x + g, in->y = y + g;
+			x += in->width + 2 * g;
+			if(shelf < in->height + 2 * g) shelf = in->height + 2 * g;
+		}
+		atlas.width = atlas_width;
+		for(atlas.height = 1; atlas.height < y + shelf; atlas.height <<= 1);
+		if(!(pixels = calloc((size_t)atlas.width * atlas.height, 4)))
+			{ e = E_PERROR; break; }
+		/* Copy, repeating the edges into the gutter. */
+		for(i = 0; i < packed_size; i++) {
+			in = packed[i];
+			if(!in->is_atlas) continue;
+			for(py = in->y - g; py < in->y + in->height + g; py++) {
+				sy = py < in->y ? 0 : py - in->y >= in->height
+					? in->height - 1 : py - in->y;
+				for(px = in->x - g; px < in->x + in->width + g; px++) {
+					sx = px < in->x ? 0 : px - in->x >= in->width
+						? in->width - 1 : px - in->x;
+					memcpy(pixels + ((size_t)py * atlas.width + px) * 4,
+						in->pixels + ((size_t)sy * in->width + sx) * 4, 4);
+				}
+			}
+		}
+		in = 0;
+		if((error = lodepng_encode32_file(fn, pixels, atlas.width,
+			atlas.height))) { e = E_PNG; break; }
+		fprintf(stderr, "%s: packed %lu images in %ux%u.\n", fn,
+			(unsigned long)packed_size, atlas.width, atlas.height);
+		/* It's an image itself. */
+		if(!(atlas.name = strrchr(fn, '/'))) atlas.name = fn;
+		else atlas.name++;
+		if(!new_image(atlas.name)) { e = E_PERROR; break; }
+	} while(0); switch(e) {
+		case E_NO: break;
+		case E_PERROR: perror(fn); break;
+		case E_PATH: fprintf(stderr, "%s: path name buffer can't hold %u "
+			"characters.\n", in->name, max_pn); break;
+		case E_PNG: fprintf(stderr, "Loader: lodepng error %u on %s: %s\n",
+			error, in ? in->name : fn, lodepng_error_text(error)); break;
+	} {
+		free(pixels);
+		free(packed);
+		for(i = 0; i < no_image_names; i++)
+			free(image_names[i].pixels), image_names[i].pixels = 0;
+	}
+	return !e;
+}
+
+/** Decodes the png or jpeg {fn} into a header for \see{include_images}: the
+ pixels exactly as Void uploads them, bottom row first, so it doesn't have to
+ decode or flip anything; {<name>_format} says which.
+ @param is_lz4: Compressed with LZ4; Void decompresses it straight into the
+ upload.
+ @return Success. */
+static int image_header(char *const fn, const int is_lz4) {
+	unsigned char *pixels = 0, *file = 0, *lz4 = 0, *row = 0, *top, *bottom;
+	const unsigned char *out;
+	const char *base, *name;
+	FILE *fp = 0;
+	unsigned width = 0, height = 0, depth = 0, error = 0, y;
+	size_t line, size, out_size, i;
+	long file_size = 0;
+	enum { E_NO, E_PERROR, E_PNG, E_JPEG, E_TYPE, E_NAME, E_LZ4 } e = E_NO;
+	if(!(base = strrchr(fn, '/'))) base = fn;
+	else base++;
+	do {
+		if(suffix(fn, ext_png_h)) {
+			if((error = lodepng_decode32_file(&pixels, &width, &height, fn)))
+				{ e = E_PNG; break; }
+			depth = 4;
+		} else if(suffix(fn, ext_jpeg_h)) {
+			/* nanojpeg doesn't do io */
+			if(!(fp = fopen(fn, "rb")) || fseek(fp, 0l, SEEK_END)
+				|| (file_size = ftell(fp)) < 0 || fseek(fp, 0l, SEEK_SET)
+				|| !(file = malloc((size_t)file_size + 1))
+				|| fread(file, 1, (size_t)file_size, fp) != (size_t)file_size)
+				{ e = E_PERROR; break; }
+			if(njDecode(file, (int)file_size) || !njIsColor())
+				{ e = E_JPEG; break; }
+			width = njGetWidth(), height = njGetHeight(), depth = 3;
+			if(!(pixels = malloc((size_t)width * height * depth)))
+				{ e = E_PERROR; break; }
+			memcpy(pixels, njGetImage(), (size_t)width * height * depth);
+		} else { e = E_TYPE; break; }
+		line = (size_t)width * depth, size = line * height;
+		/* OpenGL's first row is the bottom */
+		if(!(row = malloc(line + 1))) { e = E_PERROR; break; }
+		for(y = 0; y < height / 2; y++) {
+			top = pixels + y * line, bottom = pixels + (height - 1 - y) * line;
+			memcpy(row, top, line), memcpy(top, bottom, line);
+			memcpy(bottom, row, line);
+		}
+		out = pixels, out_size = size;
+		if(is_lz4) {
+			if(!(lz4 = malloc(Lz4Bound(size)))) { e = E_PERROR; break; }
+			if(!(out_size = Lz4Compress(pixels, size, lz4, Lz4Bound(size))))
+				{ e = E_LZ4; break; }
+			out = lz4;
+		}
+		if(!(name = to_name(base))) { e = E_NAME; break; }
+		printf("/** auto-generated from %s by %s %d.%d: %ux%ux%u, bottom row "
+			"first%s */\n\n", base, programme, versionMajor, versionMinor,
+			width, height, depth, is_lz4 ? ", LZ4" : "");
+		printf("#define %s_format %s\n\n", name, is_lz4 ? "IF_LZ4" : "IF_RAW");
+		printf("static const unsigned char %s[] = {", name);
+		for(i = 0; i < out_size; i++) printf("%s0x%02x",
+			i ? i % 16 ? "," : ",\n" : "\n", out[i]);
+		printf("\n};\n");
+		fprintf(stderr, "%s: %ux%ux%u, %lu bytes%s.\n", base, width, height,
+			depth, (unsigned long)out_size, is_lz4 ? " compressed" : "");
+	} while(0); switch(e) {
+		case E_NO: break;
+		case E_PERROR: perror(fn); break;
+		case E_PNG: fprintf(stderr, "Loader: lodepng error %u on %s: %s\n",
+			error, fn, lodepng_error_text(error)); break;
+		case E_JPEG: fprintf(stderr, "%s: decoding failed.\n", fn); break;
+		case E_TYPE: fprintf(stderr, "%s: unrecognised image format.\n", fn);
+			break;
+		case E_NAME: fprintf(stderr, "%s: name too long.\n", fn); break;
+		case E_LZ4: fprintf(stderr, "%s: compression failed.\n", fn); break;
+	} {
+		njDone();
+		if(fp) fclose(fp);
+		free(file);
+		free(pixels);
+		free(row);
+		free(lz4);
+	}
+	return !e;
+}
+
 static int print_images(const char *const directory) {
 	size_t size = 0, i;
 	static char pn[1024];
@@ -321,8 +547,10 @@ static int print_images(const char *const directory) {
 	for(i = 0; i < no_image_names; i++) {
 		fn = image_names[i].name;
 
-		/* build into path */
-		if(snprintf(pn, sizeof(pn) / sizeof(char), "%s%s%s", directory,
+		/* build into path; the atlas is not with the others */
+		if(atlas.name && !strcmp(fn, atlas.name)) {
+			strcopy(pn, atlas.fn, sizeof(pn) / sizeof(char));
+		} else if(snprintf(pn, sizeof(pn) / sizeof(char), "%s%s%s", directory,
 					directory[strlen(directory) - 1] != '/' ? "/" : "",
 					fn) + 1 > max_pn) {
 			fprintf(stderr, "%s: path name buffer can't hold %u characters.\n", fn, max_pn);
@@ -340,15 +568,9 @@ static int print_images(const char *const directory) {
 
 		/* fixme: ick, no, compare then have an enum */
 		if(!strcmp("IF_PNG", type)) {
-			FILE *fp;
 			unsigned error;
 
-			/* get file size */
-			if(!(fp = fopen(pn, "r"))
-			   || fseek(fp, 0l, SEEK_END)
-			   || (int)(size = ftell(fp)) == -1
-			   || fclose(fp)) { perror(fn); fclose(fp); return 0; }
-			/* re-open it in lodepng to get the other info */
+			/* open it in lodepng to get the other info */
 			if((error = lodepng_decode32_file(&data, &width, &height, pn))) {
 				fprintf(stderr, "Loader: lodepng error %u on %s: %s\n", error, pn, lodepng_error_text(error));
 				return 0;
@@ -414,7 +636,23 @@ static int print_images(const char *const directory) {
 			return 0;
 		}
 
-		printf("\t{ \"%s\", %s, %u, %s, %u, %u, %u, 0 }%s", fn, type, (unsigned)size, to_name(fn), width, height, depth, i != no_image_names - 1 ? ",\n" : "\n");
+		/* the format and the data are from the header, \see{image_header} */
+		if(!(str = to_name(fn))) {
+			fprintf(stderr, "%s: name too long.\n", fn);
+			return 0;
+		}
+		printf("\t{ \"%s\", %s_format, sizeof %s, %s, %u, %u, %u, ", fn, str, str, str, width, height, depth);
+		/* OpenGL is upside-down, so is the atlas */
+		if(image_names[i].is_atlas) {
+			const struct ImageName *const in = image_names + i;
+			printf("{ %.8ff, %.8ff, %.8ff, %.8ff }", (double)in->x / atlas.width,
+				(double)(atlas.height - in->y - in->height) / atlas.height,
+				(double)in->width / atlas.width,
+				(double)in->height / atlas.height);
+		} else {
+			printf("{ 0.0f, 0.0f, 0.0f, 0.0f }");
+		}
+		printf(", 0 }%s", i != no_image_names - 1 ? ",\n" : "\n");
 	}
 	printf("};\n");
 	printf("const int max_auto_images = sizeof auto_images / sizeof(struct AutoImage);\n\n");
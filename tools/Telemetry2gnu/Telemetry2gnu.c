@@ -0,0 +1,201 @@
+/* Copyright 2018 Neil Edelman, distributed under the terms of the
+ GNU General Public License, see copying.txt
+
+ Converts a frame of the binary telemetry that Void streams when one presses
+ '1', (see {SpritesPlot.h},) into data and a Gnuplot script, {Space.data} and
+ {Space.gnu}, that draw the sprites, their velocities, the bins that were on
+ screen, and arrows from the sprites to the bins they overlap.
+
+ @version 2018-02
+ @since 2018-02
+ @author Neil */
+
+#include <stdlib.h> /* malloc free strtoul */
+#include <stdio.h>  /* fopen fprintf */
+#include <string.h> /* memcmp */
+
+/* constants */
+static const char *programme   = "Telemetry2gnu";
+static const char *year        = "2018";
+static const int versionMajor  = 1;
+static const int versionMinor  = 0;
+
+/* Must be the same as in {SpritesPlot.h}. */
+static const char telemetry_magic[8]
+	= { 'V', 'o', 'i', 'd', 'T', 'e', 'l', 'e' };
+static const unsigned telemetry_version = 1;
+struct TelemetryHeader {
+	char magic[8];
+	unsigned version, frame_size, sprite_size, cover_size;
+};
+struct TelemetryFrame {
+	unsigned frame, ms, dropped, sprites, covers, bins;
+	float dt_ms;
+};
+struct TelemetrySprite {
+	float x, y, bounding, vx, vy;
+	unsigned short class;
+	unsigned short bin;
+};
+struct TelemetryCover {
+	float x, y;
+	unsigned short bin, is_corner;
+};
+/* Must be the same as in {Sprites.c}. */
+static const char *const class_names[] = { "Ship", "Debris", "Wmd", "Gate" };
+static const unsigned layer_side = 64;
+static const float layer_space = 256.0f;
+
+static void usage(void) {
+	fprintf(stderr, "Usage: %s <file.telemetry> [frame]\n"
+		"Writes Space.data and Space.gnu for the frame'th frame in the file, "
+		"or the last\nif it's not given; run gnuplot Space.gnu for Space.eps.\n"
+		"Version %d.%d, Copyright %s Neil Edelman.\n",
+		programme, versionMajor, versionMinor, year);
+}
+
+/** Lower-left corner of {bin}, the same as {LayerGetBinMarker}. */
+static void bin_marker(const unsigned bin, float *const x, float *const y) {
+	*x = ((float)(bin % layer_side) - layer_side / 2.0f) * layer_space;
+	*y = ((float)(bin / layer_side) - layer_side / 2.0f) * layer_space;
+}
+
+/** Writes the Gnuplot of one frame. */
+static int plot(const struct TelemetryFrame *const frame,
+	const struct TelemetrySprite *const sprites,
+	const struct TelemetryCover *const covers, const unsigned *const bins) {
+	FILE *data = 0, *gnu = 0;
+	const char *data_fn = "Space.data", *gnu_fn = "Space.gnu",
+		*eps_fn = "Space.eps";
+	enum { E_NO, E_DATA, E_GNU } e = E_NO;
+	unsigned i;
+	float x, y;
+	do {
+		if(!(data = fopen(data_fn, "w"))) { e = E_DATA; break; }
+		if(!(gnu = fopen(gnu_fn, "w")))   { e = E_GNU;  break; }
+		for(i = 0; i < frame->sprites; i++) {
+			const struct TelemetrySprite *const s = sprites + i;
+			fprintf(data, "%f\t%f\t%f\t%f\t%f\t%f\t%f\t\"%s%u\"\n",
+				s->x, s->y, s->bounding, (double)i / frame->sprites, s->x, s->y,
+				s->bounding, s->class < sizeof class_names / sizeof *class_names
+				? class_names[s->class] : "?", i);
+		}
+		fprintf(gnu, "# frame %u at %ums, %u dropped before\n"
+			"set term postscript eps enhanced size 256cm, 256cm\n"
+			"set output \"%s\"\n"
+			"set size square;\n"
+			"set palette defined (1 \"#0000FF\", 2 \"#00FF00\", 3 \"#FF0000\");"
+			"\n"
+			"set xtics 256 rotate; set ytics 256;\n"
+			"set grid;\n"
+			"set xrange [-8192:8192];#[-2048:2048];\n"
+			"set yrange [-8192:8192];#[-2048:2048];\n"
+			"set cbrange [0.0:1.0];\n", frame->frame, frame->ms,
+			frame->dropped, eps_fn);
+		/* draw bins as squares behind */
+		fprintf(gnu, "set style fill transparent solid 0.3 noborder;\n");
+		for(i = 0; i < frame->bins; i++) {
+			bin_marker(bins[i], &x, &y);
+			fprintf(gnu, "# bin %u -> %.1f,%.1f\n", bins[i], x, y);
+			fprintf(gnu, "set object %u rect from %f,%f to %f,%f fc rgb "
+				"\"#ADD8E6\" fs transparent pattern 4 noborder;\n", i + 1,
+				x, y, x + layer_space, y + layer_space);
+		}
+		/* draw velocities */
+		for(i = 0; i < frame->sprites; i++) {
+			const struct TelemetrySprite *const s = sprites + i;
+			fprintf(gnu, "set arrow from %f,%f to %f,%f lw 1 lc rgb \"blue\" "
+				"front;\n", s->x, s->y, s->x + s->vx * frame->dt_ms * 256.0f,
+				s->y + s->vy * frame->dt_ms * 256.0f);
+		}
+		/* draw arrows from each of the sprites to their bins */
+		for(i = 0; i < frame->covers; i++) {
+			const struct TelemetryCover *const c = covers + i;
+			bin_marker(c->bin, &x, &y);
+			fprintf(gnu, "set arrow from %f,%f to %f,%f lw 1 lc rgb \"%s\" "
+				"front;\n", c->x, c->y, x + 50.0f, y + 50.0f,
+				c->is_corner ? "red" : "pink");
+		}
+		/* draw the sprites */
+		fprintf(gnu, "plot \"%s\" using 5:6:7 with circles \\\n"
+			"linecolor rgb(\"#00FF00\") fillstyle transparent "
+			"solid 1.0 noborder title \"Velocity\", \\\n"
+			"\"%s\" using 1:2:3:4 with circles \\\n"
+			"linecolor palette fillstyle transparent solid 0.3 noborder \\\n"
+			"title \"Sprites\", \\\n"
+			"\"%s\" using 1:2:8 with labels notitle;\n",
+			data_fn, data_fn, data_fn);
+	} while(0); switch(e) {
+		case E_NO: break;
+		case E_DATA: perror(data_fn); break;
+		case E_GNU:  perror(gnu_fn);  break;
+	} {
+		if(data && fclose(data) == EOF) perror(data_fn);
+		if(gnu  && fclose(gnu)  == EOF) perror(gnu_fn);
+	}
+	if(!e) fprintf(stderr, "Frame %u: %u sprites, %u covers, %u bins; wrote "
+		"%s and %s.\n", frame->frame, frame->sprites, frame->covers,
+		frame->bins, data_fn, gnu_fn);
+	return !e;
+}
+
+/** Entry point.
+ @return Either EXIT_SUCCESS or EXIT_FAILURE. */
+int main(int argc, char **argv) {
+	FILE *fp = 0;
+	struct TelemetryHeader header;
+	struct TelemetryFrame frame, last;
+	struct TelemetrySprite *sprites = 0;
+	struct TelemetryCover *covers = 0;
+	unsigned *bins = 0;
+	unsigned long want = (unsigned long)-1, n = 0;
+	long offset = -1, last_offset = -1;
+	int is_found = 0, is_ok = 0;
+	if(argc < 2 || argc > 3) return usage(), EXIT_FAILURE;
+	if(argc == 3) want = strtoul(argv[2], 0, 0);
+	do {
+		if(!(fp = fopen(argv[1], "rb"))) { perror(argv[1]); break; }
+		if(fread(&header, sizeof header, 1, fp) != 1
+			|| memcmp(header.magic, telemetry_magic, sizeof header.magic)
+			|| header.version != telemetry_version
+			|| header.frame_size != sizeof frame
+			|| header.sprite_size != sizeof *sprites
+			|| header.cover_size != sizeof *covers) {
+			fprintf(stderr, "%s: not version %u telemetry from this machine.\n",
+				argv[1], telemetry_version); break;
+		}
+		/* Skip to the frame, remembering the last whole one. */
+		for( ; ; n++) {
+			if((offset = ftell(fp)) == -1l) { perror(argv[1]); break; }
+			if(fread(&frame, sizeof frame, 1, fp) != 1) break;
+			if(fseek(fp, (long)(sizeof *sprites * frame.sprites
+				+ sizeof *covers * frame.covers + sizeof *bins * frame.bins),
+				SEEK_CUR)) break;
+			last = frame, last_offset = offset;
+			if(n == want) { is_found = 1; break; }
+		}
+		if(!is_found && (want != (unsigned long)-1 || last_offset == -1)) {
+			fprintf(stderr, "%s: %lu frames; frame %lu not found.\n", argv[1],
+				n, want); break;
+		}
+		frame = last;
+		if(fseek(fp, last_offset + (long)sizeof frame, SEEK_SET))
+			{ perror(argv[1]); break; }
+		if((frame.sprites && !(sprites = malloc(sizeof *sprites*frame.sprites)))
+			|| (frame.covers && !(covers = malloc(sizeof *covers*frame.covers)))
+			|| (frame.bins && !(bins = malloc(sizeof *bins * frame.bins))))
+			{ perror("frame"); break; }
+		if((frame.sprites
+			&& fread(sprites, sizeof *sprites, frame.sprites, fp)!=frame.sprites)
+			|| (frame.covers
+			&& fread(covers, sizeof *covers, frame.covers, fp) != frame.covers)
+			|| (frame.bins
+			&& fread(bins, sizeof *bins, frame.bins, fp) != frame.bins))
+			{ fprintf(stderr, "%s: truncated.\n", argv[1]); break; }
+		is_ok = plot(&frame, sprites, covers, bins);
+	} while(0); {
+		free(bins), free(covers), free(sprites);
+		if(fp && fclose(fp) == EOF) perror(argv[1]);
+	}
+	return is_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -5,30 +5,74 @@
  tricks) into a C header. It is very delicate and not production code. It
  relies on {struct Shader} included in Draw.c
 
- @version 2017-05-15 Made much more complex.
+ A {uniform} block, (in a line ending with {\{} and closed by a line starting
+ with {\}},) becomes a {struct Auto<Block>} laid out as {std140} with
+ padding, so C can fill it and upload the whole thing. The block is given a
+ binding point after the attributes, or {AUTO_BLOCK_NONE} for none. Only
+ scalars and vectors of {float}, {int}, and {bool} are understood in blocks.
+
+ A line {#include "<file>"} is replaced by {<file>}, from the same directory
+ as the shader, before anything else is done with it; a block that is the
+ same in many shaders is written once.
+
+ {auto_<Name>_variant} compiles with some {#define}s before both sources, so
+ one shader can be compiled into several programmes; it's up to the caller to
+ keep the {auto_<Name>_shader} of each. It's {auto_<Name>_begin} followed
+ by {auto_<Name>_end}; calling all the {begin}s before any {end}s lets the
+ driver compile them at the same time. The {begin} asks {ProgramsLoad} for a
+ linked binary first, and the {end} gives a new one to {ProgramsStore}, so
+ the includer must declare them.
+
+ @version 2018-02 Uniform blocks, variants, cached programmes, and includes.
  @since 2014
  @author Neil */
 
 #include <stdlib.h> /* malloc free */
 #include <stdio.h>  /* printf */
-#include <string.h> /* strncpy, strrchr */
+#include <string.h> /* strncpy, strrchr, strcpy, memcpy */
 #include <assert.h> /* assert */
 
 /* constants */
 static const char *programme   = "Vsfs2h";
 static const char *year        = "2014";
 static const int versionMajor  = 2;
-static const int versionMinor  = 0;
+static const int versionMinor  = 4;
 
 /* private */
 static void source_process(const char *const fn, const int is_output);
 static void usage(const char *argvz);
 
+/* {std140} types; a scalar is 4 bytes, and a {vec3} is aligned as a {vec4}. */
+static const struct Type {
+	const char *name, *c;
+	unsigned size, align;
+} types[] = {
+	{ "float", "GLfloat", 1, 1 }, { "vec2", "GLfloat", 2, 2 },
+	{ "vec3", "GLfloat", 3, 4 }, { "vec4", "GLfloat", 4, 4 },
+	{ "int", "GLint", 1, 1 }, { "ivec2", "GLint", 2, 2 },
+	{ "ivec3", "GLint", 3, 4 }, { "ivec4", "GLint", 4, 4 },
+	{ "bool", "GLint", 1, 1 }
+};
+static const size_t types_size = sizeof types / sizeof *types;
+
+struct Member {
+	char name[64];
+	const struct Type *type;
+};
+
+struct Block {
+	char name[64];
+	struct Member members[32];
+	size_t members_size;
+};
+
 static struct Text {
 	char attribs[16][64];
 	size_t attribs_size;
 	char uniforms[512][64];
 	size_t uniforms_size;
+	struct Block blocks[8];
+	size_t blocks_size;
 } text;
 const size_t text_attribs_capacity = sizeof((struct Text *)0)->attribs
 	/ sizeof *((struct Text *)0)->attribs,
@@ -39,21 +83,81 @@ const size_t text_attribs_capacity = sizeof((struct Text *)0)->attribs
 	text_uniforms_max = sizeof *((struct Text *)0)->uniforms
 	/ sizeof **((struct Text *)0)->uniforms;
 
-static void prototype(const char *const name) {
-	printf("int auto_%s(", name);
-	if(text.attribs_size) {
+/** Prints {s}, with every {$} as {name}. */
+static void put(const char *s, const char *const name) {
+	for( ; *s; s++) if(*s == '$') fputs(name, stdout); else putchar(*s);
+}
+
+/** Prints the declaration of a function that compiles, {auto_<name><suffix>};
+ {is_variant} has {defines} at the end. */
+static void prototype(const char *const name, const char *const suffix,
+	const int is_variant) {
+	printf("int auto_%s%s(", name, suffix);
+	if(text.attribs_size || text.blocks_size || is_variant) {
 		size_t i;
 		for(i = 0; i < text.attribs_size; i++) {
 			const char *const attrib = text.attribs[i];
 			printf("const GLuint %s%s", attrib,
-				i != text.attribs_size - 1 ? ", " : "");
+				i != text.attribs_size - 1 || text.blocks_size || is_variant
+				? ", " : "");
 		}
+		for(i = 0; i < text.blocks_size; i++) {
+			const char *const block = text.blocks[i].name;
+			printf("const GLuint %s%s", block,
+				i != text.blocks_size - 1 || is_variant ? ", " : "");
+		}
+		if(is_variant) printf("const char *const defines");
 	} else {
 		printf("void");
 	}
 	printf(")");
 }
 
+/** Prints the arguments that were given to \see{prototype}. */
+static void arguments(void) {
+	size_t i;
+	for(i = 0; i < text.attribs_size; i++) printf("%s, ", text.attribs[i]);
+	for(i = 0; i < text.blocks_size; i++) printf("%s, ", text.blocks[i].name);
+}
+
+/** Prints {block} as a C struct, once for all the headers, with padding to
+ make it {std140}. */
+static void block_struct(const struct Block *const block) {
+	char upper[64], *u;
+	unsigned offset = 0, padding = 0, align;
+	size_t i;
+	strncpy(upper, block->name, sizeof upper), upper[sizeof upper - 1] = '\0';
+	for(u = upper; *u; u++) if(*u >= 'a' && *u <= 'z') *u += 'A' - 'a';
+	printf("#ifndef AUTO_%s_BLOCK /* <-- %s */\n"
+		"#define AUTO_%s_BLOCK\n"
+		"/** Uniform block {%s}, std140. */\n"
+		"struct Auto%s {\n", upper, block->name, upper, block->name,
+		block->name);
+	for(i = 0; i < block->members_size; i++) {
+		const struct Member *const m = block->members + i;
+		align = m->type->align;
+		if(offset % align) {
+			printf("\tGLfloat unused%u", padding++);
+			if(align - offset % align > 1)
+				printf("[%u]", align - offset % align);
+			printf(";\n");
+			offset += align - offset % align;
+		}
+		printf("\t%s %s", m->type->c, m->name);
+		if(m->type->size > 1) printf("[%u]", m->type->size);
+		printf(";\n");
+		offset += m->type->size;
+	}
+	/* The size of a block is rounded up to a {vec4}. */
+	if(offset % 4) {
+		printf("\tGLfloat unused%u", padding++);
+		if(4 - offset % 4 > 1) printf("[%u]", 4 - offset % 4);
+		printf(";\n");
+	}
+	printf("};\n"
+		"#endif /* %s --> */\n\n", block->name);
+}
+
 /** private (entry point)
  @param which file is turned into *.h
  @bug do not include \", it will break
@@ -92,126 +196,325 @@ int main(int argc, char **argv) {
 	/* print output */
 	printf("/** Auto-generated from %s and %s by %s %d.%d */\n\n",
 		base[0], base[1], programme, versionMajor, versionMinor);
+	if(text.blocks_size) printf("#ifndef AUTO_BLOCK_NONE /* <-- none */\n"
+		"#define AUTO_BLOCK_NONE (~(GLuint)0)\n"
+		"#endif /* none --> */\n\n");
+	for(i = 0; i < text.blocks_size; i++) block_struct(text.blocks + i);
 	printf("static struct Auto%sShader {\n"
 		"\tconst char *vs_source;\n"
 		"\tconst char *fs_source;\n"
-		"\tGLuint compiled;\n", name);
+		"\tGLuint compiled;\n"
+		"\t/* Between {auto_%s_begin} and {auto_%s_end}. */\n"
+		"\tconst char *defines;\n"
+		"\tGLuint vs, fs, linking;\n"
+		"\tint is_cached;\n", name, name, name);
 	for(i = 0; i < text.uniforms_size; i++) {
 		un = text.uniforms[i];
 		printf("\tGLint %s;\n", un);
 	}
+	for(i = 0; i < text.blocks_size; i++)
+		printf("\tGLuint %s;\n", text.blocks[i].name);
 	printf("} auto_%s_shader = {\n"
 		"/* vs_source */", name);
 	source_process(argv[1], 1), printf(",\n"
 		"/* fs_source */");
 	source_process(argv[2], 1), printf(",\n"
-		"/* linked shader and uniform variables set at run-time */\n");
+		"/* linked shader and uniform variables set at run-time */\n"
+		"0, 0, 0, 0, 0, ");
 	for(i = 0; i <= text.uniforms_size; i++) {
-		printf("0%s", i != text.uniforms_size ? ", " : "\n");
+		printf("0%s", i != text.uniforms_size || text.blocks_size ? ", " : "\n");
+	}
+	for(i = 0; i < text.blocks_size; i++) {
+		printf("AUTO_BLOCK_NONE%s", i != text.blocks_size - 1 ? ", " : "\n");
 	}
 	printf("};\n\n");
-	prototype(name), printf(";\n\n"
-	"/** Compiles a shader.\n"
-	" @return Success. */\n");
-	prototype(name), printf(" {\n"
-	"\tGLuint vs = 0, fs = 0, shader = 0;\n"
-	"\tGLint status;\n"
-	"\tenum { S_NOERR, S_VERT, S_FRAG, S_LINK, S_VALIDATE } e = S_NOERR;\n\n"
-	"\tdo {\n"
-	"\t\tvs = glCreateShader(GL_VERTEX_SHADER);\n"
-	"\t\tglShaderSource(vs, 1, &auto_%s_shader.vs_source, 0);\n"
-	"\t\tglCompileShader(vs);\n"
-	"\t\tglGetShaderiv(vs, GL_COMPILE_STATUS, &status);\n"
-	"\t\tif(!status) { e = S_VERT; break; }\n"
-	"\t\tfprintf(stderr, \"auto_%s_shader_init: compiled vertex shader, Sdr%%u.\\n\", vs);\n"
-	"", name, name);
-	printf("\t\tfs = glCreateShader(GL_FRAGMENT_SHADER);\n"
-	"\t\tglShaderSource(fs, 1, &auto_%s_shader.fs_source, 0);\n"
-	"\t\tglCompileShader(fs);\n"
-	"\t\tglGetShaderiv(fs, GL_COMPILE_STATUS, &status);\n"
-	"\t\tif(!status) { e = S_FRAG; break; }\n"
-	"\t\tfprintf(stderr, \"auto_%s_shader_init: compiled fragment shader, Sdr%%u.\\n\", fs);\n"
-	"\t\tshader = glCreateProgram();\n"
-	"\t\tglAttachShader(shader, vs);\n"
-	"\t\tglAttachShader(shader, fs);\n"
-	"", name, name);
+	prototype(name, "_begin", 1), printf(";\n"
+	"int auto_%s_end(void);\n", name);
+	prototype(name, "_variant", 1), printf(";\n");
+	prototype(name, "", 0), printf(";\n\n");
+
+	put("/** Starts a shader with {defines}, eg, {\"#define X 1\\n\"}, before the\n"
+	" source of both. It's loaded by \\see{ProgramsLoad} if it can be; if not,\n"
+	" it's compiled and linked, which the driver may do in the background until\n"
+	" \\see{auto_$_end}.\n"
+	" @return Success. */\n", name);
+	prototype(name, "_begin", 1), printf(" {\n");
+	put("\tconst char *source[2];\n"
+	"\tGLuint shader;\n"
+	"\tauto_$_shader.defines = defines ? defines : \"\";\n"
+	"\tauto_$_shader.vs = auto_$_shader.fs = auto_$_shader.linking = 0;\n"
+	"\tauto_$_shader.is_cached = 0;\n", name);
+	for(i = 0; i < text.blocks_size; i++) {
+		const char *const block = text.blocks[i].name;
+		printf("\t/* The binding until \\see{auto_%s_end}. */\n"
+		"\tauto_%s_shader.%s = %s;\n", name, name, block, block);
+	}
+	put("\tif(!(shader = glCreateProgram())) return 0;\n"
+	"\tauto_$_shader.linking = shader;\n"
+	"\tif(ProgramsLoad(shader, \"$\", auto_$_shader.defines,\n"
+	"\t\tauto_$_shader.vs_source, auto_$_shader.fs_source)", name);
+	for(i = 0; i < text.attribs_size; i++) {
+		const char *const attrib = text.attribs[i];
+		printf("\n\t\t&& (glGetAttribLocation(shader, \"%s\") == -1\n"
+		"\t\t|| glGetAttribLocation(shader, \"%s\") == (GLint)%s)",
+		attrib, attrib, attrib);
+	}
+	put(") {\n"
+	"\t\tauto_$_shader.is_cached = 1;\n"
+	"\t\treturn 1;\n"
+	"\t}\n"
+	"\tsource[0] = auto_$_shader.defines;\n"
+	"\tauto_$_shader.vs = glCreateShader(GL_VERTEX_SHADER);\n"
+	"\tsource[1] = auto_$_shader.vs_source;\n"
+	"\tglShaderSource(auto_$_shader.vs, 2, source, 0);\n"
+	"\tglCompileShader(auto_$_shader.vs);\n"
+	"\tauto_$_shader.fs = glCreateShader(GL_FRAGMENT_SHADER);\n"
+	"\tsource[1] = auto_$_shader.fs_source;\n", name);
+	put("\tglShaderSource(auto_$_shader.fs, 2, source, 0);\n"
+	"\tglCompileShader(auto_$_shader.fs);\n"
+	"\tglAttachShader(shader, auto_$_shader.vs);\n"
+	"\tglAttachShader(shader, auto_$_shader.fs);\n", name);
 	for(i = 0; i < text.attribs_size; i++) {
 		const char *const attrib = text.attribs[i];
-		printf("\t\tglBindAttribLocation(shader, %s, \"%s\");\n",
+		printf("\tglBindAttribLocation(shader, %s, \"%s\");\n",
 			attrib, attrib);
 	}
-	printf("\t\tglLinkProgram(shader);\n"
+	put("\tglLinkProgram(shader);\n"
+	"\treturn 1;\n"
+	"}\n\n"
+
+	"/** Finishes \\see{auto_$_begin}, waiting for the driver if it has to.\n"
+	" @return Success. */\n"
+	"int auto_$_end(void) {\n"
+	"\tconst GLuint vs = auto_$_shader.vs, fs = auto_$_shader.fs,\n"
+	"\t\tshader = auto_$_shader.linking;\n"
+	"\tGLint status;\n"
+	"\tenum { S_NOERR, S_VERT, S_FRAG, S_LINK, S_VALIDATE } e = S_NOERR;\n\n"
+	"\tauto_$_shader.vs = auto_$_shader.fs = auto_$_shader.linking = 0;\n", name);
+	put("\tif(!shader) return 0;\n"
+	"\tdo {\n"
+	"\t\tif(!auto_$_shader.is_cached) {\n"
+	"\t\t\tglGetShaderiv(vs, GL_COMPILE_STATUS, &status);\n"
+	"\t\t\tif(!status) { e = S_VERT; break; }\n"
+	"\t\t\tfprintf(stderr, \"auto_$_shader_init: compiled vertex shader, Sdr%u.\\n\", vs);\n"
+	"\t\t\tglGetShaderiv(fs, GL_COMPILE_STATUS, &status);\n"
+	"\t\t\tif(!status) { e = S_FRAG; break; }\n", name);
+	put("\t\t\tfprintf(stderr, \"auto_$_shader_init: compiled fragment shader, Sdr%u.\\n\", fs);\n"
+	"\t\t}\n"
 	"\t\tglGetProgramiv(shader, GL_LINK_STATUS, &status);\n"
 	"\t\tif(!status) { e = S_LINK; break; }\n"
-	"\t\tfprintf(stderr, \"auto_%s_shader_init: linked shader programme, Sdr%%u.\\n\", shader);\n"
-	"\t\tglValidateProgram(shader);\n"
-	"\t\tglGetProgramiv(shader, GL_VALIDATE_STATUS, &status);\n"
+	"\t\tfprintf(stderr, \"auto_$_shader_init: %s shader programme, Sdr%u.\\n\",\n"
+	"\t\t\tauto_$_shader.is_cached ? \"loaded\" : \"linked\", shader);\n"
+	"\t\tglValidateProgram(shader);\n", name);
+	put("\t\tglGetProgramiv(shader, GL_VALIDATE_STATUS, &status);\n"
 	"\t\tif(!status) { e = S_VALIDATE; break; }\n"
-	"\t\tfprintf(stderr, \"auto_%s_shader_init: validated shader, Sdr%%u.\\n\", shader);\n"
+	"\t\tfprintf(stderr, \"auto_$_shader_init: validated shader, Sdr%u.\\n\", shader);\n"
 	"\t} while(0);\n"
 	"\tif(e) {\n"
 	"\t\tGLchar str[1024];\n"
 	"\t\tconst char *const during[] = { \"none\", \"vertex compilation\",\n"
-	"", name, name);
-	printf("\t\t\t\"fragment compilation\", \"linking\", \"validation\" };\n"
-	"\t\tglGetShaderInfoLog(vs, (GLsizei)sizeof(str), 0, str);\n"
-	"\t\tfprintf(stderr, \"auto_%s_shader_init: failed %%s;\\n%%s\", during[e], str);\n"
+	"\t\t\t\"fragment compilation\", \"linking\", \"validation\" };\n"
+	"\t\tstr[0] = '\\0';\n", name);
+	put("\t\tif(e == S_VERT) glGetShaderInfoLog(vs, (GLsizei)sizeof(str), 0, str);\n"
+	"\t\telse if(e == S_FRAG) glGetShaderInfoLog(fs, (GLsizei)sizeof(str), 0, str);\n"
+	"\t\telse glGetProgramInfoLog(shader, (GLsizei)sizeof(str), 0, str);\n"
+	"\t\tfprintf(stderr, \"auto_$_shader_init: failed %s;\\n%s\", during[e], str);\n"
 	"\t}\n"
 	"\tif(fs) {\n"
 	"\t\tglDeleteShader(fs);\n"
-	"\t\tif(shader) glDetachShader(shader, fs);\n"
-	"\t\tfprintf(stderr, \"auto_%s_shader_init: erasing fragment shader, Sdr%%u.\\n\", fs);\n"
+	"\t\tglDetachShader(shader, fs);\n", name);
+	put("\t\tfprintf(stderr, \"auto_$_shader_init: erasing fragment shader, Sdr%u.\\n\", fs);\n"
 	"\t}\n"
 	"\tif(vs) {\n"
 	"\t\tglDeleteShader(vs);\n"
-	"", name, name);
-	printf("\t\tif(shader) glDetachShader(shader, vs);\n"
-	"\t\tfprintf(stderr, \"auto_%s_shader_init: erasing vertex shader, Sdr%%u.\\n\", vs);\n"
+	"\t\tglDetachShader(shader, vs);\n"
+	"\t\tfprintf(stderr, \"auto_$_shader_init: erasing vertex shader, Sdr%u.\\n\", vs);\n"
 	"\t}\n"
 	"\tif(e) {\n"
-	"\t\tif(shader) {\n"
-	"\t\t\tglDeleteProgram(shader);\n"
-	"\t\t\tfprintf(stderr, \"auto_%s_shader_init: erased shader, Sdr%%u.\\n\", shader);\n"
-	"\t\t}\n"
+	"\t\tglDeleteProgram(shader);\n"
+	"\t\tfprintf(stderr, \"auto_$_shader_init: erased shader, Sdr%u.\\n\", shader);\n"
 	"\t\treturn 0;\n"
-	"\t}\n"
+	"\t}\n", name);
+	put("\tif(!auto_$_shader.is_cached) ProgramsStore(shader, \"$\",\n"
+	"\t\tauto_$_shader.defines, auto_$_shader.vs_source,\n"
+	"\t\tauto_$_shader.fs_source);\n"
 	"\tglUseProgram(shader);\n"
-	"\tauto_%s_shader.compiled = shader;\n"
-	"", name, name, name);
+	"\tauto_$_shader.compiled = shader;\n", name);
 	for(i = 0; i < text.uniforms_size; i++) {
 		char *uniform = text.uniforms[i];
 		printf("\tauto_%s_shader.%s = glGetUniformLocation(shader, \"%s\");\n",
 			name, uniform, uniform);
 	}
-	printf("\tWindowIsGlError(\"%s\");\n\n"
+	for(i = 0; i < text.blocks_size; i++) {
+		const char *const block = text.blocks[i].name;
+		printf("\t{\n"
+		"\t\tconst GLuint %s = auto_%s_shader.%s;\n", block, name, block);
+		printf("\t\tauto_%s_shader.%s = AUTO_BLOCK_NONE;\n"
+		"#ifdef GL_ARB_uniform_buffer_object /* <-- ubo */\n"
+		"\t\tif(%s != AUTO_BLOCK_NONE && (auto_%s_shader.%s\n"
+		"\t\t\t= glGetUniformBlockIndex(shader, \"%s\")) != GL_INVALID_INDEX) {\n"
+		"\t\t\tGLint size;\n"
+		"\t\t\tglGetActiveUniformBlockiv(shader, auto_%s_shader.%s,\n"
+		"\t\t\t\tGL_UNIFORM_BLOCK_DATA_SIZE, &size);\n"
+		"", name, block, block, name, block, block, name, block);
+		printf("\t\t\tif((size_t)size > sizeof(struct Auto%s)) {\n"
+		"\t\t\t\tfprintf(stderr, \"auto_%s_shader_init: block %s is %%dB, but struct Auto%s is %%luB.\\n\",\n"
+		"\t\t\t\t\tsize, (unsigned long)sizeof(struct Auto%s));\n"
+		"\t\t\t\tglDeleteProgram(shader);\n"
+		"\t\t\t\tauto_%s_shader.compiled = 0;\n"
+		"\t\t\t\treturn 0;\n"
+		"\t\t\t}\n"
+		"\t\t\tglUniformBlockBinding(shader, auto_%s_shader.%s, %s);\n"
+		"\t\t}\n"
+		"#else /* ubo --><-- !ubo */\n"
+		"\t\t(void)%s;\n"
+		"#endif /* !ubo --> */\n"
+		"\t}\n"
+		"", block, name, block, block, block, name, name, block, block, block);
+	}
+	put("\tWindowIsGlError(\"$\");\n\n"
 	"\treturn 1;\n"
 	"}\n\n"
-	"void auto_%s_(void);\n\n"
-	"void auto_%s_(void) {\n"
-	"\tif(!auto_%s_shader.compiled) return;\n"
-	"\tfprintf(stderr, \"~auto_%s_shader: erase shader, Sdr%%u.\\n\",\n"
-	"\t\tauto_%s_shader.compiled);\n"
-	"\tglDeleteProgram(auto_%s_shader.compiled);\n"
-	"\nauto_%s_shader.compiled = 0;\n"
-	"}\n", name, name, name, name, name, name, name, name);
+	"/** Compiles a shader with {defines}, all at once.\n"
+	" @return Success. */\n", name);
+	prototype(name, "_variant", 1), printf(" {\n"
+	"\treturn auto_%s_begin(", name), arguments(), printf("defines)\n"
+	"\t\t&& auto_%s_end();\n"
+	"}\n\n"
+	"/** Compiles a shader.\n"
+	" @return Success. */\n", name);
+	prototype(name, "", 0), printf(" {\n"
+	"\treturn auto_%s_variant(", name), arguments(), printf("0);\n"
+	"}\n\n");
+	put("void auto_$_(void);\n\n"
+	"void auto_$_(void) {\n"
+	"\tif(!auto_$_shader.compiled) return;\n"
+	"\tfprintf(stderr, \"~auto_$_shader: erase shader, Sdr%u.\\n\",\n"
+	"\t\tauto_$_shader.compiled);\n"
+	"\tglDeleteProgram(auto_$_shader.compiled);\n"
+	"\nauto_$_shader.compiled = 0;\n"
+	"}\n", name);
 
 	return EXIT_SUCCESS;
 }
 
+/** @return The {std140} type called {name}, or exits. */
+static const struct Type *type_search(const char *const name) {
+	size_t i;
+	for(i = 0; i < types_size; i++)
+		if(!strcmp(types[i].name, name)) return types + i;
+	fprintf(stderr, "Type %s is not understood in a block.\n", name);
+	exit(EXIT_FAILURE);
+}
+
+/** Starts the block {name}. If the other shader has already declared it, it's
+ read again, and must be the same.
+ @return The block to add members to. */
+static struct Block *block_begin(const char *const name, int *const is_again) {
+	struct Block *block;
+	size_t i;
+	for(i = 0; i < text.blocks_size; i++) {
+		if(strcmp(text.blocks[i].name, name)) continue;
+		*is_again = 1;
+		return text.blocks + i;
+	}
+	if(text.blocks_size >= sizeof text.blocks / sizeof *text.blocks)
+		fprintf(stderr, "Blocks capacity exceeded at %lu :0.\n",
+		(unsigned long)(sizeof text.blocks / sizeof *text.blocks)),
+		exit(EXIT_FAILURE);
+	block = text.blocks + text.blocks_size++;
+	strncpy(block->name, name, sizeof block->name);
+	block->name[sizeof block->name - 1] = '\0';
+	block->members_size = 0;
+	*is_again = 0;
+	return block;
+}
+
+/** Adds or, {is_again}, checks, the {member} number {index} of {block}. */
+static void block_member(struct Block *const block, const size_t index,
+	const int is_again, const struct Type *const type, const char *const name) {
+	struct Member *m;
+	if(strchr(name, '['))
+		fprintf(stderr, "Block %s: arrays are not understood.\n", block->name),
+		exit(EXIT_FAILURE);
+	if(is_again) {
+		if(index >= block->members_size || block->members[index].type != type
+			|| strcmp(block->members[index].name, name))
+			fprintf(stderr, "Block %s is not the same in both shaders.\n",
+			block->name), exit(EXIT_FAILURE);
+		return;
+	}
+	if(block->members_size >= sizeof block->members / sizeof *block->members)
+		fprintf(stderr, "Block %s capacity exceeded.\n", block->name),
+		exit(EXIT_FAILURE);
+	m = block->members + block->members_size++;
+	strncpy(m->name, name, sizeof m->name);
+	m->name[sizeof m->name - 1] = '\0';
+	m->type = type;
+}
+
+/** @return Whether {name} is already a uniform; both shaders may use it. */
+static int is_uniform(const char *const name) {
+	size_t i;
+	for(i = 0; i < text.uniforms_size; i++)
+		if(!strcmp(text.uniforms[i], name)) return 1;
+	return 0;
+}
+
+/** Processes the file {include}, in the same directory as {fn}, as if it
+ were in {fn}. */
+static void source_include(const char *const fn, const char *const include,
+	const int is_output) {
+	char path[1024];
+	const char *const slash = strrchr(fn, '/');
+	const size_t dir = slash ? (size_t)(slash - fn) + 1 : 0;
+	if(dir + strlen(include) >= sizeof path) fprintf(stderr,
+		"%s: include %s is too long.\n", fn, include), exit(EXIT_FAILURE);
+	memcpy(path, fn, dir), strcpy(path + dir, include);
+	source_process(path, is_output);
+}
+
 static void source_process(const char *const fn, const int is_output) {
 	FILE *const fp = fopen(fn, "r");
-	size_t len;
+	size_t len, index = 0;
 	char read[1024], *word, *var, *c;
 	enum { ATTRIB, UNIFORM } type;
+	struct Block *block = 0;
+	const struct Type *member_type;
+	int is_again = 0, is_open;
 
 	if(!fp) { perror(fn); exit(EXIT_FAILURE); }
 	while(fgets(read, sizeof(read) / sizeof(char), fp)) {
 		if(!(len = strlen(read))) break;
+		if(!strncmp("#include \"", read, 10)
+			&& (c = strchr(read + 10, '"'))) {
+			*c = '\0';
+			source_include(fn, read + 10, is_output);
+			continue;
+		}
 		if(read[len - 1] == '\n') {
 			read[len - 1] = '\0';
 			if(is_output) { printf("\n\"%s\\n\"", read); continue; }
 			/* it's very delicate! */
+			is_open = len >= 2 && read[len - 2] == '{';
 			if(!(word = strtok(read, " \t"))) continue;
+			if(block) {
+				if(*word == '}') {
+					if(is_again && index != block->members_size)
+						fprintf(stderr, "Block %s is not the same in both "
+						"shaders.\n", block->name), exit(EXIT_FAILURE);
+					block = 0;
+					continue;
+				}
+				if(!strncmp("//", word, 2)) continue;
+				member_type = type_search(word);
+				while((word = strtok(0, " ,;")))
+					block_member(block, index++, is_again, member_type, word);
+				continue;
+			}
+			/* {layout(std140)} goes before a block; it's the only layout. */
+			if(!strncmp("layout", word, 6) && !(word = strtok(0, " \t")))
+				continue;
 			if(!strcmp("attribute", word)) {
 				type = ATTRIB;
 			} else if(!strcmp("uniform", word)) {
@@ -219,8 +522,14 @@ static void source_process(const char *const fn, const int is_output) {
 			} else {
 				continue;
 			}
-			if(!strtok(0, " \t")) continue; /* var type; we don't care */
+			if(!(word = strtok(0, " \t"))) continue; /* var type; we don't care */
+			if(type == UNIFORM && is_open) {
+				if((c = strchr(word, '{'))) *c = '\0';
+				block = block_begin(word, &is_again), index = 0;
+				continue;
+			}
 			while((word = strtok(0, " ,;"))) {
+				if(type == UNIFORM && is_uniform(word)) continue;
 				if(type == ATTRIB) {
 					if(text.attribs_size >= text_attribs_capacity) fprintf
 						(stderr, "Attribs capacity exceeded at %lu :0.\n",